@@ -0,0 +1,254 @@
+/* 品灵吊舱控制通道：
+ * 1、调用方随时更新期望状态(角度、变焦/对焦指令)，只保留最新值
+ * 2、控制节拍 tick() 中把期间的所有更新合并为一帧 A组合控制 发出，发送频率不超过设备可接受的频率
+ * 3、链路忙(上一帧未写完或未连接)时本拍不发送，状态保留到下一拍
+ * 4、解析设备回传的组合反馈(B1伺服状态/D1相机状态)，统计命令到反馈的时延
+ *
+ * 通道本身不持有套接字，发送由构造时传入的函数完成，节拍和接收数据由调用方驱动，
+ * 因此可以挂在 boost::asio 套接字或 ConnInterface 等任意链路上。
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <mutex>
+
+#include "pinling_codec.h"
+
+namespace pinling {
+
+// 伺服控制模式
+const uint8_t kServoKeep = 0x0f;   // 不改变伺服状态
+const uint8_t kServoAngle = 0x0b;  // 角度控制
+
+class GimbalChannel {
+ public:
+  typedef std::chrono::steady_clock Clock;
+  // 返回 false 表示链路当前不可写, 本帧不计为已发送
+  typedef std::function<bool(const uint8_t* data, size_t len)> WriteFn;
+
+  struct Config {
+    Config() : max_rate_hz(30), keepalive_ms(0) {}
+    int max_rate_hz;   // 设备可接受的最高控制频率
+    int keepalive_ms;  // 无更新时的保活周期, 0 表示只在状态变化时发送
+  };
+
+  struct Stats {
+    uint64_t updates = 0;     // 调用方的状态更新次数
+    uint64_t frames = 0;      // 实际发出的控制帧
+    uint64_t coalesced = 0;   // 被合并掉(未单独发送)的更新
+    uint64_t busy_ticks = 0;  // 有待发送状态但链路忙的节拍
+    uint64_t feedbacks = 0;   // 收到的组合反馈
+    // 命令发出到之后第一帧组合反馈的时间. 反馈是周期性的, 帧里没有对应的命令, 所以这不是某条命令
+    // 的往返时延, 而是"命令之后多久能看到新状态", 上限约为一个反馈周期加链路时延
+    uint64_t feedback_delay_samples = 0;
+    double feedback_delay_last_ms = 0;
+    double feedback_delay_min_ms = 0;
+    double feedback_delay_max_ms = 0;
+    double feedback_delay_sum_ms = 0;
+
+    double feedbackDelayAvgMs() const {
+      return feedback_delay_samples ? feedback_delay_sum_ms / feedback_delay_samples : 0;
+    }
+  };
+
+  explicit GimbalChannel(WriteFn write, const Config& config = Config())
+      : write_(std::move(write)),
+        config_(config),
+        min_interval_(std::chrono::microseconds(1000000 / std::max(config.max_rate_hz, 1))),
+        angles_dirty_(false),
+        angles_gen_(0),
+        yaw_(0),
+        pitch_(0),
+        camera_dirty_(false),
+        camera_gen_(0),
+        camera_cmd_(0),
+        zoom_speed_(0),
+        pending_updates_(0),
+        has_sent_(false),
+        awaiting_feedback_(false),
+        has_feedback_(false) {}
+
+  /**
+   * @brief 控制节拍周期, 调用方以此周期(或更快)调用 tick()
+   *
+   */
+  Clock::duration period() const { return min_interval_; }
+
+  /**
+   * @brief 期望的偏航/俯仰角(度), 覆盖尚未发送的旧值
+   *
+   */
+  void setAngles(float yaw_deg, float pitch_deg) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    yaw_ = toAngleUnits(yaw_deg);
+    pitch_ = toAngleUnits(pitch_deg);
+    angles_dirty_ = true;
+    ++angles_gen_;
+    ++pending_updates_;
+    ++stats_.updates;
+  }
+
+  /**
+   * @brief 相机(C1包)指令, 如变焦、对焦, 发送一次后清除
+   *
+   * 一帧只能携带一条相机指令, 同一节拍内多次设置时只发送最后一条
+   *
+   * @param camera_cmd
+   * @param zoom_speed 变焦/聚焦速度档位
+   */
+  void setCameraCmd(uint8_t camera_cmd, uint8_t zoom_speed = 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    camera_cmd_ = camera_cmd;
+    zoom_speed_ = zoom_speed;
+    camera_dirty_ = true;
+    ++camera_gen_;
+    ++pending_updates_;
+    ++stats_.updates;
+  }
+
+  /**
+   * @brief 控制节拍: 满足限频且有待发状态(或保活到期)时合并发送一帧
+   *
+   * @return true 本拍发出了一帧
+   */
+  bool tick(Clock::time_point now = Clock::now()) {
+    uint8_t frame[kMaxFrameSize];
+    size_t len = 0;
+    uint64_t angles_gen, camera_gen, updates;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (has_sent_ && now - last_send_ < min_interval_) return false;
+      const bool dirty = angles_dirty_ || camera_dirty_;
+      const bool keepalive = config_.keepalive_ms > 0 &&
+                             (!has_sent_ || now - last_send_ >= std::chrono::milliseconds(config_.keepalive_ms));
+      if (!dirty && !keepalive) return false;
+
+      CombinationControlA msg;
+      if (angles_dirty_) {
+        msg.a1_pack.servo_ctrl = kServoAngle;
+        msg.a1_pack.ctrl_param1 = yaw_;
+        msg.a1_pack.ctrl_param2 = pitch_;
+      }
+      if (camera_dirty_) {
+        msg.c1_pack.camera_cmd = camera_cmd_;
+        msg.c1_pack.zoom_speed = zoom_speed_;
+      }
+      len = encode(msg, frame, sizeof(frame));
+      angles_gen = angles_gen_;
+      camera_gen = camera_gen_;
+      updates = pending_updates_;
+    }
+
+    // 写函数可能较慢或再次进入通道, 不持锁调用
+    const bool sent = write_(frame, len);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!sent) {
+      ++stats_.busy_ticks;
+      return false;
+    }
+    ++stats_.frames;
+    if (updates > 1) stats_.coalesced += updates - 1;
+    pending_updates_ -= updates;
+    // 发送期间又有新的更新时保留待发标志, 下一拍发送新值
+    if (angles_gen == angles_gen_) angles_dirty_ = false;
+    if (camera_gen == camera_gen_) camera_dirty_ = false;
+    has_sent_ = true;
+    last_send_ = now;
+    // 从上一帧反馈之后最早发出的命令算起
+    if (!awaiting_feedback_) {
+      awaiting_feedback_ = true;
+      sent_at_ = now;
+    }
+    return true;
+  }
+
+  /**
+   * @brief 输入从设备收到的字节流
+   *
+   */
+  void onReceive(const uint8_t* data, size_t len, Clock::time_point now = Clock::now()) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    parser_.feed(data, len, [this, now](const Frame& frame) {
+      CombinationFeedback fb;
+      if (!decode(frame, fb)) return;
+      feedback_ = fb;
+      has_feedback_ = true;
+      ++stats_.feedbacks;
+      if (!awaiting_feedback_) return;
+      awaiting_feedback_ = false;
+      const double ms = std::chrono::duration<double, std::milli>(now - sent_at_).count();
+      stats_.feedback_delay_last_ms = ms;
+      if (stats_.feedback_delay_samples == 0 || ms < stats_.feedback_delay_min_ms) {
+        stats_.feedback_delay_min_ms = ms;
+      }
+      if (ms > stats_.feedback_delay_max_ms) stats_.feedback_delay_max_ms = ms;
+      stats_.feedback_delay_sum_ms += ms;
+      ++stats_.feedback_delay_samples;
+    });
+  }
+
+  /**
+   * @brief 最近一次组合反馈
+   *
+   * @return false 尚未收到反馈
+   */
+  bool feedback(CombinationFeedback& out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!has_feedback_) return false;
+    out = feedback_;
+    return true;
+  }
+
+  Stats stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+  }
+
+  const StreamParser::Stats& parserStats() const { return parser_.stats(); }
+
+  /**
+   * @brief 角度(度)与协议单位(360/65536度)的换算, 先归一化到[-180, 180)
+   *
+   */
+  static int16_t toAngleUnits(float deg) {
+    double d = std::fmod(static_cast<double>(deg) + 180.0, 360.0);
+    if (d < 0) d += 360.0;
+    long v = std::lround((d - 180.0) * (65536.0 / 360.0));
+    return static_cast<int16_t>(std::min(std::max(v, -32768L), 32767L));
+  }
+  static float fromAngleUnits(int16_t v) { return static_cast<float>(v * (360.0 / 65536.0)); }
+
+ private:
+  WriteFn write_;
+  Config config_;
+  Clock::duration min_interval_;
+
+  mutable std::mutex mutex_;
+  bool angles_dirty_;
+  uint64_t angles_gen_;
+  int16_t yaw_;
+  int16_t pitch_;
+  bool camera_dirty_;
+  uint64_t camera_gen_;
+  uint8_t camera_cmd_;
+  uint8_t zoom_speed_;
+  uint64_t pending_updates_;
+
+  bool has_sent_;
+  Clock::time_point last_send_;
+  bool awaiting_feedback_;
+  Clock::time_point sent_at_;
+
+  StreamParser parser_;
+  bool has_feedback_;
+  CombinationFeedback feedback_;
+  Stats stats_;
+};
+
+}  // namespace pinling
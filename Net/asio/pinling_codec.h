@@ -0,0 +1,561 @@
+/* 品灵相机协议编解码：
+ * 1、串口帧：0x55 0xAA 0xDC + 长度 + 命令字 + 数据体 + 串口校验和
+ *    长度 = 长度字节 + 命令字 + 数据体 + 校验和，校验和 = 长度、命令字、数据体逐字节异或
+ * 2、网络帧：0xEB 0x90 + 长度(整个串口帧的字节数) + 串口帧 + 网络校验和
+ *    网络校验和 = 串口帧全部字节(含串口校验和)之和的低8位
+ *
+ * 每个数据包(A1/A2/B1/C1/.../T1)只用一个 io() 成员按线上顺序描述字段，
+ * 同一份描述既用于序列化也用于解析。多字节字段一律大端，位段按低位在前打包，
+ * 与旧代码中 #pragma pack(1) 位段结构在小端平台上的内存布局一致。
+ * 编解码逐字节读写缓冲区，不对缓冲区做结构体指针转换；两种校验和在写/读的同一遍中累加。
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace pinling {
+
+const uint8_t kNetHeader[2] = {0xeb, 0x90};
+const uint8_t kSerialHeader[3] = {0x55, 0xaa, 0xdc};
+const size_t kNetOverhead = 4;     // 网络头3字节 + 网络校验和
+const size_t kSerialOverhead = 6;  // 串口头3字节 + 长度 + 命令字 + 串口校验和
+const size_t kMaxFrameSize = kNetOverhead + 255 + 3;
+
+// 序列化: 按描述把字段写入缓冲区, 同时累加两种校验和
+class Writer {
+ public:
+  Writer(uint8_t* buf, size_t cap) : buf_(buf), cap_(cap), pos_(0), ok_(true), xor_(0), sum_(0) {}
+
+  void u8(uint8_t v) { put(v); }
+  void i8(int8_t v) { put(static_cast<uint8_t>(v)); }
+  void u16(uint16_t v) {
+    put(static_cast<uint8_t>(v >> 8));
+    put(static_cast<uint8_t>(v));
+  }
+  void i16(int16_t v) { u16(static_cast<uint16_t>(v)); }
+  void u32(uint32_t v) {
+    u16(static_cast<uint16_t>(v >> 16));
+    u16(static_cast<uint16_t>(v));
+  }
+  void bytes(const uint8_t* p, size_t n) {
+    for (size_t i = 0; i < n; ++i) put(p[i]);
+  }
+
+  // 位段, 参数为 (字段, 位宽) 对, 第一个字段在最低位
+  template <typename... Rest>
+  void bits8(Rest&... rest) {
+    put(static_cast<uint8_t>(packBits(0, rest...)));
+  }
+  template <typename... Rest>
+  void bits16(Rest&... rest) {
+    u16(static_cast<uint16_t>(packBits(0, rest...)));
+  }
+
+  bool ok() const { return ok_; }
+  size_t size() const { return pos_; }
+  uint8_t xorSum() const { return xor_; }
+  uint8_t sum() const { return static_cast<uint8_t>(sum_); }
+
+  // 校验区间控制: 串口帧从长度字节开始异或, 网络校验和覆盖整个串口帧
+  void beginSum() { in_sum_ = true; }
+  void beginXor() { in_xor_ = true; }
+  void endXor() { in_xor_ = false; }
+  void endSum() { in_sum_ = false; }
+
+ private:
+  static uint32_t packBits(unsigned) { return 0; }
+  template <typename T, typename... Rest>
+  static uint32_t packBits(unsigned shift, T& field, const int& width, Rest&... rest) {
+    const uint32_t mask = (1u << width) - 1;
+    return ((static_cast<uint32_t>(field) & mask) << shift) | packBits(shift + width, rest...);
+  }
+
+  void put(uint8_t b) {
+    if (pos_ >= cap_) {
+      ok_ = false;
+      return;
+    }
+    buf_[pos_++] = b;
+    if (in_xor_) xor_ ^= b;
+    if (in_sum_) sum_ += b;
+  }
+
+  uint8_t* buf_;
+  size_t cap_;
+  size_t pos_;
+  bool ok_;
+  uint8_t xor_;
+  uint32_t sum_;
+  bool in_xor_ = false;
+  bool in_sum_ = false;
+};
+
+// 解析: 按同一份描述从缓冲区读出字段
+class Reader {
+ public:
+  Reader(const uint8_t* buf, size_t len) : buf_(buf), len_(len), pos_(0), ok_(true) {}
+
+  void u8(uint8_t& v) { v = get(); }
+  void i8(int8_t& v) { v = static_cast<int8_t>(get()); }
+  void u16(uint16_t& v) {
+    uint16_t hi = get();
+    v = static_cast<uint16_t>((hi << 8) | get());
+  }
+  void i16(int16_t& v) {
+    uint16_t u;
+    u16(u);
+    v = static_cast<int16_t>(u);
+  }
+  void u32(uint32_t& v) {
+    uint16_t hi, lo;
+    u16(hi);
+    u16(lo);
+    v = (static_cast<uint32_t>(hi) << 16) | lo;
+  }
+  void bytes(uint8_t* p, size_t n) {
+    for (size_t i = 0; i < n; ++i) p[i] = get();
+  }
+
+  template <typename... Rest>
+  void bits8(Rest&... rest) {
+    unpackBits(get(), 0, rest...);
+  }
+  template <typename... Rest>
+  void bits16(Rest&... rest) {
+    uint16_t v;
+    u16(v);
+    unpackBits(v, 0, rest...);
+  }
+
+  bool ok() const { return ok_; }
+  size_t size() const { return pos_; }
+
+ private:
+  static void unpackBits(uint32_t, unsigned) {}
+  template <typename T, typename... Rest>
+  static void unpackBits(uint32_t v, unsigned shift, T& field, const int& width, Rest&... rest) {
+    field = static_cast<T>((v >> shift) & ((1u << width) - 1));
+    unpackBits(v, shift + width, rest...);
+  }
+
+  uint8_t get() {
+    if (pos_ >= len_) {
+      ok_ = false;
+      return 0;
+    }
+    return buf_[pos_++];
+  }
+
+  const uint8_t* buf_;
+  size_t len_;
+  size_t pos_;
+  bool ok_;
+};
+
+// 位宽常量, 供 bits8/bits16 以引用方式传入
+namespace width {
+const int k1 = 1, k2 = 2, k3 = 3, k4 = 4, k5 = 5, k7 = 7;
+}  // namespace width
+
+/**************************** 数据包 ****************************/
+
+struct A1Pack {
+  static const size_t kSize = 9;
+  uint8_t servo_ctrl = 0x0f;  // 默认是不改变伺服状态：0x0f
+  int16_t ctrl_param1 = 0;
+  int16_t ctrl_param2 = 0;
+  int16_t ctrl_param3 = 0;
+  int16_t ctrl_param4 = 0;
+
+  template <typename IO>
+  void io(IO& io) {
+    io.u8(servo_ctrl);
+    io.i16(ctrl_param1);
+    io.i16(ctrl_param2);
+    io.i16(ctrl_param3);
+    io.i16(ctrl_param4);
+  }
+};
+
+struct A2Pack {
+  static const size_t kSize = 2;
+  uint8_t servo_ctrl_cmd = 0;  // 5位
+  uint8_t feedback_ctrl = 0;   // 1位
+  uint8_t frame_cnt = 0;       // 2位
+  int8_t adjustable_quantity = 0;  // 调整量
+
+  template <typename IO>
+  void io(IO& io) {
+    io.bits8(servo_ctrl_cmd, width::k5, feedback_ctrl, width::k1, frame_cnt, width::k2);
+    io.i8(adjustable_quantity);
+  }
+};
+
+struct B1Pack {
+  static const size_t kSize = 6;
+  uint8_t roll_degree_4 = 0;  // 滚转角高4位
+  uint8_t servo_state = 0;    // 4位
+  uint8_t roll_degree = 0;    // 滚转角低8位
+  int16_t yaw_degree = 0;
+  int16_t pitch_degree = 0;
+
+  template <typename IO>
+  void io(IO& io) {
+    io.bits8(roll_degree_4, width::k4, servo_state, width::k4);
+    io.u8(roll_degree);
+    io.i16(yaw_degree);
+    io.i16(pitch_degree);
+  }
+};
+
+struct C1Pack {  // c1 包位光学控制包，和相机相关，例如拍照，录像，变焦......
+  static const size_t kSize = 2;
+  uint8_t sensor = 0;            // 使用哪种传感器, 3位
+  uint8_t zoom_speed = 0;        // 变焦/聚焦 速度, 3位
+  uint8_t camera_cmd = 0;        // 7位
+  uint8_t measure_distance = 0;  // 此款相机无此功能，保留, 3位
+
+  template <typename IO>
+  void io(IO& io) {
+    io.bits16(sensor, width::k3, zoom_speed, width::k3, camera_cmd, width::k7, measure_distance, width::k3);
+  }
+};
+
+struct C2Pack {
+  static const size_t kSize = 3;
+  uint8_t cmd = 0;
+  uint16_t param1 = 0;
+
+  template <typename IO>
+  void io(IO& io) {
+    io.u8(cmd);
+    io.u16(param1);
+  }
+};
+
+struct D1Pack {
+  static const size_t kSize = 12;
+  uint8_t reserve1 = 0;
+  uint8_t reserve2 = 0;
+  uint16_t state = 0;
+  uint16_t reserve5 = 0;
+  uint32_t reserve6 = 0;
+  uint16_t zoom_times = 0;  // 放大倍数
+
+  template <typename IO>
+  void io(IO& io) {
+    io.u8(reserve1);
+    io.u8(reserve2);
+    io.u16(state);
+    io.u16(reserve5);
+    io.u32(reserve6);
+    io.u16(zoom_times);
+  }
+};
+
+struct E1Pack {
+  static const size_t kSize = 3;
+  uint8_t track_src = 0;  // 跟踪源, 3位
+  uint8_t param1 = 0;     // 5位
+  uint8_t track_cmd = 0;  // 跟踪指令
+  uint8_t param2 = 0;
+
+  template <typename IO>
+  void io(IO& io) {
+    io.bits8(track_src, width::k3, param1, width::k5);
+    io.u8(track_cmd);
+    io.u8(param2);
+  }
+};
+
+struct E2Pack {
+  static const size_t kSize = 5;
+  uint8_t cmd = 0;  // 扩展指令1
+  uint16_t param1 = 0;
+  uint16_t param2 = 0;
+
+  template <typename IO>
+  void io(IO& io) {
+    io.u8(cmd);
+    io.u16(param1);
+    io.u16(param2);
+  }
+};
+
+struct F1Pack {
+  static const size_t kSize = 1;
+  uint8_t track_state = 0;
+
+  template <typename IO>
+  void io(IO& io) {
+    io.u8(track_state);
+  }
+};
+
+struct T1Pack {
+  static const size_t kSize = 22;
+  uint8_t gps_info[22] = {0};
+
+  template <typename IO>
+  void io(IO& io) {
+    io.bytes(gps_info, sizeof(gps_info));
+  }
+};
+
+/**************************** 命令 ****************************/
+
+// A组合控制
+struct CombinationControlA {
+  static const uint8_t kCmdId = 0x30;
+  static const size_t kBodySize = A1Pack::kSize + C1Pack::kSize + E1Pack::kSize;
+  A1Pack a1_pack;
+  C1Pack c1_pack;
+  E1Pack e1_pack;
+
+  template <typename IO>
+  void io(IO& io) {
+    a1_pack.io(io);
+    c1_pack.io(io);
+    e1_pack.io(io);
+  }
+};
+
+// B组合控制
+struct CombinationControlB {
+  static const uint8_t kCmdId = 0x31;
+  static const size_t kBodySize = A2Pack::kSize + C2Pack::kSize + E2Pack::kSize;
+  A2Pack a2_pack;
+  C2Pack c2_pack;
+  E2Pack e2_pack;
+
+  template <typename IO>
+  void io(IO& io) {
+    a2_pack.io(io);
+    c2_pack.io(io);
+    e2_pack.io(io);
+  }
+};
+
+// 组合反馈: GPS + 跟踪状态 + 伺服状态 + 相机状态
+struct CombinationFeedback {
+  static const uint8_t kCmdId = 0x40;
+  static const size_t kBodySize = T1Pack::kSize + F1Pack::kSize + B1Pack::kSize + D1Pack::kSize;
+  T1Pack t1_pack;
+  F1Pack f1_pack;
+  B1Pack b1_pack;
+  D1Pack d1_pack;
+
+  template <typename IO>
+  void io(IO& io) {
+    t1_pack.io(io);
+    f1_pack.io(io);
+    b1_pack.io(io);
+    d1_pack.io(io);
+  }
+};
+
+/**************************** 编码 ****************************/
+
+/**
+ * @brief 编码为网络帧或串口帧
+ *
+ * @param msg
+ * @param out
+ * @param cap
+ * @param net true为网络帧(含网络头和网络校验和), false为串口帧
+ * @return size_t 帧长度, 缓冲区不足返回0
+ */
+template <typename Msg>
+size_t encode(Msg& msg, uint8_t* out, size_t cap, bool net = true) {
+  static_assert(Msg::kBodySize + 3 <= 255, "body too large");
+  const uint8_t serial_len = static_cast<uint8_t>(Msg::kBodySize + 3);
+  Writer w(out, cap);
+  if (net) {
+    w.bytes(kNetHeader, sizeof(kNetHeader));
+    w.u8(static_cast<uint8_t>(serial_len + 3));
+  }
+  w.beginSum();
+  w.bytes(kSerialHeader, sizeof(kSerialHeader));
+  w.beginXor();
+  w.u8(serial_len);
+  w.u8(Msg::kCmdId);
+  msg.io(w);
+  w.endXor();
+  w.u8(w.xorSum());
+  w.endSum();
+  if (net) w.u8(w.sum());
+  return w.ok() ? w.size() : 0;
+}
+
+/**
+ * @brief 解析出的一帧, body 指向调用方/解析器的缓冲区
+ *
+ */
+struct Frame {
+  bool net;
+  uint8_t cmd_id;
+  const uint8_t* body;
+  size_t body_len;
+};
+
+/**
+ * @brief 把帧的数据体解码为指定命令
+ *
+ * @return true 命令字和长度都匹配
+ */
+template <typename Msg>
+bool decode(const Frame& frame, Msg& msg) {
+  if (frame.cmd_id != Msg::kCmdId || frame.body_len != Msg::kBodySize) return false;
+  Reader r(frame.body, frame.body_len);
+  msg.io(r);
+  return r.ok();
+}
+
+/**************************** 流式解析 ****************************/
+
+/**
+ * @brief 从字节流中解析帧, 同时识别网络帧(0xEB 0x90)和裸串口帧(0x55 0xAA 0xDC)
+ *
+ * 任何长度或校验和错误都只丢弃候选帧头的第一个字节, 然后从下一字节重新找帧头,
+ * 因此数据中恰好出现帧头字节时也能重新同步。
+ */
+class StreamParser {
+ public:
+  struct Stats {
+    uint64_t frames = 0;
+    uint64_t checksum_errors = 0;
+    uint64_t length_errors = 0;
+    uint64_t skipped_bytes = 0;  // 找帧头时丢弃的字节
+  };
+
+  StreamParser() : len_(0) {}
+
+  /**
+   * @brief 输入任意长度的数据, 每解析出一帧调用一次 on_frame(const Frame&)
+   *
+   */
+  template <typename OnFrame>
+  void feed(const uint8_t* data, size_t n, OnFrame&& on_frame) {
+    while (n > 0) {
+      size_t take = sizeof(buf_) - len_;
+      if (take > n) take = n;
+      memcpy(buf_ + len_, data, take);
+      len_ += take;
+      data += take;
+      n -= take;
+      size_t consumed = parse(on_frame);
+      if (consumed > 0) {
+        memmove(buf_, buf_ + consumed, len_ - consumed);
+        len_ -= consumed;
+      }
+    }
+  }
+
+  const Stats& stats() const { return stats_; }
+
+ private:
+  enum Result { kNeedMore, kBad, kGood };
+
+  template <typename OnFrame>
+  size_t parse(OnFrame& on_frame) {
+    size_t pos = 0;
+    while (pos < len_) {
+      const uint8_t b = buf_[pos];
+      if (b != kNetHeader[0] && b != kSerialHeader[0]) {
+        ++pos;
+        ++stats_.skipped_bytes;
+        continue;
+      }
+      size_t frame_size = 0;
+      Frame frame;
+      Result r = b == kNetHeader[0] ? checkNet(pos, frame_size, frame) : checkSerial(pos, frame_size, frame);
+      if (r == kNeedMore) break;
+      if (r == kBad) {
+        ++pos;
+        ++stats_.skipped_bytes;
+        continue;
+      }
+      ++stats_.frames;
+      on_frame(frame);
+      pos += frame_size;
+    }
+    // 缓冲区已满仍无法组成一帧时丢弃一个字节, 避免卡死
+    if (pos == 0 && len_ == sizeof(buf_)) {
+      ++stats_.skipped_bytes;
+      return 1;
+    }
+    return pos;
+  }
+
+  // 串口帧: 头 + len + cmd + body + xor, 总长 len + 3
+  Result checkSerial(size_t pos, size_t& frame_size, Frame& frame) {
+    const size_t avail = len_ - pos;
+    const uint8_t* p = buf_ + pos;
+    for (size_t i = 0; i < sizeof(kSerialHeader) && i < avail; ++i) {
+      if (p[i] != kSerialHeader[i]) return kBad;
+    }
+    if (avail < 4) return kNeedMore;
+    const uint8_t len = p[3];
+    if (len < 3) {
+      ++stats_.length_errors;
+      return kBad;
+    }
+    if (avail < static_cast<size_t>(len) + 3) return kNeedMore;
+    uint8_t x = 0;
+    for (size_t i = 3; i < static_cast<size_t>(len) + 2; ++i) x ^= p[i];
+    if (x != p[len + 2]) {
+      ++stats_.checksum_errors;
+      return kBad;
+    }
+    frame_size = static_cast<size_t>(len) + 3;
+    frame.net = false;
+    frame.cmd_id = p[4];
+    frame.body = p + 5;
+    frame.body_len = len - 3;
+    return kGood;
+  }
+
+  // 网络帧: EB 90 + L + 串口帧(L字节) + sum, 串口帧的异或和网络和在同一遍中计算
+  Result checkNet(size_t pos, size_t& frame_size, Frame& frame) {
+    const size_t avail = len_ - pos;
+    const uint8_t* p = buf_ + pos;
+    if (avail >= 2 && p[1] != kNetHeader[1]) return kBad;
+    if (avail < 3) return kNeedMore;
+    const uint8_t net_len = p[2];
+    if (net_len < kSerialOverhead) {
+      ++stats_.length_errors;
+      return kBad;
+    }
+    if (avail < static_cast<size_t>(net_len) + kNetOverhead) return kNeedMore;
+    const uint8_t* s = p + 3;
+    if (memcmp(s, kSerialHeader, sizeof(kSerialHeader)) != 0 || static_cast<size_t>(s[3]) + 3 != net_len) {
+      ++stats_.length_errors;
+      return kBad;
+    }
+    uint32_t sum = s[0] + s[1] + s[2];
+    uint8_t x = 0;
+    for (size_t i = 3; i + 1 < net_len; ++i) {
+      x ^= s[i];
+      sum += s[i];
+    }
+    sum += s[net_len - 1];
+    if (x != s[net_len - 1] || static_cast<uint8_t>(sum) != s[net_len]) {
+      ++stats_.checksum_errors;
+      return kBad;
+    }
+    frame_size = static_cast<size_t>(net_len) + kNetOverhead;
+    frame.net = true;
+    frame.cmd_id = s[4];
+    frame.body = s + 5;
+    frame.body_len = net_len - kSerialOverhead;
+    return kGood;
+  }
+
+  uint8_t buf_[2 * kMaxFrameSize];
+  size_t len_;
+  Stats stats_;
+};
+
+}  // namespace pinling
@@ -0,0 +1,135 @@
+/* 品灵协议流式解析的模糊测试入口
+ * clang 下以 libFuzzer 构建(-fsanitize=fuzzer), 其它编译器下自带驱动:
+ *   pinling_fuzz [file...]  逐个文件作为输入
+ *   pinling_fuzz            以合法帧为种子随机变异, 默认 100000 轮
+ * 检查项: 任意输入、任意分块方式下解析不越界; 解出的已知命令重新编码后与原帧逐字节一致
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "pinling_codec.h"
+
+namespace {
+
+template <typename Msg>
+void checkRoundTrip(const pinling::Frame& frame) {
+  Msg msg;
+  if (!pinling::decode(frame, msg)) return;
+  uint8_t out[pinling::kMaxFrameSize];
+  size_t n = pinling::encode(msg, out, sizeof(out), frame.net);
+  // body 指向帧内, 帧起点 = body - 头部长度
+  const uint8_t* begin = frame.body - (frame.net ? 8 : 5);
+  if (n == 0 || memcmp(out, begin, n) != 0) abort();
+}
+
+void onFrame(const pinling::Frame& frame) {
+  if (frame.body_len + pinling::kSerialOverhead > 255 + 3) abort();
+  checkRoundTrip<pinling::CombinationControlA>(frame);
+  checkRoundTrip<pinling::CombinationControlB>(frame);
+  checkRoundTrip<pinling::CombinationFeedback>(frame);
+}
+
+}  // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  // 一次性输入
+  pinling::StreamParser whole;
+  whole.feed(data, size, onFrame);
+
+  // 首字节决定分块长度, 覆盖帧跨越多次 feed 的情况
+  if (size > 1) {
+    const size_t chunk = data[0] % 17 + 1;
+    pinling::StreamParser split;
+    for (size_t pos = 1; pos < size; pos += chunk) {
+      split.feed(data + pos, size - pos < chunk ? size - pos : chunk, onFrame);
+    }
+  }
+  return 0;
+}
+
+#ifndef PINLING_LIBFUZZER
+namespace {
+
+bool readFile(const char* path, std::vector<uint8_t>& out) {
+  FILE* f = fopen(path, "rb");
+  if (!f) {
+    perror(path);
+    return false;
+  }
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+  fclose(f);
+  return true;
+}
+
+// 若干合法帧拼接, 作为变异种子
+std::vector<uint8_t> makeSeed() {
+  std::vector<uint8_t> seed;
+  uint8_t buf[pinling::kMaxFrameSize];
+  pinling::CombinationControlA a;
+  a.a1_pack.servo_ctrl = 0x0b;
+  a.a1_pack.ctrl_param2 = 90 * (65536 / 360);
+  a.c1_pack.camera_cmd = 0x55;
+  size_t n = pinling::encode(a, buf, sizeof(buf));
+  seed.insert(seed.end(), buf, buf + n);
+  pinling::CombinationControlB b;
+  b.a2_pack.servo_ctrl_cmd = 0x11;
+  b.e2_pack.param2 = 0xeb90;
+  n = pinling::encode(b, buf, sizeof(buf), false);
+  seed.insert(seed.end(), buf, buf + n);
+  pinling::CombinationFeedback fb;
+  fb.b1_pack.yaw_degree = -1234;
+  fb.d1_pack.zoom_times = 30;
+  n = pinling::encode(fb, buf, sizeof(buf));
+  seed.insert(seed.end(), buf, buf + n);
+  return seed;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc > 1) {
+    for (int i = 1; i < argc; ++i) {
+      std::vector<uint8_t> input;
+      if (!readFile(argv[i], input)) return 1;
+      LLVMFuzzerTestOneInput(input.data(), input.size());
+    }
+    return 0;
+  }
+
+  const std::vector<uint8_t> seed = makeSeed();
+  LLVMFuzzerTestOneInput(seed.data(), seed.size());
+  srand(1);
+  const int rounds = 100000;
+  std::vector<uint8_t> input;
+  for (int r = 0; r < rounds; ++r) {
+    input = seed;
+    const int mutations = rand() % 8;
+    for (int m = 0; m < mutations; ++m) {
+      const size_t pos = rand() % input.size();
+      switch (rand() % 4) {
+        case 0:
+          input[pos] = static_cast<uint8_t>(rand());
+          break;
+        case 1:
+          input.erase(input.begin() + pos);
+          break;
+        case 2:
+          input.insert(input.begin() + pos, static_cast<uint8_t>(rand() % 2 ? 0xeb : 0x55));
+          break;
+        default:
+          input[pos] ^= static_cast<uint8_t>(1u << (rand() % 8));
+          break;
+      }
+      if (input.empty()) input.push_back(0);
+    }
+    LLVMFuzzerTestOneInput(input.data(), input.size());
+  }
+  printf("pinling_fuzz: %d rounds ok\n", rounds);
+  return 0;
+}
+#endif
@@ -1,74 +1,89 @@
-#include "pinling_protocol.cc"
+#include "gimbal_channel.h"
 
+#include <array>
+#include <atomic>
 #include <iostream>
+#include <memory>
 #include <thread>
-#include <boost/shared_ptr.hpp>
+#include <vector>
 #include <boost/asio.hpp>
-#include <boost/lexical_cast.hpp>
-#include <boost/bind.hpp>
-#include <boost/function.hpp>
-typedef boost::function<void(const boost::system::error_code&, const int& handle)> Callback;
+#include <boost/asio/steady_timer.hpp>
 
-Callback funcRead_;
-Callback funcWrite_;
-boost::shared_ptr<boost::asio::io_service> io_service_;
-boost::shared_ptr<boost::asio::ip::tcp::socket> socket_;
- 
- 
-void OnSendData(const boost::system::error_code& ErrorCode, const int& handle)
+// 通过吊舱控制通道发送命令: 最新状态在控制节拍中合并为一帧, 上一帧写完前不会再写
+boost::asio::io_service io_service_;
+boost::asio::ip::tcp::socket socket_(io_service_);
+boost::asio::steady_timer tick_timer_(io_service_);
+boost::asio::steady_timer stat_timer_(io_service_);
+std::unique_ptr<pinling::GimbalChannel> channel_;
+
+std::vector<uint8_t> bufferWrite_;
+std::atomic<bool> writing_(false);
+std::array<uint8_t, 512> bufferRead_;
+
+bool WriteFrame(const uint8_t* data, size_t len)
 {
-	std::cout << "OnSendData" << std::endl;
- 
-	if (ErrorCode.value() != 0)
-	{
-		std::cout <<  " Error::Sending Data::" << ErrorCode.message() << std::endl;;
-	}
+	if (!socket_.is_open() || writing_.exchange(true)) return false;
+	bufferWrite_.assign(data, data + len);
+	boost::asio::async_write(socket_, boost::asio::buffer(bufferWrite_),
+		[](const boost::system::error_code& ErrorCode, size_t)
+		{
+			if (ErrorCode)
+			{
+				std::cout << " Error::Sending Data::" << ErrorCode.message() << std::endl;
+			}
+			writing_ = false;
+		});
+	return true;
 }
- 
-boost::array<char, 5> bufferRead_;
- 
-void OnReceiveData(const boost::system::error_code& ErrorCode, const int& handle)
+
+void OnReceiveData(const boost::system::error_code& ErrorCode, size_t bytes)
 {
-	std::cout << "OnReceiveData" << std::endl;
-	
-	if (ErrorCode.value() == 0)
+	if (ErrorCode)
 	{
-		for (int i = 0; i < bufferRead_.size(); i++)
-		{
-			std::cout << bufferRead_[i] << " ";
-		}
-		std::cout << std::endl;
+		std::cout << " Error::Receiving Data::" << ErrorCode.message() << std::endl;
+		return;
 	}
- 
-	boost::asio::async_read(*socket_, boost::asio::buffer(bufferRead_, bufferRead_.size()), funcRead_);
+	channel_->onReceive(bufferRead_.data(), bytes);
+	socket_.async_read_some(boost::asio::buffer(bufferRead_), OnReceiveData);
+}
+
+void OnTick(const boost::system::error_code& ErrorCode)
+{
+	if (ErrorCode) return;
+	channel_->tick();
+	tick_timer_.expires_at(tick_timer_.expires_at() + channel_->period());
+	tick_timer_.async_wait(OnTick);
 }
- 
-void StartReading(int n)
+
+void OnStat(const boost::system::error_code& ErrorCode)
 {
-	io_service_->run();
+	if (ErrorCode) return;
+	pinling::GimbalChannel::Stats stats = channel_->stats();
+	std::cout << "updates " << stats.updates << " frames " << stats.frames << " coalesced " << stats.coalesced
+	          << " busy " << stats.busy_ticks << " feedbacks " << stats.feedbacks << " feedback delay(ms) last "
+	          << stats.feedback_delay_last_ms << " avg " << stats.feedbackDelayAvgMs() << " max "
+	          << stats.feedback_delay_max_ms << std::endl;
+	stat_timer_.expires_from_now(std::chrono::seconds(1));
+	stat_timer_.async_wait(OnStat);
 }
- 
+
 int main()
 {
-	io_service_ = boost::shared_ptr<boost::asio::io_service>(new boost::asio::io_service);
-	socket_ = boost::shared_ptr<boost::asio::ip::tcp::socket>(new boost::asio::ip::tcp::socket(*io_service_));
-    boost::asio::ip::tcp::endpoint ep(boost::asio::ip::address::from_string("192.168.2.119"), 2000);
- 
-	socket_->connect(ep);
-	
-	funcWrite_ = boost::bind(OnSendData, boost::asio::placeholders::error, 0);
-	funcRead_ = boost::bind(OnReceiveData, boost::asio::placeholders::error, 0);
-    io_service_->run();
- 
-    std::cout << "tag" << std::endl;
-	boost::asio::async_read(*socket_, boost::asio::buffer(bufferRead_, bufferRead_.size()), funcRead_);
-	std::thread t(StartReading, NULL);
- 
-	std::vector<char> sendBuffer_(100);
-    CombinationControlA cmd = get_cmd();
-	while (1)
-	{
-		//std::cin >> &sendBuffer_[0];
-		socket_->async_send(boost::asio::buffer((void*)&cmd, sizeof(cmd)), funcWrite_);
-	}
-}
\ No newline at end of file
+	boost::asio::ip::tcp::endpoint ep(boost::asio::ip::address::from_string("192.168.2.119"), 2000);
+	socket_.connect(ep);
+
+	pinling::GimbalChannel::Config config;
+	config.max_rate_hz = 30;
+	channel_.reset(new pinling::GimbalChannel(WriteFrame, config));
+
+	socket_.async_read_some(boost::asio::buffer(bufferRead_), OnReceiveData);
+	tick_timer_.expires_from_now(channel_->period());
+	tick_timer_.async_wait(OnTick);
+	stat_timer_.expires_from_now(std::chrono::seconds(1));
+	stat_timer_.async_wait(OnStat);
+	std::thread t([] { io_service_.run(); });
+
+	// 一键朝下, 之后由控制节拍按限频发出
+	channel_->setAngles(0, 90);
+	t.join();
+}
@@ -14,12 +14,12 @@ using boost::system::error_code;
 int main(int argc, char* argv[]) {
     io_service service;
     ip::tcp::endpoint ep(ip::address::from_string("192.168.2.119"), 2000);
-    CombinationControlA cmd = get_cmd();
+    std::vector<uint8_t> cmd = get_cmd();
     error_code ec;
     ip::tcp::socket sock(service);
     sock.connect(ep, ec);
     if (ec) std::cout << ec.message() << std::endl;
-    sock.write_some(buffer((const void*)&cmd, sizeof(cmd)));
+    sock.write_some(buffer(cmd));
     char buf[1024];
     int bytes = read(sock, buffer(buf));
     std::cout << "read msg:" << *buf << std::endl;
@@ -0,0 +1,156 @@
+/**
+ * @file command_router.h
+ * @author caofangyu (caofy@antwork.link)
+ * @brief  广告牌指令路由，按 cmd_type 注册处理函数
+ * @version 0.1
+ * @date 2023-11-07
+ *
+ * 1、只用 SAX 方式扫描顶层的 billboard_id / cmd_type 等字段，不构建完整的 json 树；
+ *    处理函数需要其他字段时再调用 Request::body() 完整解析
+ * 2、固定内容的应答在注册时序列化为片段，处理请求时只拼接 billboard_id 和 cmd_type
+ * 3、解析失败、缺字段、未知指令都返回 cmd_type=7 的错误应答，热路径上不抛异常
+ *
+ * 字段路由的字段可能出现在顶层任意位置，所以除命中字段路由外总是扫描完整条消息，
+ * 格式错误在分发时就返回错误应答；命中字段路由时扫描在该字段处停止，之后的内容不再校验。
+ *
+ * Copyright (c) 2015-2022 Xunyi Ltd. All rights reserved.
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+#include "websocketpp/common/connection_hdl.hpp"
+
+namespace websocket_conn {
+
+/**
+ * @brief 错误应答的 cmd_type
+ *
+ */
+const int kCmdError = 7;
+
+class CommandRouter {
+ public:
+  using json = nlohmann::json;
+
+  /**
+   * @brief 一条指令请求, 只在处理函数调用期间有效
+   *
+   */
+  class Request {
+   public:
+    websocketpp::connection_hdl hdl;
+    std::string_view raw;       // 原始消息
+    std::string billboard_id;   // 字符串取原值, 数字取其文本
+    std::string billboard_json; // billboard_id 的 json 文本, 原样写回应答
+    int64_t cmd_type = 0;
+
+    /**
+     * @brief 完整解析消息, 只在第一次调用时解析
+     *
+     * @return const json& 解析失败时为 discarded
+     */
+    const json& body() const;
+
+   private:
+    mutable bool m_parsed = false;
+    mutable json m_body;
+  };
+
+  /**
+   * @brief 应答中 billboard_id/cmd_type 之外的字段, 由处理函数填写
+   *
+   */
+  class Response {
+   public:
+    /**
+     * @brief 追加一个字段
+     *
+     */
+    void set(std::string_view key, const json& value);
+
+    /**
+     * @brief 追加已序列化的字段片段, 以逗号开头, 如 ,"volume":0
+     *
+     */
+    void append_raw(std::string_view fragment) { m_fields.append(fragment); }
+
+    /**
+     * @brief 改为错误应答
+     *
+     */
+    void fail(std::string_view msg) {
+      m_failed = true;
+      m_error.assign(msg);
+    }
+
+    bool failed() const { return m_failed; }
+
+   private:
+    friend class CommandRouter;
+    std::string m_fields;
+    bool m_failed = false;
+    std::string m_error;
+  };
+
+  using Handler = std::function<void(const Request&, Response&)>;
+  // 顶层出现某个字段时整条消息交给该函数处理, 返回完整应答
+  using FieldHandler = std::function<std::string(const Request&)>;
+  // 请求通过校验(有 billboard_id 和 cmd_type)后调用, 在处理函数之前
+  using IdentifyCallback = std::function<void(const Request&)>;
+
+  /**
+   * @brief 注册需要按请求内容生成应答的指令
+   *
+   */
+  void route(int64_t cmd_type, Handler handler);
+
+  /**
+   * @brief 注册固定应答的指令, fields 在注册时序列化一次
+   *
+   * @param fields json 对象, 其字段追加在 billboard_id/cmd_type 之后
+   */
+  void route(int64_t cmd_type, const json& fields);
+
+  /**
+   * @brief 顶层含有 key 字段的消息不走 cmd_type 路由, 如调试回传
+   *
+   */
+  void route_field(const std::string& key, FieldHandler handler);
+
+  void set_identify_cb(IdentifyCallback cb) { m_identify_cb = std::move(cb); }
+
+  /**
+   * @brief 处理一条消息
+   *
+   * @return std::string 应答, 为空时不回复
+   */
+  std::string dispatch(websocketpp::connection_hdl hdl, std::string_view msg) const;
+
+  /**
+   * @brief 错误应答 {"cmd_type":7,"msg":...}, billboard_json 非空时带上 billboard_id
+   *
+   */
+  static std::string error_response(std::string_view msg, std::string_view billboard_json = std::string_view());
+
+ private:
+  struct Route {
+    Handler handler;
+    std::string fragment;  // 固定应答的字段片段
+  };
+
+  std::unordered_map<int64_t, Route> m_routes;
+  std::vector<std::pair<std::string, FieldHandler>> m_field_routes;
+  IdentifyCallback m_identify_cb;
+};
+
+}  // namespace websocket_conn
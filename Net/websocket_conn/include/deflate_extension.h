@@ -0,0 +1,346 @@
+/**
+ * @file deflate_extension.h
+ * @author caofangyu (caofy@antwork.link)
+ * @brief  permessage-deflate 扩展(RFC 7692)，压缩流来自共享池
+ * @version 0.1
+ * @date 2023-11-07
+ *
+ * 协商时总是声明 server_no_context_takeover，服务端每条消息都从空字典开始压缩，因此:
+ * 1、连接上不需要常驻压缩流(每个 deflate 流约 256KB)，发送时从池中借出并 deflateReset 后使用
+ * 2、同一消息在相同窗口大小下的压缩结果对所有连接都一样，广播时只需压缩一次
+ * 解压仍需保留对端的上下文，解压流在连接首次收到压缩消息时才创建。
+ *
+ * 替换 websocketpp 自带的 permessage_deflate::enabled，接口与其一致。
+ * websocketpp 的客户端不处理扩展协商应答，因此客户端角色不发出压缩请求。
+ *
+ * Copyright (c) 2015-2022 Xunyi Ltd. All rights reserved.
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "websocketpp/http/constants.hpp"
+// disabled.hpp 中的 error::disabled 在定义处查找, 必须先于 enabled.hpp 引入, 否则会找到 permessage_deflate::error
+#include "websocketpp/extensions/permessage_deflate/disabled.hpp"
+#include "websocketpp/extensions/permessage_deflate/enabled.hpp"
+
+namespace websocket_conn {
+
+/**
+ * @brief 压缩参数, 进程内所有连接共享, 需在服务启动前设置
+ *
+ */
+struct DeflateSettings {
+  std::atomic<bool> enabled{true};
+  std::atomic<int> server_max_window_bits{15};  // 服务端压缩窗口, 客户端要求更小时取客户端的值
+  std::atomic<int> client_max_window_bits{15};  // 客户端声明可协商时要求的客户端压缩窗口
+  std::atomic<bool> client_no_context_takeover{false};
+  std::atomic<int> level{Z_DEFAULT_COMPRESSION};
+  std::atomic<int> mem_level{8};
+  std::atomic<size_t> max_idle_streams{16};  // 每种窗口大小最多保留的空闲压缩流
+};
+
+inline DeflateSettings& deflate_settings() {
+  static DeflateSettings settings;
+  return settings;
+}
+
+/**
+ * @brief 无上下文接管的压缩流池, 按窗口大小分组
+ *
+ */
+class DeflatePool {
+ public:
+  struct Stats {
+    uint64_t created = 0;
+    uint64_t reused = 0;
+  };
+
+  static DeflatePool& instance() {
+    static DeflatePool pool;
+    return pool;
+  }
+
+  ~DeflatePool() {
+    for (auto& idle : m_idle) {
+      for (z_stream* strm : idle) {
+        deflateEnd(strm);
+        delete strm;
+      }
+    }
+  }
+
+  /**
+   * @brief 压缩一条完整消息并追加到 out, 结尾保留 00 00 ff ff (由调用方按需去掉)
+   *
+   * @param window_bits 9~15
+   * @return false zlib 出错
+   */
+  bool compress(const char* data, size_t len, std::string& out, int window_bits) {
+    if (len == 0) {
+      static const char empty[6] = {0x02, 0x00, 0x00, 0x00, static_cast<char>(0xff), static_cast<char>(0xff)};
+      out.append(empty, sizeof(empty));
+      return true;
+    }
+    z_stream* strm = acquire(window_bits);
+    if (!strm) return false;
+    strm->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    strm->avail_in = static_cast<uInt>(len);
+    const size_t offset = out.size();
+    size_t capacity = deflateBound(strm, static_cast<uLong>(len)) + 16;
+    out.resize(offset + capacity);
+    size_t produced = 0;
+    int ret;
+    for (;;) {
+      strm->next_out = reinterpret_cast<Bytef*>(&out[offset + produced]);
+      strm->avail_out = static_cast<uInt>(capacity - produced);
+      ret = deflate(strm, Z_SYNC_FLUSH);
+      produced = capacity - strm->avail_out;
+      if (ret != Z_OK || strm->avail_out != 0) break;
+      capacity *= 2;
+      out.resize(offset + capacity);
+    }
+    out.resize(offset + produced);
+    release(strm, window_bits);
+    return ret == Z_OK || ret == Z_BUF_ERROR;
+  }
+
+  Stats stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+  }
+
+ private:
+  DeflatePool() = default;
+
+  z_stream* acquire(int window_bits) {
+    window_bits = std::min(std::max(window_bits, 9), 15);
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      auto& idle = m_idle[window_bits];
+      if (!idle.empty()) {
+        z_stream* strm = idle.back();
+        idle.pop_back();
+        ++m_stats.reused;
+        return strm;
+      }
+      ++m_stats.created;
+    }
+    z_stream* strm = new z_stream();
+    strm->zalloc = Z_NULL;
+    strm->zfree = Z_NULL;
+    strm->opaque = Z_NULL;
+    const DeflateSettings& settings = deflate_settings();
+    if (deflateInit2(strm, settings.level, Z_DEFLATED, -window_bits, settings.mem_level, Z_DEFAULT_STRATEGY) !=
+        Z_OK) {
+      delete strm;
+      return nullptr;
+    }
+    return strm;
+  }
+
+  void release(z_stream* strm, int window_bits) {
+    window_bits = std::min(std::max(window_bits, 9), 15);
+    deflateReset(strm);
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      auto& idle = m_idle[window_bits];
+      if (idle.size() < deflate_settings().max_idle_streams) {
+        idle.push_back(strm);
+        return;
+      }
+    }
+    deflateEnd(strm);
+    delete strm;
+  }
+
+  mutable std::mutex m_mutex;
+  std::vector<z_stream*> m_idle[16];
+  Stats m_stats;
+};
+
+/**
+ * @brief 从握手应答的 Sec-WebSocket-Extensions 中取服务端压缩窗口
+ *
+ * @return int 未协商 permessage-deflate 时为0
+ */
+inline int negotiated_deflate_bits(const std::string& extensions) {
+  if (extensions.find("permessage-deflate") == std::string::npos) return 0;
+  const std::string key = "server_max_window_bits=";
+  size_t pos = extensions.find(key);
+  if (pos == std::string::npos) return 15;
+  int bits = atoi(extensions.c_str() + pos + key.size());
+  return bits >= 9 && bits <= 15 ? bits : 15;
+}
+
+/**
+ * @brief permessage-deflate 扩展实现, 用作 config::permessage_deflate_type
+ *
+ */
+template <typename config>
+class PooledDeflate {
+ public:
+  typedef websocketpp::lib::error_code error_code;
+  typedef std::pair<error_code, std::string> err_str_pair;
+
+  PooledDeflate()
+      : m_enabled(false),
+        m_initialized(false),
+        m_is_server(true),
+        m_client_no_context_takeover(false),
+        m_server_max_window_bits(15),
+        m_client_max_window_bits(15),
+        m_inflate_ready(false) {}
+
+  ~PooledDeflate() {
+    if (m_inflate_ready) inflateEnd(&m_istate);
+  }
+
+  PooledDeflate(const PooledDeflate&) = delete;
+  PooledDeflate& operator=(const PooledDeflate&) = delete;
+
+  bool is_implemented() const { return true; }
+  bool is_enabled() const { return m_enabled; }
+
+  std::string generate_offer() const { return ""; }
+  error_code validate_offer(websocketpp::http::attribute_list const&) { return error_code(); }
+
+  /**
+   * @brief 服务端处理客户端的扩展请求, 出错时该请求被忽略(不压缩)
+   *
+   */
+  err_str_pair negotiate(websocketpp::http::attribute_list const& offer) {
+    namespace pmd = websocketpp::extensions::permessage_deflate;
+    err_str_pair ret;
+    const DeflateSettings& settings = deflate_settings();
+    if (!settings.enabled) {
+      ret.first = pmd::error::make_error_code(pmd::error::unsupported_attributes);
+      return ret;
+    }
+
+    int server_bits = settings.server_max_window_bits;
+    int client_bits = 15;
+    bool client_bits_offered = false;
+    bool client_no_context_takeover = settings.client_no_context_takeover;
+    for (auto const& attr : offer) {
+      if (attr.first == "server_no_context_takeover" || attr.first == "client_no_context_takeover") {
+        if (!attr.second.empty()) {
+          ret.first = pmd::error::make_error_code(pmd::error::invalid_attribute_value);
+          return ret;
+        }
+        if (attr.first == "client_no_context_takeover") client_no_context_takeover = true;
+      } else if (attr.first == "server_max_window_bits") {
+        int bits = atoi(attr.second.c_str());
+        // zlib 不支持8位窗口的raw deflate, 无法满足时放弃这个请求
+        if (bits < 9 || bits > 15) {
+          ret.first = pmd::error::make_error_code(pmd::error::invalid_attribute_value);
+          return ret;
+        }
+        server_bits = std::min(server_bits, bits);
+      } else if (attr.first == "client_max_window_bits") {
+        client_bits_offered = true;
+        int bits = attr.second.empty() ? 15 : atoi(attr.second.c_str());
+        if (bits < 8 || bits > 15) {
+          ret.first = pmd::error::make_error_code(pmd::error::invalid_attribute_value);
+          return ret;
+        }
+        client_bits = std::max(9, std::min<int>(bits, settings.client_max_window_bits));
+      } else {
+        ret.first = pmd::error::make_error_code(pmd::error::invalid_attributes);
+        return ret;
+      }
+    }
+
+    m_server_max_window_bits = std::max(9, server_bits);
+    m_client_max_window_bits = client_bits;
+    m_client_no_context_takeover = client_no_context_takeover;
+    m_enabled = true;
+
+    ret.second = "permessage-deflate; server_no_context_takeover";
+    if (m_client_no_context_takeover) ret.second += "; client_no_context_takeover";
+    if (m_server_max_window_bits < 15) {
+      ret.second += "; server_max_window_bits=" + std::to_string(m_server_max_window_bits);
+    }
+    if (client_bits_offered && m_client_max_window_bits < 15) {
+      ret.second += "; client_max_window_bits=" + std::to_string(m_client_max_window_bits);
+    }
+    return ret;
+  }
+
+  error_code init(bool is_server) {
+    m_is_server = is_server;
+    m_initialized = true;
+    return error_code();
+  }
+
+  /**
+   * @brief 压缩并追加到 out, 结尾带 00 00 ff ff, 由 processor 去掉
+   *
+   */
+  error_code compress(std::string const& in, std::string& out) {
+    namespace pmd = websocketpp::extensions::permessage_deflate;
+    if (!m_initialized) return pmd::error::make_error_code(pmd::error::uninitialized);
+    const int bits = m_is_server ? m_server_max_window_bits : m_client_max_window_bits;
+    if (!DeflatePool::instance().compress(in.data(), in.size(), out, bits)) {
+      return pmd::error::make_error_code(pmd::error::zlib_error);
+    }
+    return error_code();
+  }
+
+  error_code decompress(uint8_t const* buf, size_t len, std::string& out) {
+    namespace pmd = websocketpp::extensions::permessage_deflate;
+    if (!m_initialized) return pmd::error::make_error_code(pmd::error::uninitialized);
+    if (!m_inflate_ready) {
+      m_istate.zalloc = Z_NULL;
+      m_istate.zfree = Z_NULL;
+      m_istate.opaque = Z_NULL;
+      m_istate.avail_in = 0;
+      m_istate.next_in = Z_NULL;
+      const int bits = m_is_server ? m_client_max_window_bits : m_server_max_window_bits;
+      if (inflateInit2(&m_istate, -bits) != Z_OK) return pmd::error::make_error_code(pmd::error::zlib_error);
+      m_inflate_ready = true;
+    }
+
+    m_istate.next_in = const_cast<Bytef*>(buf);
+    m_istate.avail_in = static_cast<uInt>(len);
+    size_t offset = out.size();
+    size_t chunk = std::max<size_t>(len * 4, 256);
+    do {
+      out.resize(offset + chunk);
+      m_istate.next_out = reinterpret_cast<Bytef*>(&out[offset]);
+      m_istate.avail_out = static_cast<uInt>(chunk);
+      int ret = inflate(&m_istate, Z_SYNC_FLUSH);
+      if (ret == Z_NEED_DICT || ret == Z_DATA_ERROR || ret == Z_MEM_ERROR || ret == Z_STREAM_ERROR) {
+        out.resize(offset);
+        return pmd::error::make_error_code(pmd::error::zlib_error);
+      }
+      offset += chunk - m_istate.avail_out;
+    } while (m_istate.avail_out == 0);
+    out.resize(offset);
+    return error_code();
+  }
+
+ private:
+  bool m_enabled;
+  bool m_initialized;
+  bool m_is_server;
+  bool m_client_no_context_takeover;
+  int m_server_max_window_bits;
+  int m_client_max_window_bits;
+  bool m_inflate_ready;
+  z_stream m_istate;
+};
+
+}  // namespace websocket_conn
@@ -0,0 +1,110 @@
+/**
+ * @file hdr_histogram.h
+ * @author caofangyu (caofy@antwork.link)
+ * @brief  高动态范围直方图，记录时延等非负整数，3位有效数字
+ * @version 0.1
+ * @date 2023-11-07
+ *
+ * 与 HdrHistogram 的对数-线性分桶相同: 小于 2048 的值逐个计数，之后每个2的幂区间再等分为 1024 份，
+ * 相对误差不超过 1/1024。记录是 O(1) 的数组自增，不加锁，多线程时每个线程一个实例，最后 merge。
+ *
+ * Copyright (c) 2015-2022 Xunyi Ltd. All rights reserved.
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace websocket_conn {
+
+class HdrHistogram {
+ public:
+  static constexpr int kSubBucketBits = 10;
+  static constexpr uint64_t kSubBuckets = uint64_t(1) << kSubBucketBits;  // 每个2的幂区间的份数
+
+  /**
+   * @param max_bits 可记录的最大值为 2^max_bits - 1, 更大的值按最大值记录
+   */
+  explicit HdrHistogram(int max_bits = 32)
+      : m_max_value((uint64_t(1) << std::min(std::max(max_bits, kSubBucketBits + 1), 63)) - 1),
+        m_counts(index_of(m_max_value) + 1, 0) {}
+
+  void record(uint64_t value, uint64_t count = 1) {
+    value = std::min(value, m_max_value);
+    m_counts[index_of(value)] += count;
+    if (m_total == 0 || value < m_min) m_min = value;
+    if (value > m_max) m_max = value;
+    m_total += count;
+    m_sum += value * count;
+  }
+
+  /**
+   * @brief 合并另一个直方图, 两者的 max_bits 须相同
+   *
+   */
+  void merge(const HdrHistogram& other) {
+    if (other.m_total == 0) return;
+    const size_t n = std::min(m_counts.size(), other.m_counts.size());
+    for (size_t i = 0; i < n; ++i) m_counts[i] += other.m_counts[i];
+    if (m_total == 0 || other.m_min < m_min) m_min = other.m_min;
+    m_max = std::max(m_max, other.m_max);
+    m_total += other.m_total;
+    m_sum += other.m_sum;
+  }
+
+  void reset() {
+    std::fill(m_counts.begin(), m_counts.end(), 0);
+    m_total = m_sum = m_min = m_max = 0;
+  }
+
+  /**
+   * @brief 分位数对应的值(所在桶的上界), q 取 0~1
+   *
+   */
+  uint64_t percentile(double q) const {
+    if (m_total == 0) return 0;
+    if (q >= 1.0) return m_max;
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(q * m_total + 0.5));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < m_counts.size(); ++i) {
+      seen += m_counts[i];
+      if (seen >= rank) return std::min(std::max(highest_of(i), m_min), m_max);
+    }
+    return m_max;
+  }
+
+  uint64_t count() const { return m_total; }
+  uint64_t min() const { return m_min; }
+  uint64_t max() const { return m_max; }
+  double mean() const { return m_total ? static_cast<double>(m_sum) / m_total : 0; }
+
+ private:
+  static int log2_floor(uint64_t v) { return 63 - __builtin_clzll(v); }
+
+  static size_t index_of(uint64_t value) {
+    if (value < 2 * kSubBuckets) return static_cast<size_t>(value);
+    const int shift = log2_floor(value) - kSubBucketBits;
+    return static_cast<size_t>(kSubBuckets * shift + (value >> shift));
+  }
+
+  // 与 index 同桶的最大值
+  static uint64_t highest_of(size_t index) {
+    if (index < 2 * kSubBuckets) return index;
+    const int shift = static_cast<int>(index / kSubBuckets) - 1;
+    const uint64_t sub = index - kSubBuckets * shift;
+    return ((sub + 1) << shift) - 1;
+  }
+
+  uint64_t m_max_value;
+  std::vector<uint64_t> m_counts;
+  uint64_t m_total = 0;
+  uint64_t m_sum = 0;
+  uint64_t m_min = 0;
+  uint64_t m_max = 0;
+};
+
+}  // namespace websocket_conn
@@ -2,7 +2,7 @@
  * @file server.h
  * @author caofangyu (caofy@antwork.link)
  * @brief websocket服务端，使用websocketpp库实现
- * @warning 服务端与客户端的通信基于ip, 一个ip地址只能持有一个连接
+ * @note 连接以句柄为主键保存在会话表中, 同一ip可以有多个连接, 发送接口可在任意线程调用
  * @version 0.1
  * @date 2023-11-07
  *
@@ -12,50 +12,258 @@
 
 #pragma once
 
+#include <atomic>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <iostream>
-#include <unordered_map>
 #include <thread>
 #include <string>
+#include <string_view>
 #include <vector>
 
-#include "websocketpp/config/asio_no_tls.hpp"
+#include <google/protobuf/message.h>
+
+#include "hdr_histogram.h"
+#include "server_config.h"
+#include "session_registry.h"
+#include "timer_wheel.h"
 #include "websocketpp/server.hpp"
 
-typedef websocketpp::server<websocketpp::config::asio> server;
+typedef websocketpp::server<websocket_conn::server_config> server;
+
+/**
+ * @brief 连接的数据编码, 握手时由 Sec-WebSocket-Protocol 协商, 客户端未指定时为 json
+ *
+ */
+enum class Encoding { kJson, kProto };
+
+const char* const kJsonSubprotocol = "json";
+const char* const kProtoSubprotocol = "proto";
+
+/**
+ * @brief 连接的心跳状态, 网络线程和时间轮检查时并发读写, 时间为 steady_clock 微秒
+ *
+ */
+struct Liveness {
+  std::atomic<int64_t> last_message_us{0};  // 最近一次收到数据消息
+  std::atomic<int64_t> ping_sent_us{0};     // 未收到应答的 ping 的发送时间, 0为没有
+  std::atomic<int64_t> next_ping_us{0};     // 下一次发送 ping 的时间
+  std::atomic<int64_t> rtt_us{-1};          // 最近一次 ping/pong 往返时延, -1为尚未测到
+};
+
+/**
+ * @brief 服务端附加在每个会话上的数据
+ *
+ */
+struct SessionData {
+  // 消息回调在处理线程池中按连接串行执行
+  std::shared_ptr<websocketpp::lib::asio::io_service::strand> handler_strand;
+  int deflate_bits = 0;  // 协商的服务端压缩窗口, 0为未启用压缩
+  Encoding encoding = Encoding::kJson;
+  std::shared_ptr<Liveness> liveness = std::make_shared<Liveness>();
+};
+typedef websocket_conn::SessionRegistry<server::connection_ptr, SessionData> session_registry;
 
 class WebsocketServer {
  public:
-  using message_cb = std::function<void(std::string)>;
+  using message_cb = std::function<void(websocketpp::connection_hdl, std::string)>;
   using open_cb = std::function<void()>;
   using close_cb = std::function<void()>;
 
+  /**
+   * @brief 线程配置
+   *
+   */
+  struct Options {
+    size_t io_threads = 1;            // 运行网络 io_service 的线程数, 每个连接的读写由 websocketpp 的 strand 串行化
+    size_t handler_threads = 0;       // 执行消息回调的线程数, 0 表示直接在网络线程中执行
+    bool enable_deflate = true;       // 客户端请求时启用 permessage-deflate
+    int deflate_window_bits = 15;     // 服务端压缩窗口上限(9~15)
+    size_t compress_threshold = 256;  // 小于该长度的消息不压缩
+    bool enable_proto = true;         // 接受客户端请求的 proto 子协议
+    int64_t ping_interval_ms = 30000; // 服务端发送 ping 的间隔, 0为不发送
+    int64_t pong_timeout_ms = 10000;  // 发出 ping 后超过该时间未收到 pong 则关闭连接
+    int64_t idle_timeout_ms = 0;      // 超过该时间未收到数据消息则关闭连接, 0为不检查
+  };
+
   WebsocketServer();
+  explicit WebsocketServer(const Options& options);
+  ~WebsocketServer();
 
   void run(uint16_t port);
 
   /**
-   * @brief  发送数据到指定的客户端
-   * 
-   * @param msg 
-   * @param ip 
+   * @brief 停止监听和所有线程
+   *
+   */
+  void stop();
+
+  /**
+   * @brief  发送数据到指定的连接, 负载复制一次到连接的消息池缓冲区
+   *
+   * @param hdl
+   * @param msg
+   * @return false 连接不存在或发送失败
+   */
+  bool send(websocketpp::connection_hdl hdl, std::string_view msg,
+            websocketpp::frame::opcode::value op = websocketpp::frame::opcode::TEXT);
+
+  /**
+   * @brief  同上, 不压缩时直接接管 msg 的缓冲区, 不复制
+   *
+   */
+  bool send(websocketpp::connection_hdl hdl, std::string&& msg,
+            websocketpp::frame::opcode::value op = websocketpp::frame::opcode::TEXT);
+
+  bool send(websocketpp::connection_hdl hdl, const char* msg,
+            websocketpp::frame::opcode::value op = websocketpp::frame::opcode::TEXT) {
+    return send(hdl, std::string_view(msg), op);
+  }
+
+  /**
+   * @brief  发送数据到指定ip的所有连接, 同 broadcast 只组帧一次
+   *
+   * @param msg
+   * @param ip
+   */
+  void send_to_client(std::string_view msg, const std::string& ip);
+
+  /**
+   * @brief  发送数据到绑定了该广告牌id的连接, 同 broadcast 只组帧一次
+   *
+   * @return size_t 发送成功的连接数
+   */
+  size_t send_to_billboard(std::string_view msg, const std::string& billboard_id);
+
+  /**
+   * @brief  把连接绑定到广告牌id, 之后可按id发送
+   *
    */
-  void send_to_client(std::string msg, std::string ip);
+  void bind_billboard(websocketpp::connection_hdl hdl, const std::string& billboard_id);
+
+  /**
+   * @brief  发送到所有连接, 消息只组帧一次, 所有连接的发送队列共享同一个缓冲区
+   *
+   * @return size_t 成功入队的连接数
+   */
+  size_t broadcast(std::string_view msg,
+                   websocketpp::frame::opcode::value op = websocketpp::frame::opcode::TEXT);
+
+  /**
+   * @brief  发送到订阅了主题的连接, 同 broadcast 只组帧一次
+   *
+   * @return size_t 成功入队的连接数
+   */
+  size_t publish(const std::string& topic, std::string_view msg,
+                 websocketpp::frame::opcode::value op = websocketpp::frame::opcode::TEXT);
+
+  /**
+   * @brief  发送 protobuf 消息, proto 连接收二进制帧, json 连接收 MessageToJsonString 的结果
+   *
+   * 按连接的编码序列化一次并组帧, 消息可以分配在 Arena 上
+   *
+   * @return false 连接不存在、序列化失败或发送失败
+   */
+  bool send(websocketpp::connection_hdl hdl, const google::protobuf::Message& msg);
+
+  /**
+   * @brief  同上, 发送到所有连接/订阅了主题的连接
+   *
+   * 两种编码各序列化一次, 再按压缩窗口各组帧一次
+   *
+   * @return size_t 成功入队的连接数
+   */
+  size_t broadcast(const google::protobuf::Message& msg);
+  size_t publish(const std::string& topic, const google::protobuf::Message& msg);
+
+  void subscribe(websocketpp::connection_hdl hdl, const std::string& topic);
+  void unsubscribe(websocketpp::connection_hdl hdl, const std::string& topic);
+
+  /**
+   * @brief  单个连接未发出数据的上限, 超过后关闭该连接而不是继续缓存, 0为不限制
+   *
+   */
+  void set_max_queued_bytes(size_t bytes) { m_max_queued_bytes = bytes; }
+
+  /**
+   * @brief  因发送队列超限被关闭的连接数
+   *
+   */
+  uint64_t dropped_slow_clients() const { return m_dropped_slow_clients; }
+
+  /**
+   * @brief  因心跳超时或空闲被关闭的连接数
+   *
+   */
+  uint64_t reaped_connections() const { return m_reaped_connections; }
+
+  /**
+   * @brief  连接最近一次 ping/pong 的往返时延
+   *
+   * @return int64_t 微秒, 连接不存在或尚未测到时为 -1
+   */
+  int64_t rtt_us(websocketpp::connection_hdl hdl) const;
+
+  /**
+   * @brief  所有连接的 ping/pong 往返时延分布(微秒), 返回副本
+   *
+   */
+  websocket_conn::HdrHistogram rtt_histogram() const;
 
   void set_message_cb(message_cb cb) {m_message_cb = std::move(cb);};
   void set_open_cb(open_cb cb) {m_open_cb = std::move(cb);};
   void set_close_cb(close_cb cb) {m_close_cb = std::move(cb);};
 
   std::vector<std::string> get_ips();
+  size_t connection_count() const { return m_sessions.size(); }
 
  private:
   void on_message(websocketpp::connection_hdl hdl, server::message_ptr msg);
+  bool on_validate(websocketpp::connection_hdl hdl);
   void on_open(websocketpp::connection_hdl hdl);
   void on_close(websocketpp::connection_hdl hdl);
+  void on_pong(websocketpp::connection_hdl hdl, std::string payload);
+
+  // 心跳: 每个 tick 推进一次时间轮, 只检查到期的连接
+  void start_heartbeat();
+  void on_heartbeat_tick(const std::error_code& ec);
+  void check_liveness(session_registry::Key key, int64_t now_us);
+  void schedule_check(session_registry::Key key, int64_t delay_us);
+  void reap(const session_registry::SessionPtr& session, const std::string& reason);
 
-  std::unordered_map<std::string, server::connection_ptr> ip_connection_map;
+  bool send(const session_registry::SessionPtr& session, const server::message_ptr& frame);
+  size_t send_all(const std::vector<session_registry::SessionPtr>& sessions, std::string_view msg,
+                  websocketpp::frame::opcode::value op);
+  size_t send_all(const std::vector<session_registry::SessionPtr>& sessions, const google::protobuf::Message& msg);
+  int deflate_bits_for(const session_registry::SessionPtr& session, size_t size) const;
+  server::message_ptr prepare_frame(const server::connection_ptr& con, std::string_view msg,
+                                    websocketpp::frame::opcode::value op, int deflate_bits);
+  server::message_ptr prepare_frame(const server::connection_ptr& con, std::string&& msg,
+                                    websocketpp::frame::opcode::value op, int deflate_bits);
+  static void finish_frame(const server::message_ptr& frame, websocketpp::frame::opcode::value op, bool compressed);
+  bool check_queue(const session_registry::SessionPtr& session);
+
+  session_registry m_sessions;
   server m_server;
   message_cb m_message_cb;
   open_cb m_open_cb;
   close_cb m_close_cb;
+
+  Options m_options;
+  std::vector<std::thread> m_io_threads;
+  websocketpp::lib::asio::io_service m_handler_service;
+  std::unique_ptr<websocketpp::lib::asio::io_service::work> m_handler_work;
+  std::vector<std::thread> m_handler_threads;
+
+  std::atomic<size_t> m_max_queued_bytes;
+  std::atomic<uint64_t> m_dropped_slow_clients;
+
+  int64_t m_heartbeat_tick_us;
+  int64_t m_heartbeat_next_tick_us = 0;
+  websocket_conn::TimerWheel<session_registry::Key> m_heartbeat_wheel;
+  std::unique_ptr<websocketpp::lib::asio::steady_timer> m_heartbeat_timer;
+  std::atomic<uint64_t> m_reaped_connections;
+  mutable std::mutex m_rtt_mutex;
+  websocket_conn::HdrHistogram m_rtt_histogram;
 };
\ No newline at end of file
@@ -0,0 +1,40 @@
+/**
+ * @file server_config.h
+ * @author caofangyu (caofy@antwork.link)
+ * @brief  websocket服务端的 websocketpp 配置
+ * @version 0.1
+ * @date 2023-11-07
+ *
+ * 在 config::asio 基础上:
+ * 1、permessage-deflate 使用共享压缩流池的实现(见 deflate_extension.h)，客户端未请求时不压缩
+ * 2、访问日志编译期上限只保留连接/断开/失败，逐帧的 frame_header 日志不再生成
+ * 3、消息缓冲区来自按大小分级的线程缓存池，读写高频消息时不再每条都向堆申请
+ *
+ * Copyright (c) 2015-2022 Xunyi Ltd. All rights reserved.
+ *
+ */
+
+#pragma once
+
+#include "deflate_extension.h"
+#include "websocketpp/config/asio_no_tls.hpp"
+#include "websocketpp/message_buffer/pool.hpp"
+
+namespace websocket_conn {
+
+struct server_config : public websocketpp::config::asio {
+  typedef server_config type;
+  typedef websocketpp::config::asio base;
+
+  static const websocketpp::log::level alog_level =
+      websocketpp::log::alevel::connect | websocketpp::log::alevel::disconnect | websocketpp::log::alevel::fail;
+
+  // 收发消息的缓冲区按大小分级复用, 见 message_buffer/pool.hpp
+  typedef websocketpp::message_buffer::message<websocketpp::message_buffer::pool::con_msg_manager> message_type;
+  typedef websocketpp::message_buffer::pool::con_msg_manager<message_type> con_msg_manager_type;
+  typedef websocketpp::message_buffer::pool::endpoint_msg_manager<con_msg_manager_type> endpoint_msg_manager_type;
+
+  typedef PooledDeflate<type> permessage_deflate_type;
+};
+
+}  // namespace websocket_conn
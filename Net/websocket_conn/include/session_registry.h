@@ -0,0 +1,265 @@
+/**
+ * @file session_registry.h
+ * @author caofangyu (caofy@antwork.link)
+ * @brief  websocket会话表，以连接句柄为主键，ip、billboard_id和订阅主题为二级索引
+ * @version 0.1
+ * @date 2023-11-07
+ *
+ * 主表和各二级索引都按键的哈希分片，每个分片一把锁，asio线程和业务线程可以同时访问不同分片。
+ * 同一个ip可以持有多个连接(NAT后面的多块广告牌)，增删都是 O(1)。
+ * 某个会话的索引项只在持有其主表分片锁时修改，加锁顺序固定为 主表分片 -> 索引分片。
+ *
+ * Copyright (c) 2015-2022 Xunyi Ltd. All rights reserved.
+ *
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "websocketpp/common/connection_hdl.hpp"
+
+namespace websocket_conn {
+
+/**
+ * @brief 单个连接的会话信息
+ *
+ * @tparam ConnectionPtr 端点的 connection_ptr 类型
+ * @tparam Data 使用方附加的会话数据, 建立会话时给定
+ */
+template <typename ConnectionPtr, typename Data>
+struct Session {
+  websocketpp::connection_hdl hdl;
+  ConnectionPtr con;
+  std::string ip;
+  std::string billboard_id;  // 收到带 billboard_id 的消息后绑定, 之前为空
+  std::unordered_set<std::string> topics;  // 订阅的主题, 由会话表加锁维护
+  Data data;
+};
+
+struct NoSessionData {};
+
+template <typename ConnectionPtr, typename Data = NoSessionData>
+class SessionRegistry {
+ public:
+  using SessionType = Session<ConnectionPtr, Data>;
+  using SessionPtr = std::shared_ptr<SessionType>;
+  using Key = const void*;
+
+  static constexpr size_t kShards = 64;  // 2的幂
+
+  /**
+   * @brief 连接对象地址作为主键, 连接存活期间不变
+   *
+   */
+  static Key key_of(const websocketpp::connection_hdl& hdl) { return hdl.lock().get(); }
+
+  /**
+   * @brief 新增会话, 同一句柄重复添加时覆盖
+   *
+   */
+  SessionPtr add(websocketpp::connection_hdl hdl, ConnectionPtr con, std::string ip, Data data = Data()) {
+    SessionPtr session = std::make_shared<SessionType>();
+    session->hdl = hdl;
+    session->con = std::move(con);
+    session->ip = std::move(ip);
+    session->data = std::move(data);
+    const Key key = key_of(hdl);
+    Shard& shard = shard_of(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    SessionPtr& slot = shard.sessions[key];
+    if (slot) unindex(key, *slot);
+    slot = session;
+    index_add(ip_index_, session->ip, key);
+    return session;
+  }
+
+  /**
+   * @brief 删除会话
+   *
+   * @return SessionPtr 被删除的会话, 不存在时为空
+   */
+  SessionPtr remove(Key key) {
+    Shard& shard = shard_of(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.sessions.find(key);
+    if (it == shard.sessions.end()) return nullptr;
+    SessionPtr session = std::move(it->second);
+    shard.sessions.erase(it);
+    unindex(key, *session);
+    return session;
+  }
+
+  SessionPtr find(Key key) const {
+    const Shard& shard = shard_of(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.sessions.find(key);
+    return it == shard.sessions.end() ? nullptr : it->second;
+  }
+
+  /**
+   * @brief 绑定广告牌id, 重新绑定时先从旧id的索引中移除
+   *
+   * @return false 会话不存在
+   */
+  bool bind_billboard(Key key, const std::string& billboard_id) {
+    Shard& shard = shard_of(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.sessions.find(key);
+    if (it == shard.sessions.end()) return false;
+    std::string& current = it->second->billboard_id;
+    if (current == billboard_id) return true;
+    if (!current.empty()) index_remove(billboard_index_, current, key);
+    current = billboard_id;
+    if (!current.empty()) index_add(billboard_index_, current, key);
+    return true;
+  }
+
+  /**
+   * @brief 订阅/退订主题
+   *
+   * @return false 会话不存在
+   */
+  bool subscribe(Key key, const std::string& topic) {
+    Shard& shard = shard_of(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.sessions.find(key);
+    if (it == shard.sessions.end()) return false;
+    if (it->second->topics.insert(topic).second) index_add(topic_index_, topic, key);
+    return true;
+  }
+
+  bool unsubscribe(Key key, const std::string& topic) {
+    Shard& shard = shard_of(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.sessions.find(key);
+    if (it == shard.sessions.end()) return false;
+    if (it->second->topics.erase(topic)) index_remove(topic_index_, topic, key);
+    return true;
+  }
+
+  std::vector<SessionPtr> find_by_ip(const std::string& ip) const { return lookup(ip_index_, ip); }
+  std::vector<SessionPtr> find_by_billboard(const std::string& billboard_id) const {
+    return lookup(billboard_index_, billboard_id);
+  }
+  std::vector<SessionPtr> find_by_topic(const std::string& topic) const { return lookup(topic_index_, topic); }
+
+  /**
+   * @brief 依次访问所有会话, 逐个分片加锁, 回调中不要再调用本类的写接口
+   *
+   */
+  void for_each(const std::function<void(const SessionPtr&)>& fn) const {
+    for (const Shard& shard : shards_) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      for (const auto& pair : shard.sessions) fn(pair.second);
+    }
+  }
+
+  /**
+   * @brief 所有会话的快照, 可在锁外任意使用
+   *
+   */
+  std::vector<SessionPtr> snapshot() const {
+    std::vector<SessionPtr> out;
+    out.reserve(size());
+    for_each([&out](const SessionPtr& session) { out.push_back(session); });
+    return out;
+  }
+
+  std::vector<std::string> ips() const {
+    std::vector<std::string> out;
+    for (const IndexShard& shard : ip_index_) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      for (const auto& pair : shard.keys) out.push_back(pair.first);
+    }
+    return out;
+  }
+
+  size_t size() const {
+    size_t n = 0;
+    for (const Shard& shard : shards_) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      n += shard.sessions.size();
+    }
+    return n;
+  }
+
+ private:
+  struct Shard {
+    mutable std::mutex mutex;
+    std::unordered_map<Key, SessionPtr> sessions;
+  };
+  struct IndexShard {
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, std::unordered_set<Key>> keys;
+  };
+  using Index = IndexShard[kShards];
+
+  // 连接对象按16字节以上对齐, 地址低位恒为0, 先混合再取模
+  static size_t shard_index(Key key) {
+    uint64_t v = reinterpret_cast<uintptr_t>(key);
+    v ^= v >> 33;
+    v *= 0xff51afd7ed558ccdULL;
+    v ^= v >> 33;
+    return static_cast<size_t>(v) & (kShards - 1);
+  }
+  static size_t shard_index(const std::string& s) { return std::hash<std::string>()(s) & (kShards - 1); }
+
+  Shard& shard_of(Key key) { return shards_[shard_index(key)]; }
+  const Shard& shard_of(Key key) const { return shards_[shard_index(key)]; }
+
+  static void index_add(Index& index, const std::string& value, Key key) {
+    IndexShard& shard = index[shard_index(value)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.keys[value].insert(key);
+  }
+
+  static void index_remove(Index& index, const std::string& value, Key key) {
+    IndexShard& shard = index[shard_index(value)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.keys.find(value);
+    if (it == shard.keys.end()) return;
+    it->second.erase(key);
+    if (it->second.empty()) shard.keys.erase(it);
+  }
+
+  void unindex(Key key, const SessionType& session) {
+    index_remove(ip_index_, session.ip, key);
+    if (!session.billboard_id.empty()) index_remove(billboard_index_, session.billboard_id, key);
+    for (const std::string& topic : session.topics) index_remove(topic_index_, topic, key);
+  }
+
+  std::vector<SessionPtr> lookup(const Index& index, const std::string& value) const {
+    std::vector<Key> keys;
+    {
+      const IndexShard& shard = index[shard_index(value)];
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      auto it = shard.keys.find(value);
+      if (it == shard.keys.end()) return {};
+      keys.assign(it->second.begin(), it->second.end());
+    }
+    std::vector<SessionPtr> out;
+    out.reserve(keys.size());
+    for (Key key : keys) {
+      SessionPtr session = find(key);
+      if (session) out.push_back(std::move(session));
+    }
+    return out;
+  }
+
+  Shard shards_[kShards];
+  Index ip_index_;
+  Index billboard_index_;
+  Index topic_index_;
+};
+
+}  // namespace websocket_conn
@@ -0,0 +1,99 @@
+/**
+ * @file timer_wheel.h
+ * @author caofangyu (caofy@antwork.link)
+ * @brief  哈希时间轮，大量连接的心跳/超时检查共用一个定时器
+ * @version 0.1
+ * @date 2023-11-07
+ *
+ * 轮子有 slots 个槽，每个槽是一个 tick。到期时间超过一圈的项记录剩余圈数，每经过一次减一。
+ * 调度、取消、到期都是 O(1)，同一个键同时只在轮子里出现一次，重复调度时覆盖之前的到期时间。
+ * 本类不持有定时器，由使用方每个 tick 调用一次 advance()，可在多个线程中调用。
+ *
+ * Copyright (c) 2015-2022 Xunyi Ltd. All rights reserved.
+ *
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace websocket_conn {
+
+template <typename Key>
+class TimerWheel {
+ public:
+  /**
+   * @param slots 槽数, 一圈的时长为 slots 个 tick
+   */
+  explicit TimerWheel(size_t slots = 512) : m_slots(slots > 0 ? slots : 1) {}
+
+  /**
+   * @brief 在 ticks 个 tick 之后到期, 不足一个 tick 按一个计算
+   *
+   */
+  void schedule(Key key, uint64_t ticks) {
+    if (ticks == 0) ticks = 1;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    erase(key);
+    const size_t slot = (m_cursor + ticks) % m_slots.size();
+    m_slots[slot][key] = (ticks - 1) / m_slots.size();
+    m_positions[key] = slot;
+  }
+
+  /**
+   * @brief 取消键的到期, 键不存在时忽略
+   *
+   */
+  void cancel(Key key) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    erase(key);
+  }
+
+  /**
+   * @brief 前进一个 tick
+   *
+   * @return std::vector<Key> 本 tick 到期的键, 已从轮子中移除
+   */
+  std::vector<Key> advance() {
+    std::vector<Key> expired;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_cursor = (m_cursor + 1) % m_slots.size();
+    auto& slot = m_slots[m_cursor];
+    for (auto it = slot.begin(); it != slot.end();) {
+      if (it->second > 0) {
+        --it->second;
+        ++it;
+        continue;
+      }
+      expired.push_back(it->first);
+      m_positions.erase(it->first);
+      it = slot.erase(it);
+    }
+    return expired;
+  }
+
+  size_t size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_positions.size();
+  }
+
+ private:
+  void erase(Key key) {
+    auto it = m_positions.find(key);
+    if (it == m_positions.end()) return;
+    m_slots[it->second].erase(key);
+    m_positions.erase(it);
+  }
+
+  mutable std::mutex m_mutex;
+  std::vector<std::unordered_map<Key, uint64_t>> m_slots;  // 键 -> 剩余圈数
+  std::unordered_map<Key, size_t> m_positions;             // 键 -> 所在槽
+  size_t m_cursor = 0;
+};
+
+}  // namespace websocket_conn
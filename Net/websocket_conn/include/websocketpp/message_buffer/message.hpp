@@ -300,6 +300,18 @@ public:
         m_payload.append(static_cast<char const *>(payload),len);
     }
 
+    /// Set the connection message manager that will recycle this message
+    /**
+     * Used by pooling managers when a recycled message is handed out again, so
+     * that it is recycled through the manager now using it rather than the one
+     * that created it, which may be gone.
+     *
+     * @param manager The manager that will recycle this message
+     */
+    void set_manager(con_msg_man_ptr const & manager) {
+        m_manager = manager;
+    }
+
     /// Recycle the message
     /**
      * A request to recycle this message was received. Forward that request to
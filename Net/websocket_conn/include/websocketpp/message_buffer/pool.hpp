@@ -25,172 +25,281 @@
  *
  */
 
-#ifndef WEBSOCKETPP_MESSAGE_BUFFER_ALLOC_HPP
-#define WEBSOCKETPP_MESSAGE_BUFFER_ALLOC_HPP
+#ifndef WEBSOCKETPP_MESSAGE_BUFFER_POOL_HPP
+#define WEBSOCKETPP_MESSAGE_BUFFER_POOL_HPP
 
 #include <websocketpp/common/memory.hpp>
+#include <websocketpp/common/thread.hpp>
+#include <websocketpp/frame.hpp>
 
+#include <algorithm>
 #include <string>
+#include <vector>
 
 namespace websocketpp {
 namespace message_buffer {
+namespace pool {
 
-/* # message:
- * object that stores a message while it is being sent or received. Contains
- * the message payload itself, the message header, the extension data, and the
- * opcode.
- *
- * # connection_message_manager:
- * An object that manages all of the message_buffers associated with a given
- * connection. Implements the get_message_buffer(size) method that returns
- * a message buffer at least size bytes long.
- *
- * Message buffers are reference counted with shared ownership semantics. Once
- * requested from the manager the requester and it's associated downstream code
- * may keep a pointer to the message indefinitely at a cost of extra resource
- * usage. Once the reference count drops to the point where the manager is the
- * only reference the messages is recycled using whatever method is implemented
- * in the manager.
- *
- * # endpoint_message_manager:
- * An object that manages connection_message_managers. Implements the
- * get_message_manager() method. This is used once by each connection to
- * request the message manager that they are supposed to use to manage message
- * buffers for their own use.
- *
- * TYPES OF CONNECTION_MESSAGE_MANAGERS
- * - allocate a message with the exact size every time one is requested
- * - maintain a pool of pre-allocated messages and return one when needed.
- *   Recycle previously used messages back into the pool
- *
- * TYPES OF ENDPOINT_MESSAGE_MANAGERS
- *  - allocate a new connection manager for each connection. Message pools
- *    become connection specific. This increases memory usage but improves
- *    concurrency.
- *  - allocate a single connection manager and share a pointer to it with all
- *    connections created by this endpoint. The message pool will be shared
- *    among all connections, improving memory usage and performance at the cost
- *    of reduced concurrency
- */
+/// Number of payload size classes. Class i holds messages whose payload
+/// capacity is at least min_class_size << (2 * i): 128B, 512B, 2K, 8K, 32K and
+/// 128K.
+static size_t const size_classes = 6;
+static size_t const min_class_size = 128;
 
-/// Custom deleter for use in shared_ptrs to message.
-/**
- * This is used to catch messages about to be deleted and offer the manager the
- * ability to recycle them instead. Message::recycle will return true if it was
- * successfully recycled and false otherwise. In the case of exceptions or error
- * this deleter frees the memory.
- */
-template <typename T>
-void message_deleter(T* msg) {
-    try {
-        if (!msg->recycle()) {
-            delete msg;
-        }
-    } catch (...) {
-        // TODO: is there a better way to ensure this function doesn't throw?
-        delete msg;
+/// Messages whose payload grew beyond this are freed instead of retained
+static size_t const max_retained_capacity = 256 * 1024;
+
+/// Bytes each thread may keep cached per size class
+static size_t const thread_class_bytes = 256 * 1024;
+
+/// Upper bound on cached messages per thread per size class
+static size_t const thread_class_count = 64;
+
+/// Shared overflow depot holds this many times the per thread limit
+static size_t const depot_factor = 4;
+
+inline size_t class_size(size_t c) {
+    return min_class_size << (2 * c);
+}
+
+/// Smallest class able to hold size bytes, size_classes if none
+inline size_t class_for_size(size_t size) {
+    size_t c = 0;
+    while (c < size_classes && class_size(c) < size) {
+        ++c;
     }
+    return c;
+}
+
+/// Largest class whose size does not exceed capacity
+inline size_t class_for_capacity(size_t capacity) {
+    size_t c = 0;
+    while (c + 1 < size_classes && class_size(c + 1) <= capacity) {
+        ++c;
+    }
+    return c;
+}
+
+inline size_t thread_limit(size_t c) {
+    return std::min(thread_class_count,
+        std::max<size_t>(2, thread_class_bytes / class_size(c)));
 }
 
-/// Represents a buffer for a single WebSocket message.
+namespace detail {
+
+/// Process wide store of messages that overflowed a thread cache
 /**
- *
- *
+ * Messages are typically allocated on one thread (the one reading or the one
+ * calling send) and released on another (the one completing the write). The
+ * depot lets the releasing thread hand surplus messages back to allocating
+ * threads in batches so that neither side falls back to the heap.
  */
-template <typename con_msg_manager>
-class message {
+template <typename message>
+class depot {
 public:
-    typedef lib::shared_ptr<message> ptr;
-
-    typedef typename con_msg_manager::weak_ptr con_msg_man_ptr;
-
-    message(con_msg_man_ptr manager, size_t size = 128)
-      : m_manager(manager)
-      , m_payload(size) {}
+    /// The depot is never destroyed, messages may still be released while
+    /// static objects are being torn down.
+    static depot & get() {
+        static depot * instance = new depot();
+        return *instance;
+    }
 
-    frame::opcode::value get_opcode() const {
-        return m_opcode;
+    /// Move up to n messages of class c to the back of out
+    void take(size_t c, std::vector<message *> & out, size_t n) {
+        lib::lock_guard<lib::mutex> lock(m_lock);
+        std::vector<message *> & free_list = m_free[c];
+        n = std::min(n, free_list.size());
+        out.insert(out.end(), free_list.end() - n, free_list.end());
+        free_list.resize(free_list.size() - n);
     }
-    const std::string& get_header() const {
-        return m_header;
+
+    /// Move the last n messages of in to the depot, freeing what does not fit
+    void give(size_t c, std::vector<message *> & in, size_t n) {
+        size_t const limit = depot_factor * thread_limit(c);
+        size_t kept = 0;
+        {
+            lib::lock_guard<lib::mutex> lock(m_lock);
+            std::vector<message *> & free_list = m_free[c];
+            kept = std::min(n, limit - std::min(limit, free_list.size()));
+            free_list.insert(free_list.end(), in.end() - n, in.end() - n + kept);
+        }
+        for (size_t i = in.size() - n + kept; i < in.size(); ++i) {
+            delete in[i];
+        }
+        in.resize(in.size() - n);
     }
-    const std::string& get_extension_data() const {
-        return m_extension_data;
+
+private:
+    depot() {}
+
+    lib::mutex m_lock;
+    std::vector<message *> m_free[size_classes];
+};
+
+/// Per thread free lists, one per size class
+template <typename message>
+class thread_cache {
+public:
+    ~thread_cache() {
+        for (size_t c = 0; c < size_classes; ++c) {
+            depot<message>::get().give(c, m_free[c], m_free[c].size());
+        }
+        destroyed() = true;
     }
-    const std::string& get_payload() const {
-        return m_payload;
+
+    /// The cache of the calling thread, null once it has been destroyed
+    static thread_cache * local() {
+        if (destroyed()) {
+            return NULL;
+        }
+        static thread_local thread_cache cache;
+        return &cache;
     }
 
-    /// Recycle the message
-    /**
-     * A request to recycle this message was received. Forward that request to
-     * the connection message manager for processing. Errors and exceptions
-     * from the manager's recycle member function should be passed back up the
-     * call chain. The caller to message::recycle will deal with them.
-     *
-     * Recycle must *only* be called by the message shared_ptr's destructor.
-     * Once recycled successfully, ownership of the memory has been passed to
-     * another system and must not be accessed again.
-     *
-     * @return true if the message was successfully recycled, false otherwise.
-     */
-    bool recycle() {
-        typename con_msg_manager::ptr shared = m_manager.lock();
+    message * acquire(size_t c) {
+        std::vector<message *> & free_list = m_free[c];
+        if (free_list.empty()) {
+            depot<message>::get().take(c, free_list, thread_limit(c) / 2);
+            if (free_list.empty()) {
+                return NULL;
+            }
+        }
+        message * msg = free_list.back();
+        free_list.pop_back();
+        return msg;
+    }
 
-        if (shared) {
-            return shared->(recycle(this));
-        } else {
-            return false;
+    void release(size_t c, message * msg) {
+        std::vector<message *> & free_list = m_free[c];
+        if (free_list.size() >= thread_limit(c)) {
+            depot<message>::get().give(c, free_list, free_list.size() / 2);
         }
+        free_list.push_back(msg);
     }
+
 private:
-    con_msg_man_ptr             m_manager;
+    static bool & destroyed() {
+        static thread_local bool value = false;
+        return value;
+    }
 
-    frame::opcode::value        m_opcode;
-    std::string                 m_header;
-    std::string                 m_extension_data;
-    std::string                 m_payload;
+    std::vector<message *> m_free[size_classes];
 };
 
-namespace alloc {
+} // namespace detail
 
-/// A connection message manager that allocates a new message for each
-/// request.
+/// A connection message manager that recycles messages through size class
+/// free lists
+/**
+ * Released messages go to a cache owned by the releasing thread, bounded per
+ * size class, with surplus moved to a bounded process wide depot. Any manager
+ * of the same message type may hand out a message released by another, so the
+ * pool is shared by every connection of the endpoint. A message is recycled
+ * through the manager that last handed it out, which rebinds it on reuse, so
+ * pooled messages outlive the connection that created them. A message whose
+ * manager is gone when it is released is freed as usual.
+ */
 template <typename message>
-class con_msg_manager {
+class con_msg_manager
+  : public lib::enable_shared_from_this<con_msg_manager<message> >
+{
 public:
+    typedef con_msg_manager<message> type;
     typedef lib::shared_ptr<con_msg_manager> ptr;
     typedef lib::weak_ptr<con_msg_manager> weak_ptr;
 
     typedef typename message::ptr message_ptr;
 
-    /// Get a message buffer with specified size
+    /// Get an empty message buffer
+    /**
+     * @return A shared pointer to an empty message with the opcode unset
+     */
+    message_ptr get_message() {
+        message * msg = acquire(0);
+        if (!msg) {
+            msg = new message(type::shared_from_this());
+            msg->get_raw_payload().reserve(class_size(0));
+        }
+        return message_ptr(msg, &type::deleter);
+    }
+
+    /// Get a message buffer with specified size and opcode
     /**
+     * @param op The opcode to use
      * @param size Minimum size in bytes to request for the message payload.
      *
-     * @return A shared pointer to a new message with specified size.
+     * @return A shared pointer to a message with at least size bytes
+     * reserved.
      */
-    message_ptr get_message(size_t size) const {
-        return lib::make_shared<message>(size);
+    message_ptr get_message(frame::opcode::value op, size_t size) {
+        size_t const c = class_for_size(size);
+        message * msg = c < size_classes ? acquire(c) : NULL;
+        if (msg) {
+            msg->set_opcode(op);
+            if (msg->get_payload().capacity() < size) {
+                msg->get_raw_payload().reserve(size);
+            }
+        } else {
+            msg = new message(type::shared_from_this(), op,
+                c < size_classes ? class_size(c) : size);
+        }
+        return message_ptr(msg, &type::deleter);
     }
 
     /// Recycle a message
     /**
-     * This method shouldn't be called. If it is, return false to indicate an
-     * error. The rest of the method recycle chain should notice this and free
-     * the memory.
+     * Clears the message and stores it in the cache of the calling thread.
      *
      * @param msg The message to be recycled.
      *
-     * @return true if the message was successfully recycled, false otherwse.
+     * @return true if the message was retained, false if the caller should
+     * free it.
      */
     bool recycle(message * msg) {
-        return false;
+        size_t const capacity = msg->get_payload().capacity();
+        if (capacity > max_retained_capacity) {
+            return false;
+        }
+        detail::thread_cache<message> * cache =
+            detail::thread_cache<message>::local();
+        if (!cache) {
+            return false;
+        }
+        msg->get_raw_payload().clear();
+        msg->set_header(std::string());
+        msg->set_prepared(false);
+        msg->set_fin(true);
+        msg->set_terminal(false);
+        msg->set_compressed(false);
+        cache->release(class_for_capacity(capacity), msg);
+        return true;
+    }
+
+private:
+    /// Take a cached message of class c and bind it to this manager
+    message * acquire(size_t c) {
+        detail::thread_cache<message> * cache =
+            detail::thread_cache<message>::local();
+        message * msg = cache ? cache->acquire(c) : NULL;
+        if (msg) {
+            msg->set_manager(type::shared_from_this());
+        }
+        return msg;
+    }
+
+    static void deleter(message * msg) {
+        try {
+            if (!msg->recycle()) {
+                delete msg;
+            }
+        } catch (...) {
+            delete msg;
+        }
     }
 };
 
-/// An endpoint message manager that allocates a new manager for each
-/// connection.
+/// An endpoint manager that hands each connection its own manager. All of
+/// them draw from the same per thread pools.
 template <typename con_msg_manager>
 class endpoint_msg_manager {
 public:
@@ -201,29 +310,12 @@ public:
      * @return A pointer to the requested connection message manager.
      */
     con_msg_man_ptr get_manager() const {
-        return lib::make_shared<con_msg_manager>();
+        return con_msg_man_ptr(lib::make_shared<con_msg_manager>());
     }
 };
 
-} // namespace alloc
-
-namespace pool {
-
-/// A connection messages manager that maintains a pool of messages that is
-/// used to fulfill get_message requests.
-class con_msg_manager {
-
-};
-
-/// An endpoint manager that maintains a shared pool of connection managers
-/// and returns an appropriate one for the requesting connection.
-class endpoint_msg_manager {
-
-};
-
 } // namespace pool
-
 } // namespace message_buffer
 } // namespace websocketpp
 
-#endif // WEBSOCKETPP_MESSAGE_BUFFER_ALLOC_HPP
+#endif // WEBSOCKETPP_MESSAGE_BUFFER_POOL_HPP
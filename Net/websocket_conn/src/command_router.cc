@@ -0,0 +1,220 @@
+#include "command_router.h"
+
+namespace websocket_conn {
+
+namespace {
+
+using json = nlohmann::json;
+
+// 错误信息可能引用了非法的 utf8 输入, 序列化时替换而不是抛异常
+std::string dump(const json& value) { return value.dump(-1, ' ', false, json::error_handler_t::replace); }
+
+/**
+ * @brief 只关心顶层字段的 SAX 处理器, 不构建 DOM
+ *
+ * 字段路由的字段可能出现在顶层任意位置, 所以除了命中字段路由或出错之外总是扫描完整条消息,
+ * 这样对格式错误的判断也与 json::parse 一致
+ */
+class HeaderScanner {
+ public:
+  enum Slot { kNone, kBillboard, kCmdType, kOther };
+
+  explicit HeaderScanner(const std::vector<std::pair<std::string, CommandRouter::FieldHandler>>& field_routes)
+      : m_field_routes(field_routes) {}
+
+  bool null() { return scalar_text("null"); }
+  bool boolean(bool val) { return scalar_text(val ? "true" : "false"); }
+  bool number_integer(json::number_integer_t val) { return number(val, std::to_string(val)); }
+  bool number_unsigned(json::number_unsigned_t val) {
+    return number(static_cast<int64_t>(val), std::to_string(val));
+  }
+  bool number_float(json::number_float_t val, const json::string_t& text) {
+    return number(static_cast<int64_t>(val), text);
+  }
+  bool string(json::string_t& val) {
+    if (m_depth == 1 && m_slot == kBillboard) {
+      has_billboard = true;
+      billboard_json = dump(json(val));
+      billboard_id = std::move(val);
+    } else if (m_depth == 1 && m_slot == kCmdType) {
+      error = "cmd_type must be a number";
+    }
+    return value_done();
+  }
+  bool binary(json::binary_t&) { return value_done(); }
+
+  bool start_object(std::size_t) { return start_nested(); }
+  bool end_object() { return end_nested(); }
+  bool start_array(std::size_t) { return start_nested(); }
+  bool end_array() { return end_nested(); }
+
+  bool key(json::string_t& val) {
+    if (m_depth != 1) return true;
+    if (val == "billboard_id") {
+      m_slot = kBillboard;
+    } else if (val == "cmd_type") {
+      m_slot = kCmdType;
+    } else {
+      m_slot = kOther;
+      for (size_t i = 0; i < m_field_routes.size(); ++i) {
+        if (m_field_routes[i].first == val) {
+          field_route = static_cast<int>(i);
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& ex) {
+    error = ex.what();
+    return false;
+  }
+
+  bool has_billboard = false;
+  bool has_cmd_type = false;
+  std::string billboard_id;
+  std::string billboard_json;
+  int64_t cmd_type = 0;
+  int field_route = -1;  // 命中的字段路由下标
+  std::string error;     // 非空时返回错误应答
+
+ private:
+  bool number(int64_t val, const std::string& text) {
+    if (m_depth == 1 && m_slot == kCmdType) {
+      has_cmd_type = true;
+      cmd_type = val;
+      return value_done();
+    }
+    return scalar_text(text);
+  }
+
+  bool scalar_text(const std::string& text) {
+    if (m_depth == 1 && m_slot == kBillboard) {
+      has_billboard = true;
+      billboard_id = text;
+      billboard_json = text;
+    } else if (m_depth == 1 && m_slot == kCmdType) {
+      error = "cmd_type must be a number";
+    }
+    return value_done();
+  }
+
+  bool start_nested() {
+    if (m_depth == 1 && (m_slot == kBillboard || m_slot == kCmdType)) {
+      error = m_slot == kBillboard ? "billboard_id must be a string or number" : "cmd_type must be a number";
+      return false;
+    }
+    ++m_depth;
+    return true;
+  }
+
+  bool end_nested() {
+    --m_depth;
+    return value_done();
+  }
+
+  // 顶层的一个值结束, 出错时停止
+  bool value_done() {
+    if (m_depth != 1) return true;
+    m_slot = kNone;
+    return error.empty();
+  }
+
+  const std::vector<std::pair<std::string, CommandRouter::FieldHandler>>& m_field_routes;
+  int m_depth = 0;
+  Slot m_slot = kNone;
+};
+
+}  // namespace
+
+const nlohmann::json& CommandRouter::Request::body() const {
+  if (!m_parsed) {
+    m_body = json::parse(raw.begin(), raw.end(), nullptr, false);
+    m_parsed = true;
+  }
+  return m_body;
+}
+
+void CommandRouter::Response::set(std::string_view key, const json& value) {
+  m_fields.push_back(',');
+  m_fields.append(dump(json(std::string(key))));
+  m_fields.push_back(':');
+  m_fields.append(dump(value));
+}
+
+void CommandRouter::route(int64_t cmd_type, Handler handler) {
+  Route& route = m_routes[cmd_type];
+  route.handler = std::move(handler);
+  route.fragment.clear();
+}
+
+void CommandRouter::route(int64_t cmd_type, const json& fields) {
+  Response response;
+  if (fields.is_object()) {
+    for (auto const& item : fields.items()) response.set(item.key(), item.value());
+  }
+  Route& route = m_routes[cmd_type];
+  route.handler = nullptr;
+  route.fragment = std::move(response.m_fields);
+}
+
+void CommandRouter::route_field(const std::string& key, FieldHandler handler) {
+  m_field_routes.emplace_back(key, std::move(handler));
+}
+
+std::string CommandRouter::error_response(std::string_view msg, std::string_view billboard_json) {
+  std::string out = "{";
+  if (!billboard_json.empty()) {
+    out.append("\"billboard_id\":");
+    out.append(billboard_json);
+    out.push_back(',');
+  }
+  out.append("\"cmd_type\":");
+  out.append(std::to_string(kCmdError));
+  out.append(",\"msg\":");
+  out.append(dump(json(std::string(msg))));
+  out.push_back('}');
+  return out;
+}
+
+std::string CommandRouter::dispatch(websocketpp::connection_hdl hdl, std::string_view msg) const {
+  HeaderScanner scanner(m_field_routes);
+  json::sax_parse(msg.begin(), msg.end(), &scanner);
+  if (!scanner.error.empty()) return error_response(scanner.error);
+
+  Request request;
+  request.hdl = hdl;
+  request.raw = msg;
+  request.billboard_id = std::move(scanner.billboard_id);
+  request.billboard_json = std::move(scanner.billboard_json);
+  request.cmd_type = scanner.cmd_type;
+  if (scanner.field_route >= 0) return m_field_routes[scanner.field_route].second(request);
+
+  if (!scanner.has_billboard || !scanner.has_cmd_type) {
+    return error_response("json must contains billboard_id cmd_type field");
+  }
+  if (m_identify_cb) m_identify_cb(request);
+
+  auto it = m_routes.find(request.cmd_type);
+  if (it == m_routes.end()) return error_response("invalid cmd", request.billboard_json);
+  const Route& route = it->second;
+  Response response;
+  if (route.handler) {
+    route.handler(request, response);
+    if (response.failed()) return error_response(response.m_error, request.billboard_json);
+  }
+
+  const std::string& fields = route.handler ? response.m_fields : route.fragment;
+  std::string out;
+  out.reserve(32 + request.billboard_json.size() + fields.size());
+  out.append("{\"billboard_id\":");
+  out.append(request.billboard_json);
+  out.append(",\"cmd_type\":");
+  out.append(std::to_string(request.cmd_type));
+  out.append(fields);
+  out.push_back('}');
+  return out;
+}
+
+}  // namespace websocket_conn
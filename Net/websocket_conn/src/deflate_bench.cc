@@ -0,0 +1,159 @@
+/**
+ * @file deflate_bench.cc
+ * @author caofangyu (caofy@antwork.link)
+ * @brief  广告牌下发消息的 permessage-deflate 压缩基准
+ * @version 0.1
+ * @date 2023-11-07
+ *
+ * 用法: deflate_bench [rounds]
+ *
+ * 负载为 my_server 各 cmd_type 的应答, 以及不同广告条数的播放列表。
+ * 输出:
+ *   raw/bits=N    原始长度和各压缩窗口下的压缩后长度(已去掉 00 00 ff ff)
+ *   pooled        共享池借出 + deflateReset, 无上下文接管(服务端实际使用的方式)
+ *   init          每条消息 deflateInit2/deflateEnd
+ *   takeover      每连接常驻压缩流并接管上下文(websocketpp 自带扩展的默认方式)
+ *
+ * Copyright (c) 2015-2022 Xunyi Ltd. All rights reserved.
+ *
+ */
+
+#include <stdlib.h>
+#include <zlib.h>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "deflate_extension.h"
+#include "nlohmann/json.hpp"
+
+using json = nlohmann::json;
+
+namespace {
+
+struct Payload {
+  std::string name;
+  std::string data;
+};
+
+json ad_info(int id) {
+  json ad;
+  ad["ad_id"] = id;
+  ad["ad_type"] = id % 3;
+  ad["url"] = "http://cdn.example.com/ad/" + std::to_string(id) + ".mp4";
+  ad["sec"] = 5 + id * 7 % 120;
+  return ad;
+}
+
+std::vector<Payload> payloads() {
+  std::vector<Payload> out;
+  json base;
+  base["billboard_id"] = "bb-000123";
+
+  json r1 = base;
+  r1["cmd_type"] = 1;
+  r1["ad_infos"] = {ad_info(1), ad_info(2), ad_info(3)};
+  out.push_back({"cmd1 ad list(3)", r1.dump()});
+  json r2 = base;
+  r2["cmd_type"] = 2;
+  r2["control_type"] = 4;
+  r2["control_param"] = 50;
+  out.push_back({"cmd2 control", r2.dump()});
+  json r3 = base;
+  r3["cmd_type"] = 3;
+  r3["volume"] = 0;
+  r3["ad_infos"] = {ad_info(1)};
+  out.push_back({"cmd3 volume", r3.dump()});
+  json r5 = base;
+  r5["cmd_type"] = 5;
+  r5["billboard_main_status"] = 1;
+  r5["billboard_base_status"] = 7;
+  out.push_back({"cmd5 status", r5.dump()});
+
+  for (int n : {20, 100, 500}) {
+    json list = base;
+    list["cmd_type"] = 1;
+    list["ad_infos"] = json::array();
+    for (int i = 0; i < n; ++i) list["ad_infos"].push_back(ad_info(i));
+    out.push_back({"cmd1 ad list(" + std::to_string(n) + ")", list.dump()});
+  }
+  return out;
+}
+
+double now_us() {
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+size_t deflate_once(z_stream* strm, const std::string& in, std::string& out) {
+  strm->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+  strm->avail_in = static_cast<uInt>(in.size());
+  out.resize(deflateBound(strm, in.size()) + 16);
+  strm->next_out = reinterpret_cast<Bytef*>(&out[0]);
+  strm->avail_out = static_cast<uInt>(out.size());
+  deflate(strm, Z_SYNC_FLUSH);
+  return out.size() - strm->avail_out - 4;
+}
+
+void init_stream(z_stream* strm, int bits) {
+  strm->zalloc = Z_NULL;
+  strm->zfree = Z_NULL;
+  strm->opaque = Z_NULL;
+  deflateInit2(strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -bits, 8, Z_DEFAULT_STRATEGY);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const int rounds = argc > 1 ? atoi(argv[1]) : 20000;
+  const int window_bits[] = {9, 12, 15};
+
+  std::cout << std::left << std::setw(20) << "payload" << std::right << std::setw(8) << "raw";
+  for (int bits : window_bits) std::cout << std::setw(9) << ("bits=" + std::to_string(bits));
+  std::cout << std::setw(12) << "pooled us" << std::setw(10) << "init us" << std::setw(13) << "takeover us"
+            << std::setw(14) << "takeover B" << std::endl;
+
+  std::string out;
+  for (const Payload& payload : payloads()) {
+    std::cout << std::left << std::setw(20) << payload.name << std::right << std::setw(8) << payload.data.size();
+    for (int bits : window_bits) {
+      out.clear();
+      websocket_conn::DeflatePool::instance().compress(payload.data.data(), payload.data.size(), out, bits);
+      std::cout << std::setw(9) << out.size() - 4;
+    }
+
+    double begin = now_us();
+    for (int i = 0; i < rounds; ++i) {
+      out.clear();
+      websocket_conn::DeflatePool::instance().compress(payload.data.data(), payload.data.size(), out, 15);
+    }
+    const double pooled = (now_us() - begin) / rounds;
+
+    begin = now_us();
+    for (int i = 0; i < rounds; ++i) {
+      z_stream strm;
+      init_stream(&strm, 15);
+      deflate_once(&strm, payload.data, out);
+      deflateEnd(&strm);
+    }
+    const double init = (now_us() - begin) / rounds;
+
+    // 同一连接上连续发送相同结构的消息, 接管上下文后后续消息可引用前一条
+    z_stream strm;
+    init_stream(&strm, 15);
+    size_t takeover_bytes = 0;
+    begin = now_us();
+    for (int i = 0; i < rounds; ++i) takeover_bytes = deflate_once(&strm, payload.data, out);
+    const double takeover = (now_us() - begin) / rounds;
+    deflateEnd(&strm);
+
+    std::cout << std::fixed << std::setprecision(2) << std::setw(12) << pooled << std::setw(10) << init
+              << std::setw(13) << takeover << std::setw(14) << takeover_bytes << std::endl;
+  }
+
+  const auto stats = websocket_conn::DeflatePool::instance().stats();
+  std::cout << "pool streams: created " << stats.created << ", reused " << stats.reused << std::endl;
+  return 0;
+}
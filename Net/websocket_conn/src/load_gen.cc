@@ -0,0 +1,392 @@
+/**
+ * @file load_gen.cc
+ * @author caofangyu (caofy@antwork.link)
+ * @brief  websocket服务端压测工具，模拟多块广告牌按指定速率发送指令
+ * @version 0.1
+ * @date 2023-11-07
+ *
+ * 用法: load_gen [-u uri] [-c 连接数] [-r 每秒请求数] [-d 秒] [-m cmd_type:权重,...] [-t 线程数]
+ *   默认 ws://127.0.0.1:9002, 100 个连接, 共 1000 次/秒, 10 秒, 只发 cmd_type 1, 2 个线程
+ *   例: load_gen -c 500 -r 20000 -m 1:5,2:2,5:2,6:1
+ *
+ * 每个连接使用独立的 billboard_id(lg-<序号>), 应答按 billboard_id 归属到连接, 同一连接上按顺序与请求配对。
+ * 请求按固定节拍排期, 时延从排期时刻算起, 发送端落后时排队时间也计入时延(避免协同遗漏)。
+ *
+ * 输出:
+ *   connect   建连耗时(TCP + 握手)分位数, 失败数
+ *   latency   请求到应答的时延分位数(us)
+ *   throughput 收到应答的速率, 以及错误应答(cmd_type 7)、未收到应答、不属于本连接的消息数
+ *
+ * Copyright (c) 2015-2022 Xunyi Ltd. All rights reserved.
+ *
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "client.h"
+#include "hdr_histogram.h"
+
+using websocket_conn::HdrHistogram;
+typedef std::chrono::steady_clock Clock;
+
+namespace {
+
+struct Config {
+  std::string uri = "ws://127.0.0.1:9002";
+  size_t connections = 100;
+  double rate = 1000;
+  double duration = 10;
+  size_t threads = 2;
+  std::vector<std::pair<int, double>> mix = {{1, 1.0}};
+};
+
+/**
+ * @brief 解析 "1:5,2:2,6:1" 形式的指令配比
+ *
+ */
+bool parse_mix(const char* text, std::vector<std::pair<int, double>>& mix) {
+  mix.clear();
+  const char* p = text;
+  while (*p) {
+    char* end;
+    long cmd = strtol(p, &end, 10);
+    if (end == p) return false;
+    double weight = 1.0;
+    p = end;
+    if (*p == ':') {
+      weight = strtod(p + 1, &end);
+      if (end == p + 1 || weight < 0) return false;
+      p = end;
+    }
+    mix.emplace_back(static_cast<int>(cmd), weight);
+    if (*p == ',') ++p;
+    else if (*p) return false;
+  }
+  return !mix.empty();
+}
+
+uint64_t elapsed_us(Clock::time_point from, Clock::time_point to) {
+  return to > from ? std::chrono::duration_cast<std::chrono::microseconds>(to - from).count() : 0;
+}
+
+void print_percentiles(const char* name, const HdrHistogram& h) {
+  if (h.count() == 0) {
+    std::cout << name << ": no samples" << std::endl;
+    return;
+  }
+  std::cout << name << " (us): p50=" << h.percentile(0.5) << " p90=" << h.percentile(0.9)
+            << " p99=" << h.percentile(0.99) << " p99.9=" << h.percentile(0.999) << " max=" << h.max()
+            << " mean=" << static_cast<uint64_t>(h.mean()) << " n=" << h.count() << std::endl;
+}
+
+thread_local size_t t_slot = 0;
+
+class LoadGenerator {
+ public:
+  explicit LoadGenerator(const Config& config)
+      : m_config(config), m_latency(config.threads + 1), m_setup(config.threads + 1) {
+    m_client.clear_access_channels(websocketpp::log::alevel::all);
+    m_client.clear_error_channels(websocketpp::log::elevel::all);
+    m_client.init_asio();
+    double total = 0;
+    for (auto const& item : m_config.mix) total += item.second;
+    for (auto const& item : m_config.mix) m_mix.emplace_back(item.first, item.second / total);
+  }
+
+  int run() {
+    for (size_t i = 0; i < m_config.connections; ++i) {
+      std::unique_ptr<Conn> conn(new Conn());
+      conn->billboard_id = "lg-" + std::to_string(i);
+      conn->match = "\"billboard_id\":\"" + conn->billboard_id + "\"";
+      m_conns.push_back(std::move(conn));
+    }
+    for (auto& conn : m_conns) connect(conn.get());
+
+    m_timer.reset(new websocketpp::lib::asio::steady_timer(m_client.get_io_service()));
+    m_start = Clock::now();
+    m_connect_begin = m_start;
+    m_last_report = m_start;
+    schedule_tick();
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < std::max<size_t>(m_config.threads, 1); ++i) {
+      threads.emplace_back([this, i]() {
+        t_slot = i + 1;
+        m_client.run();
+      });
+    }
+    for (auto& t : threads) t.join();
+    report();
+    return 0;
+  }
+
+ private:
+  struct Conn {
+    std::string billboard_id;
+    std::string match;  // 应答中属于本连接的 billboard_id 片段
+    websocketpp::connection_hdl hdl;
+    Clock::time_point connect_start;
+    std::mutex mutex;
+    std::deque<Clock::time_point> pending;  // 未收到应答的请求的排期时刻
+    bool open = false;
+  };
+
+  void connect(Conn* conn) {
+    websocketpp::lib::error_code ec;
+    client::connection_ptr con = m_client.get_connection(m_config.uri, ec);
+    if (ec) {
+      std::cout << "create connection failed: " << ec.message() << std::endl;
+      ++m_connect_failed;
+      return;
+    }
+    conn->hdl = con->get_handle();
+    conn->connect_start = Clock::now();
+    con->set_open_handler([this, conn](websocketpp::connection_hdl) {
+      m_setup[t_slot].record(elapsed_us(conn->connect_start, Clock::now()));
+      std::lock_guard<std::mutex> lock(conn->mutex);
+      conn->open = true;
+      ++m_opened;
+    });
+    con->set_fail_handler([this](websocketpp::connection_hdl) { ++m_connect_failed; });
+    con->set_close_handler([this, conn](websocketpp::connection_hdl) {
+      std::lock_guard<std::mutex> lock(conn->mutex);
+      if (conn->open) --m_opened;
+      conn->open = false;
+      m_lost += conn->pending.size();
+      conn->pending.clear();
+    });
+    con->set_message_handler([this, conn](websocketpp::connection_hdl, client::message_ptr msg) {
+      on_message(conn, msg->get_payload());
+    });
+    m_client.connect(con);
+  }
+
+  void on_message(Conn* conn, const std::string& payload) {
+    const Clock::time_point now = Clock::now();
+    if (payload.find(conn->match) == std::string::npos) {
+      ++m_foreign;
+      return;
+    }
+    Clock::time_point scheduled;
+    {
+      std::lock_guard<std::mutex> lock(conn->mutex);
+      if (conn->pending.empty()) {
+        ++m_foreign;
+        return;
+      }
+      scheduled = conn->pending.front();
+      conn->pending.pop_front();
+    }
+    m_latency[t_slot].record(elapsed_us(scheduled, now));
+    if (payload.find("\"cmd_type\":7") != std::string::npos) ++m_errors;
+    ++m_received;
+  }
+
+  int pick_cmd() {
+    double r = m_uniform(m_rng);
+    for (auto const& item : m_mix) {
+      if (r < item.second) return item.first;
+      r -= item.second;
+    }
+    return m_mix.back().first;
+  }
+
+  void schedule_tick() {
+    m_timer->expires_after(std::chrono::milliseconds(1));
+    m_timer->async_wait([this](const websocketpp::lib::asio::error_code& ec) {
+      if (!ec) tick();
+    });
+  }
+
+  // 发送节拍, 只在定时器回调中执行, 不与自身并发
+  void tick() {
+    const Clock::time_point now = Clock::now();
+    // 所有连接建立(或失败)后才开始计时发送, 最多等待 10 秒
+    if (!m_sending) {
+      if (m_opened + m_connect_failed < m_conns.size() && now - m_start < std::chrono::seconds(10)) {
+        schedule_tick();
+        return;
+      }
+      m_sending = true;
+      m_start = now;
+      std::cout << "connected " << m_opened << "/" << m_conns.size() << " in " << elapsed_us(m_connect_begin, now) / 1000
+                << " ms" << std::endl;
+    }
+    const double elapsed = std::chrono::duration<double>(now - m_start).count();
+    if (!m_draining && elapsed >= m_config.duration) {
+      m_draining = true;
+      m_drain_start = now;
+      m_send_elapsed = elapsed;
+    }
+    if (!m_draining) send_due(elapsed);
+
+    if (now - m_last_report >= std::chrono::seconds(1)) {
+      m_last_report = now;
+      std::cout << "t=" << static_cast<int>(elapsed) << "s open=" << m_opened << " sent=" << m_sent
+                << " recv=" << m_received << " in-flight=" << m_sent - m_received - m_lost - m_send_failed
+                << std::endl;
+    }
+
+    // 停止发送后最多等待 2 秒收齐应答
+    if (m_draining && (m_sent == m_received + m_lost + m_send_failed || now - m_drain_start > std::chrono::seconds(2))) {
+      finish();
+      return;
+    }
+    schedule_tick();
+  }
+
+  void send_due(double elapsed) {
+    const uint64_t due = static_cast<uint64_t>(elapsed * m_config.rate);
+    size_t skipped = 0;
+    while (m_scheduled < due && skipped < m_conns.size()) {
+      Conn* conn = m_conns[m_next++ % m_conns.size()].get();
+      const Clock::time_point scheduled =
+          m_start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(m_scheduled / m_config.rate));
+      const int cmd = pick_cmd();
+      std::string msg = "{\"billboard_id\":\"" + conn->billboard_id + "\",\"cmd_type\":" + std::to_string(cmd);
+      if (cmd == 6) msg += ",\"code\":\"" + std::to_string(m_scheduled) + "\"";
+      msg += "}";
+      {
+        std::lock_guard<std::mutex> lock(conn->mutex);
+        if (!conn->open) {
+          ++skipped;
+          continue;
+        }
+        conn->pending.push_back(scheduled);
+      }
+      skipped = 0;
+      ++m_scheduled;
+      ++m_sent;
+      websocketpp::lib::error_code ec;
+      m_client.send(conn->hdl, msg, websocketpp::frame::opcode::TEXT, ec);
+      if (ec) {
+        std::lock_guard<std::mutex> lock(conn->mutex);
+        if (!conn->pending.empty()) conn->pending.pop_back();
+        ++m_send_failed;
+      }
+    }
+  }
+
+  void finish() {
+    for (auto& conn : m_conns) {
+      {
+        std::lock_guard<std::mutex> lock(conn->mutex);
+        m_lost += conn->pending.size();
+        conn->pending.clear();
+        if (!conn->open) continue;
+        conn->open = false;
+      }
+      websocketpp::lib::error_code ec;
+      m_client.close(conn->hdl, websocketpp::close::status::going_away, "load test done", ec);
+    }
+    m_timer->expires_after(std::chrono::milliseconds(200));
+    m_timer->async_wait([this](const websocketpp::lib::asio::error_code&) { m_client.stop(); });
+  }
+
+  void report() {
+    HdrHistogram latency;
+    HdrHistogram setup;
+    for (auto const& h : m_latency) latency.merge(h);
+    for (auto const& h : m_setup) setup.merge(h);
+    std::cout << "connections: " << setup.count() << " opened, " << m_connect_failed << " failed" << std::endl;
+    print_percentiles("connect", setup);
+    std::cout << "requests: sent " << m_sent << ", responses " << m_received << ", errors " << m_errors << ", lost "
+              << m_lost << ", send failed " << m_send_failed << ", foreign " << m_foreign << std::endl;
+    if (m_send_elapsed > 0) {
+      std::cout << "throughput: " << m_received / m_send_elapsed << " responses/s (target " << m_config.rate
+                << "/s)" << std::endl;
+    }
+    print_percentiles("latency", latency);
+  }
+
+  Config m_config;
+  client m_client;
+  std::vector<std::unique_ptr<Conn>> m_conns;
+  std::vector<std::pair<int, double>> m_mix;  // 归一化后的权重
+  std::unique_ptr<websocketpp::lib::asio::steady_timer> m_timer;
+
+  // 以下只在发送节拍中访问
+  std::mt19937 m_rng{12345};
+  std::uniform_real_distribution<double> m_uniform{0.0, 1.0};
+  Clock::time_point m_connect_begin;
+  Clock::time_point m_start;
+  Clock::time_point m_last_report;
+  Clock::time_point m_drain_start;
+  double m_send_elapsed = 0;
+  bool m_sending = false;
+  bool m_draining = false;
+  uint64_t m_scheduled = 0;
+  size_t m_next = 0;
+
+  // 每个 io 线程一个直方图, 下标 0 留给非 io 线程
+  std::vector<HdrHistogram> m_latency;
+  std::vector<HdrHistogram> m_setup;
+  std::atomic<uint64_t> m_opened{0};
+  std::atomic<uint64_t> m_connect_failed{0};
+  std::atomic<uint64_t> m_sent{0};
+  std::atomic<uint64_t> m_send_failed{0};
+  std::atomic<uint64_t> m_received{0};
+  std::atomic<uint64_t> m_errors{0};
+  std::atomic<uint64_t> m_lost{0};
+  std::atomic<uint64_t> m_foreign{0};
+};
+
+void usage(const char* name) {
+  std::cout << "usage: " << name << " [-u uri] [-c connections] [-r requests/s] [-d seconds] "
+            << "[-m cmd_type:weight,...] [-t threads]" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  Config config;
+  int opt;
+  while ((opt = getopt(argc, argv, "u:c:r:d:m:t:h")) != -1) {
+    switch (opt) {
+      case 'u':
+        config.uri = optarg;
+        break;
+      case 'c':
+        config.connections = strtoul(optarg, nullptr, 10);
+        break;
+      case 'r':
+        config.rate = atof(optarg);
+        break;
+      case 'd':
+        config.duration = atof(optarg);
+        break;
+      case 'm':
+        if (!parse_mix(optarg, config.mix)) {
+          std::cout << "invalid mix: " << optarg << std::endl;
+          return 1;
+        }
+        break;
+      case 't':
+        config.threads = strtoul(optarg, nullptr, 10);
+        break;
+      default:
+        usage(argv[0]);
+        return opt == 'h' ? 0 : 1;
+    }
+  }
+  if (config.connections == 0 || config.rate <= 0 || config.threads == 0) {
+    usage(argv[0]);
+    return 1;
+  }
+  LoadGenerator generator(config);
+  return generator.run();
+}
@@ -1,10 +1,11 @@
-#include <google/protobuf/util/json_util.h>
+#include <google/protobuf/arena.h>
 
+#include <algorithm>
 #include <iostream>
-#include <sstream>
 #include <string>
 #include <thread>
 
+#include "command_router.h"
 #include "nlohmann/json.hpp"
 #include "server.h"
 #include "test.pb.h"
@@ -31,109 +32,47 @@ using json = nlohmann::json;
 }
 */
 
-void msg_cb(WebsocketServer* server, std::string msg) {
-  std::cout << "in msg_cb" << std::endl;
-  json response;
-  json parsed_data;
-  try {
-    parsed_data = json::parse(msg);
-  } catch (nlohmann::detail::exception& e) {
-    response["cmd_type"] = 7;
-    response["msg"] = e.what();
-    for (auto const& ip : server->get_ips()) {
-      server->send_to_client(response.dump(), ip);
-    }
-    return;
-  }
+void msg_cb(WebsocketServer* server, const websocket_conn::CommandRouter* router, websocketpp::connection_hdl hdl,
+            std::string msg) {
+  std::string response = router->dispatch(hdl, msg);
+  if (!response.empty()) server->send(hdl, std::move(response));
+}
+
+/**
+ * @brief 注册各 cmd_type 的应答, 固定内容在此处序列化一次
+ *
+ */
+void register_commands(websocket_conn::CommandRouter& router, WebsocketServer& server) {
+  json ad_info_1 = {{"ad_id", 1}, {"ad_type", 0}, {"url", "url1"}, {"sec", 100}};
+  json ad_info_2 = {{"ad_id", 2}, {"ad_type", 1}, {"url", "url2"}, {"sec", 7}};
+  json ad_info_3 = {{"ad_id", 3}, {"ad_type", 2}, {"url", "url3"}, {"sec", 777}};
+
+  router.set_identify_cb([&server](const websocket_conn::CommandRouter::Request& request) {
+    server.bind_billboard(request.hdl, request.billboard_id);
+  });
   //回传
-  if (parsed_data.contains("debug")) {
-    response = parsed_data;
-    response.erase("debug");
-    for (auto const& ip : server->get_ips()) {
-      server->send_to_client(response.dump(), ip);
-    }
-    return;
-  }
+  router.route_field("debug", [](const websocket_conn::CommandRouter::Request& request) {
+    json body = request.body();
+    if (body.is_discarded()) return websocket_conn::CommandRouter::error_response("parse error");
+    body.erase("debug");
+    return body.dump();
+  });
 
-  if (!parsed_data.contains("billboard_id") || !parsed_data.contains("cmd_type")) {
-    for (auto const& ip : server->get_ips()) {
-      response["cmd_type"] = 7;
-      response["msg"] = "json must contains billboard_id cmd_type field";
-      server->send_to_client(response.dump(), ip);
-    }
-  } else {
-    try {
-      int cmd_type = parsed_data.at("cmd_type");
-    } catch (nlohmann::detail::exception& e) {
-      response["cmd_type"] = 7;
-      response["msg"] = e.what();
-      for (auto const& ip : server->get_ips()) {
-        server->send_to_client(response.dump(), ip);
-      }
+  router.route(1, json{{"ad_infos", {ad_info_1, ad_info_2, ad_info_3}}});
+  router.route(2, json{{"control_type", 4}, {"control_param", 50}});
+  router.route(3, json{{"volume", 0}, {"ad_infos", {ad_info_1}}});
+  router.route(4, json{{"url", "update_url"}});
+  router.route(5, json{{"billboard_main_status", 1}, {"billboard_base_status", 7}});
+  router.route(6, [](const websocket_conn::CommandRouter::Request& request,
+                     websocket_conn::CommandRouter::Response& response) {
+    const json& body = request.body();
+    auto code = body.find("code");
+    if (code == body.end()) {
+      response.fail("no code!!!");
       return;
     }
-    response["billboard_id"] = parsed_data.at("billboard_id");
-    json ad_info_1 = json::parse(R"(
-          {
-            "ad_id": 1,
-            "ad_type": 0,
-            "url": "url1",
-            "sec": 100
-          }
-        )");
-    json ad_info_2 = json::parse(R"(
-        {
-          "ad_id": 2,
-          "ad_type": 1,
-          "url": "url2",
-          "sec": 7
-        }
-        )");
-    json ad_info_3 = json::parse(R"(
-        {
-          "ad_id": 3,
-          "ad_type": 2,
-          "url": "url3",
-          "sec": 777
-        }
-        )");
-    response["cmd_type"] = parsed_data["cmd_type"];
-    switch (int(parsed_data.at("cmd_type"))) {
-      case 1:
-        response["ad_infos"] = {ad_info_1, ad_info_2, ad_info_3};
-        break;
-      case 2:
-        response["control_type"] = 4;
-        response["control_param"] = 50;
-        break;
-      case 3:
-        response["volume"] = 0;
-        response["ad_infos"] = {ad_info_1};
-        break;
-      case 4:
-        response["url"] = "update_url";
-        break;
-      case 5:
-        response["billboard_main_status"] = 1;
-        response["billboard_base_status"] = 7;
-        break;
-      case 6:
-        if (!parsed_data.contains("code")) {
-          response["cmd_type"] = 7;
-          response["msg"] = "no code!!!";
-        } else {
-          response["code"] = parsed_data.at("code");
-        }
-        break;
-      default:
-        response["cmd_type"] = 7;
-        response["msg"] = "invalid cmd";
-        break;
-    }
-    for (auto const& ip : server->get_ips()) {
-      server->send_to_client(response.dump(), ip);
-    }
-  }
+    response.set("code", *code);
+  });
 }
 
 void serverThread() {
@@ -153,32 +92,26 @@ void serverThread() {
   std::cout << "age: " << parsed_data["age"] << std::endl;
   std::cout << "id: " << parsed_data["id"] << std::endl;
 
-  // test proto
-  test::People person;
-  person.set_name("caofangyu");
-  person.set_age("26");
-  person.set_id(777);
-
-  WebsocketServer server;
-  server.set_message_cb(std::bind(msg_cb, &server, std::placeholders::_1));
+  WebsocketServer::Options options;
+  options.io_threads = std::max(2u, std::thread::hardware_concurrency() / 2);
+  options.handler_threads = 2;
+  WebsocketServer server(options);
+  websocket_conn::CommandRouter router;
+  register_commands(router, server);
+  server.set_message_cb(std::bind(msg_cb, &server, &router, std::placeholders::_1, std::placeholders::_2));
   server.run(9002);
   int n = 0;
-  std::stringstream ss;
   while (++n) {
-    // nlohmann json test
-    // data["seq"] = n;
-    // server.send_to_client(data.dump(), "127.0.0.1");
-
-    // proto
-    person.set_seq(n);
-    std::string person_json;
-    google::protobuf::util::MessageToJsonString(person, &person_json);
-    // server.send_to_client(person_json, "127.0.0.1");
+    // proto: proto 子协议的连接收二进制帧, 其他连接收转换后的 json, 每种编码只序列化一次
+    google::protobuf::Arena arena;
+    test::People* person = google::protobuf::Arena::CreateMessage<test::People>(&arena);
+    person->set_name("caofangyu");
+    person->set_age("26");
+    person->set_id(777);
+    person->set_seq(n);
+    server.broadcast(*person);
 
-    // std::cout << ss.str() << std::endl;
-    // server.send_to_client(data.dump(), "192.168.3.66");
     std::this_thread::sleep_for(std::chrono::seconds(5));
-    ss.str("");
   };
 }
 
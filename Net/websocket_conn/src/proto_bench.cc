@@ -0,0 +1,136 @@
+/**
+ * @file proto_bench.cc
+ * @author caofangyu (caofy@antwork.link)
+ * @brief  json 与 protobuf 子协议的序列化耗时和报文大小对比
+ * @version 0.1
+ * @date 2023-11-07
+ *
+ * 用法: proto_bench [rounds]
+ *
+ * 负载为 People 和带不同广告条数的 BillboardReply, 每轮都从头构建消息再序列化:
+ *   nlohmann      nlohmann::json 构建并 dump (现有 json 应答的做法)
+ *   pb->json      protobuf 消息经 MessageToJsonString 转换 (json 连接收到的内容)
+ *   pb heap       堆上构建 protobuf 消息并 SerializeToString
+ *   pb arena      Arena 上构建 protobuf 消息并 SerializeToString
+ * 大小一栏为原始长度/permessage-deflate 压缩后长度
+ *
+ * Copyright (c) 2015-2022 Xunyi Ltd. All rights reserved.
+ *
+ */
+
+#include <google/protobuf/arena.h>
+#include <google/protobuf/util/json_util.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "deflate_extension.h"
+#include "nlohmann/json.hpp"
+#include "test.pb.h"
+
+using json = nlohmann::json;
+
+namespace {
+
+std::string ad_url(int id) { return "http://cdn.example.com/ad/" + std::to_string(id) + ".mp4"; }
+
+json reply_json(int ads) {
+  json reply;
+  reply["billboard_id"] = "bb-000123";
+  reply["cmd_type"] = 1;
+  reply["ad_infos"] = json::array();
+  for (int i = 0; i < ads; ++i) {
+    reply["ad_infos"].push_back({{"ad_id", i}, {"ad_type", i % 3}, {"url", ad_url(i)}, {"sec", 5 + i * 7 % 120}});
+  }
+  return reply;
+}
+
+void fill_reply(test::BillboardReply* reply, int ads) {
+  reply->set_billboard_id("bb-000123");
+  reply->set_cmd_type(1);
+  for (int i = 0; i < ads; ++i) {
+    test::AdInfo* ad = reply->add_ad_infos();
+    ad->set_ad_id(i);
+    ad->set_ad_type(i % 3);
+    ad->set_url(ad_url(i));
+    ad->set_sec(5 + i * 7 % 120);
+  }
+}
+
+json people_json(int seq) { return {{"name", "caofangyu"}, {"age", "26"}, {"id", 777}, {"seq", seq}}; }
+
+void fill_people(test::People* person, int seq) {
+  person->set_name("caofangyu");
+  person->set_age("26");
+  person->set_id(777);
+  person->set_seq(seq);
+}
+
+size_t deflated(const std::string& data) {
+  std::string out;
+  websocket_conn::DeflatePool::instance().compress(data.data(), data.size(), out, 15);
+  return out.size() - 4;
+}
+
+double time_us(int rounds, const std::function<void(int)>& fn) {
+  auto begin = std::chrono::steady_clock::now();
+  for (int i = 0; i < rounds; ++i) fn(i);
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count() / rounds;
+}
+
+template <typename Msg>
+void run(const std::string& name, int rounds, const std::function<json(int)>& make_json,
+         const std::function<void(Msg*, int)>& fill) {
+  std::string out;
+  const double t_nlohmann = time_us(rounds, [&](int i) { out = make_json(i).dump(); });
+  const std::string json_text = out;
+
+  const double t_pb_json = time_us(rounds, [&](int i) {
+    Msg msg;
+    fill(&msg, i);
+    out.clear();
+    google::protobuf::util::MessageToJsonString(msg, &out);
+  });
+  const std::string pb_json_text = out;
+
+  const double t_heap = time_us(rounds, [&](int i) {
+    Msg msg;
+    fill(&msg, i);
+    msg.SerializeToString(&out);
+  });
+
+  const double t_arena = time_us(rounds, [&](int i) {
+    google::protobuf::Arena arena;
+    Msg* msg = google::protobuf::Arena::CreateMessage<Msg>(&arena);
+    fill(msg, i);
+    msg->SerializeToString(&out);
+  });
+  const std::string binary = out;
+
+  auto size = [](const std::string& data) { return std::to_string(data.size()) + "/" + std::to_string(deflated(data)); };
+  std::cout << std::left << std::setw(18) << name << std::right << std::fixed << std::setprecision(2) << std::setw(10)
+            << t_nlohmann << std::setw(10) << t_pb_json << std::setw(10) << t_heap << std::setw(10) << t_arena
+            << std::setw(14) << size(json_text) << std::setw(14) << size(pb_json_text) << std::setw(14)
+            << size(binary) << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const int rounds = argc > 1 ? atoi(argv[1]) : 20000;
+  std::cout << std::left << std::setw(18) << "payload (us)" << std::right << std::setw(10) << "nlohmann"
+            << std::setw(10) << "pb->json" << std::setw(10) << "pb heap" << std::setw(10) << "pb arena"
+            << std::setw(14) << "json B" << std::setw(14) << "pb->json B" << std::setw(14) << "proto B" << std::endl;
+
+  run<test::People>("People", rounds, people_json, fill_people);
+  for (int ads : {3, 20, 100}) {
+    run<test::BillboardReply>(
+        "reply(" + std::to_string(ads) + " ads)", rounds, [ads](int) { return reply_json(ads); },
+        [ads](test::BillboardReply* reply, int) { fill_reply(reply, ads); });
+  }
+  return 0;
+}
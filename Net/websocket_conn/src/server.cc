@@ -1,92 +1,440 @@
 #include "server.h"
+
+#include <google/protobuf/util/json_util.h>
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
 #include "util.h"
 
-WebsocketServer::WebsocketServer() : m_message_cb(nullptr), m_close_cb(nullptr), m_open_cb(nullptr) {
-  // Set logging settings
-  m_server.set_access_channels(websocketpp::log::alevel::all);
-  m_server.clear_access_channels(websocketpp::log::alevel::frame_payload);
+WebsocketServer::WebsocketServer() : WebsocketServer(Options()) {}
+
+WebsocketServer::WebsocketServer(const Options& options)
+    : m_message_cb(nullptr),
+      m_close_cb(nullptr),
+      m_open_cb(nullptr),
+      m_options(options),
+      m_max_queued_bytes(4 * 1024 * 1024),
+      m_dropped_slow_clients(0),
+      m_reaped_connections(0) {
+  // Set logging settings, 只记录连接建立/断开/失败, 不记录逐帧日志
+  m_server.set_access_channels(websocketpp::log::alevel::connect | websocketpp::log::alevel::disconnect |
+                               websocketpp::log::alevel::fail);
+  // 压缩参数对所有连接生效
+  websocket_conn::DeflateSettings& deflate = websocket_conn::deflate_settings();
+  deflate.enabled = m_options.enable_deflate;
+  deflate.server_max_window_bits = std::min(std::max(m_options.deflate_window_bits, 9), 15);
   // Initialize Asio
   m_server.init_asio();
   // Register handler
   m_server.set_message_handler(
       std::bind(&WebsocketServer::on_message, this, std::placeholders::_1, std::placeholders::_2));
+  m_server.set_validate_handler(std::bind(&WebsocketServer::on_validate, this, std::placeholders::_1));
   m_server.set_open_handler(std::bind(&WebsocketServer::on_open, this, std::placeholders::_1));
   m_server.set_close_handler(std::bind(&WebsocketServer::on_close, this, std::placeholders::_1));
+  m_server.set_pong_handler(
+      std::bind(&WebsocketServer::on_pong, this, std::placeholders::_1, std::placeholders::_2));
+  // 时间轮的 tick 取最短超时的 1/10, 限制在 10ms~1s, 超时判断的误差不超过一个 tick
+  int64_t shortest = std::numeric_limits<int64_t>::max();
+  for (int64_t ms : {m_options.ping_interval_ms, m_options.pong_timeout_ms, m_options.idle_timeout_ms}) {
+    if (ms > 0) shortest = std::min(shortest, ms);
+  }
+  m_heartbeat_tick_us = std::min<int64_t>(std::max<int64_t>(shortest / 10, 10), 1000) * 1000;
 }
 
-void WebsocketServer::send_to_client(std::string message, std::string ip) {
-  std::cout << "send to client " << ip << std::endl;
-  if (ip_connection_map.find(ip) == ip_connection_map.end()) {
-    std::cout << "Invalid ip: " << ip << std::endl;
-    return;
+namespace {
+
+/**
+ * @brief 取对端ip, 直接读套接字地址, ipv4映射地址转为点分格式
+ *
+ */
+std::string remote_ip(const server::connection_ptr& con) {
+  websocketpp::lib::asio::error_code ec;
+  auto endpoint = con->get_raw_socket().remote_endpoint(ec);
+  if (ec) return websocket_conn::get_ip_from_str(con->get_remote_endpoint());
+  auto address = endpoint.address();
+  if (address.is_v6() && address.to_v6().is_v4_mapped()) {
+    return websocketpp::lib::asio::ip::make_address_v4(websocketpp::lib::asio::ip::v4_mapped, address.to_v6())
+        .to_string();
   }
-  server::connection_ptr con = ip_connection_map[ip];
-  auto hdl = con->get_handle();
+  return address.to_string();
+}
+
+int64_t now_us() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+bool WebsocketServer::check_queue(const session_registry::SessionPtr& session) {
+  const size_t limit = m_max_queued_bytes;
+  if (limit == 0 || session->con->get_buffered_amount() <= limit) return true;
+  // 慢客户端: 关闭连接, 关闭帧排在已缓存数据之后, 对端不读时由关闭握手超时断开
   std::error_code ec;
-  m_server.send(hdl, message.c_str(), message.size(), websocketpp::frame::opcode::TEXT, ec);
-  if (ec) {
+  session->con->close(websocketpp::close::status::try_again_later, "send queue full", ec);
+  if (!ec) {
+    ++m_dropped_slow_clients;
+    std::cout << "drop slow client: " << session->ip << " queued " << session->con->get_buffered_amount()
+              << std::endl;
+  }
+  return false;
+}
+
+int WebsocketServer::deflate_bits_for(const session_registry::SessionPtr& session, size_t size) const {
+  return size >= m_options.compress_threshold ? session->data.deflate_bits : 0;
+}
+
+server::message_ptr WebsocketServer::prepare_frame(const server::connection_ptr& con, std::string_view message,
+                                                   websocketpp::frame::opcode::value op, int deflate_bits) {
+  // 服务端发出的帧不加掩码, 且压缩不接管上下文, 同样窗口下帧头和负载对所有连接都相同, 可以直接标记为已组帧
+  server::message_ptr frame = con->get_message(op, message.size());
+  std::string& payload = frame->get_raw_payload();
+  bool compressed = false;
+  if (deflate_bits > 0 && websocket_conn::DeflatePool::instance().compress(message.data(), message.size(), payload,
+                                                                           deflate_bits)) {
+    // 去掉 00 00 ff ff 结尾
+    payload.resize(payload.size() - 4);
+    compressed = true;
+  } else {
+    payload.assign(message.data(), message.size());
+  }
+  finish_frame(frame, op, compressed);
+  return frame;
+}
+
+server::message_ptr WebsocketServer::prepare_frame(const server::connection_ptr& con, std::string&& message,
+                                                   websocketpp::frame::opcode::value op, int deflate_bits) {
+  if (deflate_bits > 0) return prepare_frame(con, std::string_view(message), op, deflate_bits);
+  // 不压缩时直接接管调用方的缓冲区, 不复制负载
+  server::message_ptr frame = con->get_message(op, 0);
+  frame->get_raw_payload() = std::move(message);
+  finish_frame(frame, op, false);
+  return frame;
+}
+
+void WebsocketServer::finish_frame(const server::message_ptr& frame, websocketpp::frame::opcode::value op,
+                                   bool compressed) {
+  const size_t size = frame->get_payload().size();
+  websocketpp::frame::basic_header header(op, size, true, false, compressed);
+  websocketpp::frame::extended_header ext(size);
+  frame->set_header(websocketpp::frame::prepare_header(header, ext));
+  frame->set_prepared(true);
+}
+
+bool WebsocketServer::send(const session_registry::SessionPtr& session, const server::message_ptr& frame) {
+  if (!check_queue(session)) return false;
+  std::error_code ec = session->con->send(frame);
+  if (!ec) return true;
+  // 正在关闭的连接(如刚被判为慢客户端)不再记录
+  if (ec != websocketpp::error::make_error_code(websocketpp::error::invalid_state)) {
     std::cout << "server send error: " << ec.message() << std::endl;
   }
+  return false;
+}
+
+size_t WebsocketServer::send_all(const std::vector<session_registry::SessionPtr>& sessions, std::string_view message,
+                                 websocketpp::frame::opcode::value op) {
+  // 按压缩窗口分组, 每组只压缩和组帧一次; 帧从第一个连接的消息池中取, 所有连接共享
+  server::message_ptr frames[16];
+  size_t sent = 0;
+  for (auto const& session : sessions) {
+    const int bits = deflate_bits_for(session, message.size());
+    if (!frames[bits]) frames[bits] = prepare_frame(session->con, message, op, bits);
+    if (send(session, frames[bits])) ++sent;
+  }
+  return sent;
+}
+
+size_t WebsocketServer::send_all(const std::vector<session_registry::SessionPtr>& sessions,
+                                 const google::protobuf::Message& message) {
+  std::vector<session_registry::SessionPtr> groups[2];
+  for (auto const& session : sessions) groups[session->data.encoding == Encoding::kProto].push_back(session);
+  size_t sent = 0;
+  if (!groups[1].empty()) {
+    std::string binary;
+    if (message.SerializeToString(&binary)) {
+      sent += send_all(groups[1], binary, websocketpp::frame::opcode::BINARY);
+    } else {
+      std::cout << "serialize " << message.GetTypeName() << " failed" << std::endl;
+    }
+  }
+  if (!groups[0].empty()) {
+    std::string text;
+    if (google::protobuf::util::MessageToJsonString(message, &text).ok()) {
+      sent += send_all(groups[0], text, websocketpp::frame::opcode::TEXT);
+    } else {
+      std::cout << "convert " << message.GetTypeName() << " to json failed" << std::endl;
+    }
+  }
+  return sent;
+}
+
+size_t WebsocketServer::broadcast(const google::protobuf::Message& message) {
+  return send_all(m_sessions.snapshot(), message);
+}
+
+size_t WebsocketServer::publish(const std::string& topic, const google::protobuf::Message& message) {
+  return send_all(m_sessions.find_by_topic(topic), message);
+}
+
+bool WebsocketServer::send(websocketpp::connection_hdl hdl, const google::protobuf::Message& message) {
+  auto session = m_sessions.find(session_registry::key_of(hdl));
+  if (!session) return false;
+  return send_all({session}, message) == 1;
+}
+
+size_t WebsocketServer::broadcast(std::string_view message, websocketpp::frame::opcode::value op) {
+  return send_all(m_sessions.snapshot(), message, op);
+}
+
+size_t WebsocketServer::publish(const std::string& topic, std::string_view message,
+                                websocketpp::frame::opcode::value op) {
+  return send_all(m_sessions.find_by_topic(topic), message, op);
+}
+
+void WebsocketServer::subscribe(websocketpp::connection_hdl hdl, const std::string& topic) {
+  m_sessions.subscribe(session_registry::key_of(hdl), topic);
+}
+
+void WebsocketServer::unsubscribe(websocketpp::connection_hdl hdl, const std::string& topic) {
+  m_sessions.unsubscribe(session_registry::key_of(hdl), topic);
+}
+
+bool WebsocketServer::send(websocketpp::connection_hdl hdl, std::string_view message,
+                           websocketpp::frame::opcode::value op) {
+  auto session = m_sessions.find(session_registry::key_of(hdl));
+  if (!session) return false;
+  return send(session, prepare_frame(session->con, message, op, deflate_bits_for(session, message.size())));
+}
+
+bool WebsocketServer::send(websocketpp::connection_hdl hdl, std::string&& message,
+                           websocketpp::frame::opcode::value op) {
+  auto session = m_sessions.find(session_registry::key_of(hdl));
+  if (!session) return false;
+  const int bits = deflate_bits_for(session, message.size());
+  return send(session, prepare_frame(session->con, std::move(message), op, bits));
+}
+
+void WebsocketServer::send_to_client(std::string_view message, const std::string& ip) {
+  auto sessions = m_sessions.find_by_ip(ip);
+  if (sessions.empty()) {
+    std::cout << "Invalid ip: " << ip << std::endl;
+    return;
+  }
+  send_all(sessions, message, websocketpp::frame::opcode::TEXT);
+}
+
+size_t WebsocketServer::send_to_billboard(std::string_view message, const std::string& billboard_id) {
+  return send_all(m_sessions.find_by_billboard(billboard_id), message, websocketpp::frame::opcode::TEXT);
+}
+
+void WebsocketServer::bind_billboard(websocketpp::connection_hdl hdl, const std::string& billboard_id) {
+  m_sessions.bind_billboard(session_registry::key_of(hdl), billboard_id);
 }
 
 void WebsocketServer::on_message(websocketpp::connection_hdl hdl, server::message_ptr msg) {
   std::cout << "on_message called with hdl: " << hdl.lock().get() << " and message: " << msg->get_payload()
             << std::endl;
 
-  server::connection_ptr con = m_server.get_con_from_hdl(hdl);
+  auto session = m_sessions.find(session_registry::key_of(hdl));
+  if (session) session->data.liveness->last_message_us = now_us();
   // Check for a special command to instruct the server to stop listening so it can be cleanly exited.
   if (msg->get_payload() == "stop-listening") {
     m_server.stop_listening();
     return;
   }
-  if (m_message_cb) {
-    m_message_cb(msg->get_payload());
+  if (!m_message_cb) return;
+  if (m_options.handler_threads == 0) {
+    m_message_cb(hdl, std::move(msg->get_raw_payload()));
+    return;
+  }
+  if (!session) return;
+  // 交给处理线程池, 慢回调不阻塞网络线程; 同一连接的消息经 strand 保持顺序
+  session->data.handler_strand->post([this, hdl, msg]() { m_message_cb(hdl, std::move(msg->get_raw_payload())); });
+}
+
+bool WebsocketServer::on_validate(websocketpp::connection_hdl hdl) {
+  // 按客户端列出的顺序取第一个支持的子协议, 都不支持时不选, 按 json 处理
+  auto con = m_server.get_con_from_hdl(hdl);
+  for (auto const& protocol : con->get_requested_subprotocols()) {
+    if (protocol == kJsonSubprotocol || (protocol == kProtoSubprotocol && m_options.enable_proto)) {
+      con->select_subprotocol(protocol);
+      break;
+    }
   }
+  return true;
 }
 
 void WebsocketServer::on_open(websocketpp::connection_hdl hdl) {
   auto con = m_server.get_con_from_hdl(hdl);
-  std::string ip = websocket_conn::get_ip_from_str(con->get_remote_endpoint());
-  if (ip_connection_map.find(ip) != ip_connection_map.end()) {
-    std::cout << "Duplicate connection from:" << ip << std::endl;
-    std::cout << "Replace original conn:" << ip_connection_map[ip] << std::endl;
-  } else {
-    std::cout << "New connection from: " << ip << std::endl;
+  std::string ip = remote_ip(con);
+  std::cout << "New connection from: " << ip << std::endl;
+  SessionData data;
+  data.deflate_bits = websocket_conn::negotiated_deflate_bits(con->get_response_header("Sec-WebSocket-Extensions"));
+  data.encoding = con->get_subprotocol() == kProtoSubprotocol ? Encoding::kProto : Encoding::kJson;
+  if (m_options.handler_threads > 0) {
+    data.handler_strand = std::make_shared<websocketpp::lib::asio::io_service::strand>(m_handler_service);
+  }
+  const int64_t now = now_us();
+  data.liveness->last_message_us = now;
+  data.liveness->next_ping_us = now + m_options.ping_interval_ms * 1000;
+  m_sessions.add(hdl, con, ip, std::move(data));
+  // 第一次检查在发 ping 或空闲超时的时间点, 之后由检查结果决定下一次
+  int64_t first_check = std::numeric_limits<int64_t>::max();
+  for (int64_t ms : {m_options.ping_interval_ms, m_options.idle_timeout_ms}) {
+    if (ms > 0) first_check = std::min(first_check, ms * 1000);
   }
-  ip_connection_map[ip] = con;
-  std::cout << "current connection: " << ip_connection_map.size() << std::endl;
+  if (first_check != std::numeric_limits<int64_t>::max()) schedule_check(session_registry::key_of(hdl), first_check);
+  std::cout << "current connection: " << m_sessions.size() << std::endl;
   if (m_open_cb) m_open_cb();
 }
 
 void WebsocketServer::on_close(websocketpp::connection_hdl hdl) {
-  auto con = m_server.get_con_from_hdl(hdl);
-  for (auto it = ip_connection_map.begin(); it != ip_connection_map.end();) {
-    if (it->second == con) {
-      it = ip_connection_map.erase(it);
-    } else {
-      ++it;
+  m_heartbeat_wheel.cancel(session_registry::key_of(hdl));
+  m_sessions.remove(session_registry::key_of(hdl));
+  std::cout << "current connection: " << m_sessions.size() << std::endl;
+  if (m_close_cb) m_close_cb();
+}
+
+void WebsocketServer::on_pong(websocketpp::connection_hdl hdl, std::string payload) {
+  auto session = m_sessions.find(session_registry::key_of(hdl));
+  if (!session) return;
+  // 负载是 ping 的发送时间, 只认与未应答 ping 相同的 pong, 客户端主动发的 pong 忽略
+  Liveness& liveness = *session->data.liveness;
+  int64_t sent = liveness.ping_sent_us;
+  if (sent == 0 || strtoll(payload.c_str(), nullptr, 10) != sent) return;
+  if (!liveness.ping_sent_us.compare_exchange_strong(sent, 0)) return;
+  const int64_t rtt = now_us() - sent;
+  liveness.rtt_us = rtt;
+  std::lock_guard<std::mutex> lock(m_rtt_mutex);
+  m_rtt_histogram.record(static_cast<uint64_t>(std::max<int64_t>(rtt, 0)));
+}
+
+int64_t WebsocketServer::rtt_us(websocketpp::connection_hdl hdl) const {
+  auto session = m_sessions.find(session_registry::key_of(hdl));
+  return session ? session->data.liveness->rtt_us.load() : -1;
+}
+
+websocket_conn::HdrHistogram WebsocketServer::rtt_histogram() const {
+  std::lock_guard<std::mutex> lock(m_rtt_mutex);
+  return m_rtt_histogram;
+}
+
+void WebsocketServer::schedule_check(session_registry::Key key, int64_t delay_us) {
+  const int64_t ticks = (std::max<int64_t>(delay_us, 0) + m_heartbeat_tick_us - 1) / m_heartbeat_tick_us;
+  m_heartbeat_wheel.schedule(key, static_cast<uint64_t>(ticks));
+}
+
+void WebsocketServer::reap(const session_registry::SessionPtr& session, const std::string& reason) {
+  // 对端已失联时关闭握手会超时, 由 websocketpp 在 close 超时后断开
+  std::error_code ec;
+  session->con->close(websocketpp::close::status::going_away, reason, ec);
+  if (ec) return;
+  ++m_reaped_connections;
+  std::cout << "reap connection: " << session->ip << " " << reason << std::endl;
+}
+
+void WebsocketServer::check_liveness(session_registry::Key key, int64_t now) {
+  auto session = m_sessions.find(key);
+  if (!session) return;
+  Liveness& liveness = *session->data.liveness;
+  const int64_t pong_timeout = m_options.pong_timeout_ms * 1000;
+  const int64_t idle_timeout = m_options.idle_timeout_ms * 1000;
+
+  const int64_t ping_sent = liveness.ping_sent_us;
+  if (ping_sent > 0 && pong_timeout > 0 && now - ping_sent >= pong_timeout) {
+    reap(session, "pong timeout");
+    return;
+  }
+  if (idle_timeout > 0 && now - liveness.last_message_us >= idle_timeout) {
+    reap(session, "idle timeout");
+    return;
+  }
+
+  int64_t next = idle_timeout > 0 ? liveness.last_message_us + idle_timeout - now
+                                  : std::numeric_limits<int64_t>::max();
+  if (m_options.ping_interval_ms > 0) {
+    if (ping_sent == 0 && now >= liveness.next_ping_us) {
+      // 上一个 ping 已应答才发下一个, 负载带发送时间, 应答到达时据此计算往返时延
+      liveness.ping_sent_us = now;
+      std::error_code ec;
+      session->con->ping(std::to_string(now), ec);
+      if (ec) return;  // 连接正在关闭, 由 on_close 清理
+      liveness.next_ping_us = now + m_options.ping_interval_ms * 1000;
     }
+    const int64_t outstanding = liveness.ping_sent_us;
+    if (outstanding > 0 && pong_timeout > 0) next = std::min(next, outstanding + pong_timeout - now);
+    next = std::min(next, liveness.next_ping_us - now);
   }
-  std::cout << "current connection: " << ip_connection_map.size() << std::endl;
-  if (m_close_cb) m_close_cb();
+  if (next != std::numeric_limits<int64_t>::max()) schedule_check(key, next);
+}
+
+void WebsocketServer::on_heartbeat_tick(const std::error_code& ec) {
+  if (ec) return;
+  // 按实际经过的时间推进, 网络线程繁忙导致定时器迟到时补齐错过的 tick
+  const int64_t now = now_us();
+  std::vector<session_registry::Key> expired;
+  while (m_heartbeat_next_tick_us <= now) {
+    std::vector<session_registry::Key> keys = m_heartbeat_wheel.advance();
+    expired.insert(expired.end(), keys.begin(), keys.end());
+    m_heartbeat_next_tick_us += m_heartbeat_tick_us;
+  }
+  for (session_registry::Key key : expired) check_liveness(key, now);
+
+  m_heartbeat_timer->expires_after(std::chrono::microseconds(m_heartbeat_next_tick_us - now));
+  m_heartbeat_timer->async_wait(std::bind(&WebsocketServer::on_heartbeat_tick, this, std::placeholders::_1));
+}
+
+void WebsocketServer::start_heartbeat() {
+  if (m_options.ping_interval_ms <= 0 && m_options.idle_timeout_ms <= 0) return;
+  m_heartbeat_timer.reset(new websocketpp::lib::asio::steady_timer(m_server.get_io_service()));
+  m_heartbeat_next_tick_us = now_us() + m_heartbeat_tick_us;
+  m_heartbeat_timer->expires_after(std::chrono::microseconds(m_heartbeat_tick_us));
+  m_heartbeat_timer->async_wait(std::bind(&WebsocketServer::on_heartbeat_tick, this, std::placeholders::_1));
 }
 
 void WebsocketServer::run(uint16_t port) {
   // Listen on specified port number
   std::cout << "server run in port: " << port << std::endl;
+  // 大量广告牌同时重连时避免 accept 队列溢出
+  m_server.set_listen_backlog(websocketpp::lib::asio::socket_base::max_listen_connections);
   m_server.listen(port);
   // Start the server accept loop
   m_server.start_accept();
+  start_heartbeat();
   // Start the ASIO io_service run loop
-  std::thread run_thread(&server::run, &m_server);
-  run_thread.detach();
-  // m_server.run();
+  if (m_options.handler_threads > 0) {
+    m_handler_work.reset(new websocketpp::lib::asio::io_service::work(m_handler_service));
+    for (size_t i = 0; i < m_options.handler_threads; ++i) {
+      m_handler_threads.emplace_back([this]() { m_handler_service.run(); });
+    }
+  }
+  for (size_t i = 0; i < std::max<size_t>(m_options.io_threads, 1); ++i) {
+    m_io_threads.emplace_back(&server::run, &m_server);
+  }
 }
 
-std::vector<std::string> WebsocketServer::get_ips() {
-  std::vector<std::string> ips;
-  for (auto const& pair : ip_connection_map) {
-    ips.emplace_back(pair.first);
+void WebsocketServer::stop() {
+  std::error_code ec;
+  if (m_server.is_listening()) m_server.stop_listening(ec);
+  m_server.stop();
+  for (auto& t : m_io_threads) {
+    if (t.joinable()) t.join();
+  }
+  m_io_threads.clear();
+  m_heartbeat_timer.reset();
+  m_handler_work.reset();
+  m_handler_service.stop();
+  for (auto& t : m_handler_threads) {
+    if (t.joinable()) t.join();
   }
-  return ips;
-}
\ No newline at end of file
+  m_handler_threads.clear();
+}
+
+WebsocketServer::~WebsocketServer() { stop(); }
+
+std::vector<std::string> WebsocketServer::get_ips() { return m_sessions.ips(); }
\ No newline at end of file
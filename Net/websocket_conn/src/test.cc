@@ -10,6 +10,8 @@ bool condition = false;
 void serverThread() {
   WebsocketServer server;
   server.run(9002);
+  // 服务端在析构时停止, 保持存活
+  while (true) std::this_thread::sleep_for(std::chrono::seconds(1));
 }
 
 void clientThread() {
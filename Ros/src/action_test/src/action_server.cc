@@ -5,45 +5,76 @@
 #include <actionlib/server/simple_action_server.h>
 #include <cfy/FocusAdjustAction.h>
 
+#include "gimbal_channel.h"
 #include "mapping.h"
 #include "tcp.h"
 
-using namespace flight_brain::mountable;
+using namespace flight_brain::conn;
 
 typedef actionlib::SimpleActionServer<cfy::FocusAdjustAction> Server;
 
 void execute(const cfy::FocusAdjustGoalConstPtr& goal,
              Server* as,
-             std::shared_ptr<ConnTcpClient>& client)  // Note: "Action" is not appended to DoDishes here
+             pinling::GimbalChannel* channel)  // Note: "Action" is not appended to DoDishes here
 {
   // Do lots of awesome groundbreaking robot stuff here
 
   uint8_t cmd = goal->focus_adjust_cmd;
   std::cout << "cmd: " << int(cmd) << std::endl;
+  auto it = focus_map.find(cmd);
+  // 品灵c1包只有变焦速度, 没有目标倍数字段, 倍数模式无法下发
+  if (it == focus_map.end() || cmd == cfy::FocusAdjustGoal::FOCUS_ADJUST_ZOOM_TO) {
+    as->setAborted(cfy::FocusAdjustResult(), "unsupported focus_adjust_cmd");
+    printf("execute aborted\n");
+    return;
+  }
+
+  // 只有档位模式的param是速度档位(1~7), 其他指令不带速度
+  uint8_t zoom_speed = 0;
+  switch (cmd) {
+    case cfy::FocusAdjustGoal::FOCUS_ADJUST_CONT_ZOOM_IN:
+    case cfy::FocusAdjustGoal::FOCUS_ADJUST_CONT_ZOOM_OUT:
+    case cfy::FocusAdjustGoal::FOCUS_ADJUST_ZOOM_IN:
+    case cfy::FocusAdjustGoal::FOCUS_ADJUST_ZOOM_OUT:
+      if (goal->param < 1 || goal->param > 7) {
+        as->setAborted(cfy::FocusAdjustResult(), "param must be a speed level of 1~7");
+        printf("execute aborted\n");
+        return;
+      }
+      zoom_speed = goal->param;
+      break;
+    default:
+      break;
+  }
+
   cfy::FocusAdjustResult result_;
-  result_.result = focus_map[cmd];
-  //client->send_bytes((void*)&result_, sizeof(result_));
-  client->send_bytes((void*)&cmd, sizeof(cmd));
+  result_.result = it->second;
+  // 只更新期望的相机指令, 由控制节拍合并后按限频发出
+  channel->setCameraCmd(result_.result, zoom_speed);
   as->setSucceeded();
   printf("execute done\n");
 }
 
-void on_receive(char* data, size_t len) {
-  std::string msg(data, len);
-  std::cout << "receive: " << msg << std::endl;
-}
-
 int main(int argc, char** argv) {
   printf("ros init\n");
   ros::init(argc, argv, "focus_server");
   ros::NodeHandle n;
   //client
-  std::shared_ptr<ConnTcpClient> client = std::make_shared<ConnTcpClient>();
-  // client->set_receive_callback(&on_receive);
+  ConnInterface::Ptr client = std::make_shared<ConnTcpClient>();
+  // 上一帧还在发送时本拍不写, 避免在发送队列中堆积
+  pinling::GimbalChannel channel([&client](const uint8_t* data, size_t len) {
+    if (!client->is_open() || client->tx_busy()) return false;
+    client->send_bytes(data, len);
+    return true;
+  });
+  client->set_receive_callback(
+      [&channel](char* data, size_t len) { channel.onReceive(reinterpret_cast<const uint8_t*>(data), len); });
   client->connect();
+  client->run_every(std::chrono::duration_cast<std::chrono::milliseconds>(channel.period()).count(),
+                    [&channel]() { channel.tick(); });
   client->run();
   printf("init server\n");
-  Server server(n, "focus", boost::bind(&execute, _1, &server, client), false);
+  Server server(n, "focus", boost::bind(&execute, _1, &server, &channel), false);
   printf("start server\n");
   server.start();
   printf("ros spin\n");
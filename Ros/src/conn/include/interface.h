@@ -106,6 +106,12 @@ class ConnInterface {
     virtual void send_message(const std::string &message) = 0;
     virtual void send_bytes(const void *data, size_t len) = 0;
 
+    /**
+     * @brief 是否有数据正在发送(异步写尚未完成)
+     *
+     */
+    bool tx_busy() const { return tx_in_progress_; }
+
 
     void run_every(const uint64_t timeout_ms, TimerCallback cb);
 
@@ -0,0 +1,354 @@
+/**
+ * @file file_copy.cpp
+ * @author caofangyu (caofy@antwork.link)
+ * @brief 上传前暂存文件用的拷贝: io_uring -> copy_file_range -> read/write
+ * @version 0.1
+ * @date 2024-03-06
+ *
+ * Copyright (c) 2015-2024 Xunyi Ltd. All rights reserved.
+ *
+ */
+
+#include "file_copy.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+// 不依赖liburing，直接用内核头文件和系统调用；注册文件和缓冲区从第一个有io_uring的内核(5.1)就有
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#ifdef __NR_io_uring_setup
+#define HAVE_IO_URING 1
+#endif
+#endif
+#endif
+
+namespace {
+
+const size_t kChunk = 1 << 20;
+const unsigned kDepth = 4;
+
+class ScopedFd {
+   public:
+    explicit ScopedFd(int fd) : fd_(fd) {}
+    ~ScopedFd() {
+        if (fd_ >= 0) {
+            int err = errno;
+            ::close(fd_);
+            errno = err;
+        }
+    }
+    int get() const { return fd_; }
+    int close() {
+        int ret = ::close(fd_);
+        fd_ = -1;
+        return ret;
+    }
+
+   private:
+    int fd_;
+};
+
+#ifdef HAVE_IO_URING
+
+/**
+ * @brief 拷贝用的最小io_uring封装
+ *
+ * 同时在路上的请求不超过队列长度，所以取sqe时不用处理提交队列满
+ */
+class Uring {
+   public:
+    ~Uring() {
+        if (sqes_ != nullptr) {
+            munmap(sqes_, sqes_size_);
+        }
+        if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+            munmap(cq_ring_, cq_ring_size_);
+        }
+        if (sq_ring_ != nullptr) {
+            munmap(sq_ring_, sq_ring_size_);
+        }
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+    }
+
+    bool init(unsigned entries) {
+        io_uring_params p;
+        memset(&p, 0, sizeof(p));
+        fd_ = syscall(__NR_io_uring_setup, entries, &p);
+        if (fd_ < 0) {
+            return false;
+        }
+
+        sq_ring_size_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cq_ring_size_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        const bool single_mmap = p.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap) {
+            sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+        }
+        sq_ring_ = map(sq_ring_size_, IORING_OFF_SQ_RING);
+        cq_ring_ = single_mmap ? sq_ring_ : map(cq_ring_size_, IORING_OFF_CQ_RING);
+        sqes_size_ = p.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe *>(map(sqes_size_, IORING_OFF_SQES));
+        if (sq_ring_ == nullptr || cq_ring_ == nullptr || sqes_ == nullptr) {
+            return false;
+        }
+
+        char *sq = static_cast<char *>(sq_ring_);
+        sq_tail_ = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+        unsigned *array = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+        for (unsigned i = 0; i < p.sq_entries; i++) {
+            array[i] = i;
+        }
+        char *cq = static_cast<char *>(cq_ring_);
+        cq_head_ = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe *>(cq + p.cq_off.cqes);
+        return true;
+    }
+
+    bool register_resource(unsigned opcode, const void *arg, unsigned nr_args) {
+        return syscall(__NR_io_uring_register, fd_, opcode, arg, nr_args) >= 0;
+    }
+
+    io_uring_sqe *get_sqe() {
+        io_uring_sqe *sqe = &sqes_[sqe_tail_++ & sq_mask_];
+        memset(sqe, 0, sizeof(*sqe));
+        return sqe;
+    }
+
+    // 提交所有sqe并等至少一个完成
+    bool submit_and_wait() {
+        __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+        int ret = syscall(__NR_io_uring_enter, fd_, sqe_tail_ - submitted_, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+        if (ret < 0) {
+            return errno == EINTR;
+        }
+        submitted_ += ret;
+        return true;
+    }
+
+    bool pop_cqe(io_uring_cqe *cqe) {
+        unsigned head = *cq_head_;
+        if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+            return false;
+        }
+        *cqe = cqes_[head & cq_mask_];
+        __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+   private:
+    void *map(size_t size, off_t offset) {
+        void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, offset);
+        return ptr == MAP_FAILED ? nullptr : ptr;
+    }
+
+    int fd_ = -1;
+    void *sq_ring_ = nullptr;
+    void *cq_ring_ = nullptr;
+    size_t sq_ring_size_ = 0;
+    size_t cq_ring_size_ = 0;
+    size_t sqes_size_ = 0;
+    io_uring_sqe *sqes_ = nullptr;
+    unsigned *sq_tail_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned sqe_tail_ = 0;
+    unsigned submitted_ = 0;
+    unsigned *cq_head_ = nullptr;
+    unsigned *cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    io_uring_cqe *cqes_ = nullptr;
+};
+
+/**
+ * @brief 每个缓冲区负责文件的[offset, end)一块，读一次写一次，写完再读这块剩下的或者取下一块
+ *
+ * @return 1拷完，0内核不支持(还没写任何数据)，-1出错
+ */
+int copy_uring(int in, int out, off_t size) {
+    Uring ring;
+    std::vector<char> buffers(kDepth * kChunk);
+    iovec iovs[kDepth];
+    for (unsigned i = 0; i < kDepth; i++) {
+        iovs[i].iov_base = buffers.data() + i * kChunk;
+        iovs[i].iov_len = kChunk;
+    }
+    // 注册后每次读写不用再查fd表和固定用户页
+    const int fds[2] = {in, out};
+    if (!ring.init(kDepth) || !ring.register_resource(IORING_REGISTER_FILES, fds, 2) ||
+        !ring.register_resource(IORING_REGISTER_BUFFERS, iovs, kDepth)) {
+        return 0;
+    }
+
+    struct Slot {
+        off_t offset;
+        off_t end;
+        size_t len;
+        size_t written;
+    } slots[kDepth];
+    // user_data: 缓冲区编号 * 2 + 是否是写
+    auto submit_read = [&](unsigned i) {
+        io_uring_sqe *sqe = ring.get_sqe();
+        sqe->opcode = IORING_OP_READ_FIXED;
+        sqe->flags = IOSQE_FIXED_FILE;
+        sqe->fd = 0;
+        sqe->addr = reinterpret_cast<uint64_t>(iovs[i].iov_base);
+        sqe->off = slots[i].offset;
+        sqe->len = std::min<off_t>(slots[i].end - slots[i].offset, kChunk);
+        sqe->buf_index = i;
+        sqe->user_data = i * 2;
+    };
+    auto submit_write = [&](unsigned i) {
+        io_uring_sqe *sqe = ring.get_sqe();
+        sqe->opcode = IORING_OP_WRITE_FIXED;
+        sqe->flags = IOSQE_FIXED_FILE;
+        sqe->fd = 1;
+        sqe->addr = reinterpret_cast<uint64_t>(static_cast<char *>(iovs[i].iov_base) + slots[i].written);
+        sqe->off = slots[i].offset + slots[i].written;
+        sqe->len = slots[i].len - slots[i].written;
+        sqe->buf_index = i;
+        sqe->user_data = i * 2 + 1;
+    };
+    off_t next = 0;
+    auto next_chunk = [&](unsigned i) {
+        slots[i].offset = next;
+        slots[i].end = std::min<off_t>(next + kChunk, size);
+        next = slots[i].end;
+        submit_read(i);
+    };
+
+    unsigned active = 0;
+    for (unsigned i = 0; i < kDepth && next < size; i++) {
+        next_chunk(i);
+        active++;
+    }
+    while (active > 0) {
+        if (!ring.submit_and_wait()) {
+            return -1;
+        }
+        io_uring_cqe cqe;
+        while (ring.pop_cqe(&cqe)) {
+            const unsigned i = cqe.user_data / 2;
+            const bool is_write = cqe.user_data % 2;
+            if (cqe.res < 0) {
+                errno = -cqe.res;
+                return -1;
+            }
+            // 源文件在拷贝时被截短，只拷到这里
+            if (cqe.res == 0 && !is_write) {
+                active--;
+                continue;
+            }
+
+            Slot &slot = slots[i];
+            if (!is_write) {
+                slot.len = cqe.res;
+                slot.written = 0;
+                submit_write(i);
+                continue;
+            }
+            slot.written += cqe.res;
+            if (slot.written < slot.len) {
+                submit_write(i);
+                continue;
+            }
+            slot.offset += slot.len;
+            if (slot.offset < slot.end) {
+                submit_read(i);
+            } else if (next < size) {
+                next_chunk(i);
+            } else {
+                active--;
+            }
+        }
+    }
+    return 1;
+}
+
+#endif
+
+/**
+ * @return 1拷完，0不支持(还没写任何数据，比如跨文件系统的老内核)，-1出错
+ */
+int copy_range(int in, int out, off_t size) {
+    off_t copied = 0;
+    while (copied < size) {
+        ssize_t n = syscall(__NR_copy_file_range, in, nullptr, out, nullptr, size - copied, 0);
+        if (n < 0) {
+            if (copied == 0 && (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP)) {
+                return 0;
+            }
+            return -1;
+        }
+        // 一个字节都没拷就返回0的文件系统交给read/write；拷过一部分说明源文件被截短，和io_uring一样只拷到这里
+        if (n == 0) {
+            return copied == 0 ? 0 : 1;
+        }
+        copied += n;
+    }
+    return 1;
+}
+
+int copy_read_write(int in, int out) {
+    std::vector<char> buf(kChunk);
+    ssize_t n;
+    while ((n = read(in, buf.data(), buf.size())) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        for (ssize_t done = 0; done < n;) {
+            ssize_t w = write(out, buf.data() + done, n - done);
+            if (w < 0 && errno != EINTR) {
+                return -1;
+            }
+            done += std::max<ssize_t>(w, 0);
+        }
+    }
+    return 1;
+}
+
+}  // namespace
+
+bool fast_copy_file(const std::string &src, const std::string &dst) {
+    ScopedFd in(open(src.c_str(), O_RDONLY | O_CLOEXEC));
+    struct stat st;
+    if (in.get() < 0 || fstat(in.get(), &st) != 0) {
+        return false;
+    }
+    ScopedFd out(open(dst.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666));
+    if (out.get() < 0) {
+        return false;
+    }
+
+    // /proc等文件的大小是0，只能读到文件结束
+    int ret = 0;
+    if (S_ISREG(st.st_mode) && st.st_size > 0) {
+#ifdef HAVE_IO_URING
+        ret = copy_uring(in.get(), out.get(), st.st_size);
+#endif
+        if (ret == 0) {
+            ret = copy_range(in.get(), out.get(), st.st_size);
+        }
+    }
+    if (ret == 0) {
+        ret = copy_read_write(in.get(), out.get());
+    }
+    return ret > 0 && out.close() == 0;
+}
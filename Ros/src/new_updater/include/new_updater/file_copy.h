@@ -0,0 +1,27 @@
+/**
+ * @file file_copy.h
+ * @author caofangyu (caofy@antwork.link)
+ * @brief 上传前暂存文件用的拷贝
+ * @version 0.1
+ * @date 2024-03-06
+ *
+ * Copyright (c) 2015-2024 Xunyi Ltd. All rights reserved.
+ *
+ */
+
+#pragma once
+
+#include <string>
+
+/**
+ * @brief 把src拷贝到dst(已存在时覆盖)
+ *
+ * 内核支持时用io_uring: 注册源/目标文件和4个1MB缓冲区，多个块的读写同时在内核里排队；
+ * 否则用copy_file_range在内核里拷贝；跨文件系统等不支持时退回1MB缓冲的read/write。
+ * 都比ifstream/ofstream逐8KB拷贝的系统调用少。
+ *
+ * @param src
+ * @param dst
+ * @return 失败返回false，errno为原因
+ */
+bool fast_copy_file(const std::string &src, const std::string &dst);
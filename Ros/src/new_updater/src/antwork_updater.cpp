@@ -414,11 +414,8 @@ bool AntworkUpdater::uplod_file(const std::string &file_path, const std::string
 
     // Create a backup file
     std::string backup_file_path = file_path + ".bak";
-    std::ifstream src(file_path, std::ios::binary);
-    std::ofstream dst(backup_file_path, std::ios::binary);
-    dst << src.rdbuf();
-    if (!src.good() || !dst.good()) {
-        ROS_ERROR("Failed to create backup file '%s'", backup_file_path.c_str());
+    if (!fast_copy_file(file_path, backup_file_path)) {
+        ROS_ERROR("Failed to create backup file '%s': %s", backup_file_path.c_str(), strerror(errno));
         return false;
     }
 
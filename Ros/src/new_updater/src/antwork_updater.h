@@ -14,7 +14,9 @@
 #include <sys/stat.h>
 
 #include <bitset>
+#include <cerrno>
 #include <chrono>
+#include <cstring>
 #include <fstream>
 #include <iomanip>
 #include <sstream>
@@ -25,6 +27,7 @@
 
 #include <define.h>
 #include "conn/interface.h"
+#include "file_copy.h"
 #include "json.hpp"
 #include "pugixml.hpp"
 #include "util.h"
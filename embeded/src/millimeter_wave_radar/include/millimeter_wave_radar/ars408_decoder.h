@@ -0,0 +1,369 @@
+/**
+ * @file ars408_decoder.h
+ * @brief ARS408 雷达 can 报文解码，信号按 DBC 方式以表格描述
+ *
+ * 每个信号记录 起始位/长度/分辨率/偏移量，起始位采用 DBC Motorola(大端) 约定：
+ * 信号最高位所在的位置，按 字节*8 + 字节内位号(7为最高位) 计算。
+ * 报文的8个字节先按大端读入一个 uint64_t，之后每个信号只需一次移位和掩码，
+ * 移位量与掩码在编译期算出，整条报文的解码没有分支。
+ */
+
+#pragma once
+
+#include <linux/can.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define ARS408_DECODER_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define ARS408_DECODER_SSE2 1
+#endif
+
+namespace millimeter_wave_radar {
+namespace ars408 {
+
+/**
+ * @brief 信号描述
+ *
+ */
+struct Signal {
+  uint8_t start;   // Motorola 起始位(最高位)
+  uint8_t length;  // 位宽
+  float factor;    // 分辨率
+  float offset;    // 偏移量
+
+  // 最高位在大端位流中的序号(0为第0字节的最高位)
+  constexpr uint32_t msb() const { return (start / 8) * 8 + (7 - start % 8); }
+  // 相对大端读入的 uint64_t 的右移量
+  constexpr uint32_t shift() const { return 64 - msb() - length; }
+  constexpr uint64_t mask() const { return length >= 64 ? ~0ull : ((1ull << length) - 1); }
+  constexpr bool valid() const { return length > 0 && msb() + length <= 64; }
+
+  uint32_t raw(uint64_t word) const { return static_cast<uint32_t>((word >> shift()) & mask()); }
+  float phys(uint64_t word) const { return static_cast<float>(raw(word)) * factor + offset; }
+};
+
+// clang-format off
+// 0x60A Object_0_Status
+namespace status {
+constexpr Signal kNofObjects        {7,  8,  1.0f, 0.0f};
+constexpr Signal kMeasCounter       {15, 16, 1.0f, 0.0f};
+constexpr Signal kInterfaceVersion  {31, 4,  1.0f, 0.0f};
+}  // namespace status
+
+// 0x60B Object_1_General
+namespace general {
+constexpr Signal kId                {7,  8,  1.0f,  0.0f};
+constexpr Signal kDistLong          {15, 13, 0.2f,  -500.0f};
+constexpr Signal kDistLat           {18, 11, 0.2f,  -204.6f};
+constexpr Signal kVrelLong          {39, 10, 0.25f, -128.0f};
+constexpr Signal kVrelLat           {45, 9,  0.25f, -64.0f};
+constexpr Signal kSectorNumber      {52, 2,  1.0f,  0.0f};
+constexpr Signal kDynProp           {50, 3,  1.0f,  0.0f};
+constexpr Signal kRcs               {63, 8,  0.5f,  -64.0f};
+}  // namespace general
+
+// 0x60C Object_2_Quality, rms 信号为标准差的档位索引
+namespace quality {
+constexpr Signal kId                {7,  8,  1.0f, 0.0f};
+constexpr Signal kDistLongRms       {15, 5,  1.0f, 0.0f};
+constexpr Signal kDistLatRms        {10, 5,  1.0f, 0.0f};
+constexpr Signal kVrelLongRms       {21, 5,  1.0f, 0.0f};
+constexpr Signal kVrelLatRms        {16, 5,  1.0f, 0.0f};
+constexpr Signal kArelLongRms       {27, 5,  1.0f, 0.0f};
+constexpr Signal kArelLatRms        {38, 5,  1.0f, 0.0f};
+constexpr Signal kOrientationRms    {33, 5,  1.0f, 0.0f};
+constexpr Signal kProbOfExist       {55, 3,  1.0f, 0.0f};
+constexpr Signal kMeasState         {52, 3,  1.0f, 0.0f};
+}  // namespace quality
+
+// 0x60D Object_3_Extended
+namespace extended {
+constexpr Signal kId                {7,  8,  1.0f,  0.0f};
+constexpr Signal kArelLong          {15, 11, 0.01f, -10.0f};
+constexpr Signal kArelLat           {20, 9,  0.01f, -2.5f};
+constexpr Signal kClass             {26, 3,  1.0f,  0.0f};
+constexpr Signal kOrientationAngle  {39, 10, 0.4f,  -180.0f};
+constexpr Signal kLength            {55, 8,  0.2f,  0.0f};
+constexpr Signal kWidth             {63, 8,  0.2f,  0.0f};
+}  // namespace extended
+// clang-format on
+
+static_assert(general::kDistLong.valid() && general::kDistLong.shift() == 43, "DistLong layout");
+static_assert(general::kDistLat.shift() == 32 && general::kVrelLong.shift() == 22, "DistLat/VrelLong layout");
+static_assert(general::kVrelLat.shift() == 13 && general::kSectorNumber.shift() == 11, "VrelLat/Sector layout");
+static_assert(quality::kOrientationRms.valid() && extended::kOrientationAngle.valid(), "quality/extended layout");
+
+enum MessageId : uint32_t {
+  kObjectStatus = 0x60a,
+  kObjectGeneral = 0x60b,
+  kObjectQuality = 0x60c,
+  kObjectExtended = 0x60d,
+};
+
+/**
+ * @brief 把8字节数据按大端读成一个整数，dlc不足8时多余字节按0处理
+ *
+ * @param frame
+ * @return uint64_t
+ */
+inline uint64_t loadWord(const can_frame& frame) {
+  uint64_t word;
+  memcpy(&word, frame.data, sizeof(word));
+  word = __builtin_bswap64(word);
+  const uint32_t dlc = frame.can_dlc < 8 ? frame.can_dlc : 8;
+  const uint64_t keep = dlc == 8 ? ~0ull : ~(~0ull >> (dlc * 8));
+  return word & keep;
+}
+
+struct ObjectListStatus {
+  uint8_t objects_number;
+  uint16_t meas_count;
+  uint8_t interface_version;
+};
+
+struct ObjectGeneral {
+  uint8_t id;
+  float dist_long;
+  float dist_lat;
+  float vrel_long;
+  float vrel_lat;
+  uint8_t sector_number;
+  uint8_t dyn_prop;
+  float rcs;
+};
+
+struct ObjectQuality {
+  uint8_t id;
+  uint8_t dist_long_rms;
+  uint8_t dist_lat_rms;
+  uint8_t vrel_long_rms;
+  uint8_t vrel_lat_rms;
+  uint8_t arel_long_rms;
+  uint8_t arel_lat_rms;
+  uint8_t orientation_rms;
+  uint8_t prob_of_exist;
+  uint8_t meas_state;
+};
+
+struct ObjectExtended {
+  uint8_t id;
+  float arel_long;
+  float arel_lat;
+  uint8_t obj_class;
+  float orientation_angle;
+  float length;
+  float width;
+};
+
+inline ObjectListStatus decodeStatus(const can_frame& frame) {
+  const uint64_t w = loadWord(frame);
+  ObjectListStatus s;
+  s.objects_number = static_cast<uint8_t>(status::kNofObjects.raw(w));
+  s.meas_count = static_cast<uint16_t>(status::kMeasCounter.raw(w));
+  s.interface_version = static_cast<uint8_t>(status::kInterfaceVersion.raw(w));
+  return s;
+}
+
+inline ObjectGeneral decodeGeneral(const can_frame& frame) {
+  const uint64_t w = loadWord(frame);
+  ObjectGeneral o;
+  o.id = static_cast<uint8_t>(general::kId.raw(w));
+  o.dist_long = general::kDistLong.phys(w);
+  o.dist_lat = general::kDistLat.phys(w);
+  o.vrel_long = general::kVrelLong.phys(w);
+  o.vrel_lat = general::kVrelLat.phys(w);
+  o.sector_number = static_cast<uint8_t>(general::kSectorNumber.raw(w));
+  o.dyn_prop = static_cast<uint8_t>(general::kDynProp.raw(w));
+  o.rcs = general::kRcs.phys(w);
+  return o;
+}
+
+inline ObjectQuality decodeQuality(const can_frame& frame) {
+  const uint64_t w = loadWord(frame);
+  ObjectQuality q;
+  q.id = static_cast<uint8_t>(quality::kId.raw(w));
+  q.dist_long_rms = static_cast<uint8_t>(quality::kDistLongRms.raw(w));
+  q.dist_lat_rms = static_cast<uint8_t>(quality::kDistLatRms.raw(w));
+  q.vrel_long_rms = static_cast<uint8_t>(quality::kVrelLongRms.raw(w));
+  q.vrel_lat_rms = static_cast<uint8_t>(quality::kVrelLatRms.raw(w));
+  q.arel_long_rms = static_cast<uint8_t>(quality::kArelLongRms.raw(w));
+  q.arel_lat_rms = static_cast<uint8_t>(quality::kArelLatRms.raw(w));
+  q.orientation_rms = static_cast<uint8_t>(quality::kOrientationRms.raw(w));
+  q.prob_of_exist = static_cast<uint8_t>(quality::kProbOfExist.raw(w));
+  q.meas_state = static_cast<uint8_t>(quality::kMeasState.raw(w));
+  return q;
+}
+
+inline ObjectExtended decodeExtended(const can_frame& frame) {
+  const uint64_t w = loadWord(frame);
+  ObjectExtended e;
+  e.id = static_cast<uint8_t>(extended::kId.raw(w));
+  e.arel_long = extended::kArelLong.phys(w);
+  e.arel_lat = extended::kArelLat.phys(w);
+  e.obj_class = static_cast<uint8_t>(extended::kClass.raw(w));
+  e.orientation_angle = extended::kOrientationAngle.phys(w);
+  e.length = extended::kLength.phys(w);
+  e.width = extended::kWidth.phys(w);
+  return e;
+}
+
+/**
+ * @brief 对一批大端字解码同一个信号，输出物理值
+ *
+ * NEON/SSE2 下每次处理4帧，其余平台及尾部用标量
+ *
+ * @param words
+ * @param n
+ * @param sig
+ * @param out
+ */
+inline void decodeColumn(const uint64_t* words, size_t n, const Signal& sig, float* out) {
+  const uint32_t shift = sig.shift();
+  const uint64_t mask = sig.mask();
+  size_t i = 0;
+#if defined(ARS408_DECODER_NEON)
+  const int64x2_t vshift = vdupq_n_s64(-static_cast<int64_t>(shift));
+  const uint64x2_t vmask = vdupq_n_u64(mask);
+  const float32x4_t vfactor = vdupq_n_f32(sig.factor);
+  const float32x4_t voffset = vdupq_n_f32(sig.offset);
+  for (; i + 4 <= n; i += 4) {
+    uint64x2_t lo = vandq_u64(vshlq_u64(vld1q_u64(words + i), vshift), vmask);
+    uint64x2_t hi = vandq_u64(vshlq_u64(vld1q_u64(words + i + 2), vshift), vmask);
+    uint32x4_t raw = vcombine_u32(vmovn_u64(lo), vmovn_u64(hi));
+    vst1q_f32(out + i, vmlaq_f32(voffset, vcvtq_f32_u32(raw), vfactor));
+  }
+#elif defined(ARS408_DECODER_SSE2)
+  const __m128i vshift = _mm_cvtsi32_si128(static_cast<int>(shift));
+  const __m128i vmask = _mm_set1_epi64x(static_cast<long long>(mask));
+  const __m128 vfactor = _mm_set1_ps(sig.factor);
+  const __m128 voffset = _mm_set1_ps(sig.offset);
+  for (; i + 4 <= n; i += 4) {
+    __m128i lo = _mm_and_si128(_mm_srl_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(words + i)), vshift), vmask);
+    __m128i hi =
+        _mm_and_si128(_mm_srl_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(words + i + 2)), vshift), vmask);
+    // 取每个64位通道的低32位拼成4个int32，信号位宽不超过16位，转float不会溢出
+    __m128i raw = _mm_unpacklo_epi64(_mm_shuffle_epi32(lo, _MM_SHUFFLE(3, 1, 2, 0)),
+                                     _mm_shuffle_epi32(hi, _MM_SHUFFLE(3, 1, 2, 0)));
+    _mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(raw), vfactor), voffset));
+  }
+#endif
+  for (; i < n; ++i) {
+    out[i] = sig.phys(words[i]);
+  }
+}
+
+/**
+ * @brief 对一批大端字提取同一个信号的原始值(枚举/编号类信号)
+ *
+ * @param words
+ * @param n
+ * @param sig
+ * @param out
+ */
+inline void decodeColumn(const uint64_t* words, size_t n, const Signal& sig, uint8_t* out) {
+  const uint32_t shift = sig.shift();
+  const uint64_t mask = sig.mask();
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = static_cast<uint8_t>((words[i] >> shift) & mask);
+  }
+}
+
+/**
+ * @brief 一个测量周期的目标信息，按列(SoA)存放
+ *
+ */
+struct ObjectCycleSoA {
+  static constexpr size_t kMaxObjects = 256;  // id 为8位
+
+  size_t general_size = 0;
+  alignas(16) uint8_t id[kMaxObjects];
+  alignas(16) float dist_long[kMaxObjects];
+  alignas(16) float dist_lat[kMaxObjects];
+  alignas(16) float vrel_long[kMaxObjects];
+  alignas(16) float vrel_lat[kMaxObjects];
+  alignas(16) uint8_t sector_number[kMaxObjects];
+  alignas(16) uint8_t dyn_prop[kMaxObjects];
+  alignas(16) float rcs[kMaxObjects];
+
+  size_t quality_size = 0;
+  alignas(16) uint8_t quality_id[kMaxObjects];
+  alignas(16) uint8_t prob_of_exist[kMaxObjects];
+  alignas(16) uint8_t meas_state[kMaxObjects];
+
+  size_t extended_size = 0;
+  alignas(16) uint8_t extended_id[kMaxObjects];
+  alignas(16) float arel_long[kMaxObjects];
+  alignas(16) float arel_lat[kMaxObjects];
+  alignas(16) uint8_t obj_class[kMaxObjects];
+  alignas(16) float orientation_angle[kMaxObjects];
+  alignas(16) float length[kMaxObjects];
+  alignas(16) float width[kMaxObjects];
+
+  alignas(16) uint64_t words[kMaxObjects];  // 解码用的临时区
+};
+
+/**
+ * @brief 把若干帧读成大端字
+ *
+ * @return size_t 实际处理的帧数(不超过 ObjectCycleSoA::kMaxObjects)
+ */
+inline size_t loadWords(const can_frame* frames, size_t n, uint64_t* words) {
+  if (n > ObjectCycleSoA::kMaxObjects) n = ObjectCycleSoA::kMaxObjects;
+  for (size_t i = 0; i < n; ++i) {
+    words[i] = loadWord(frames[i]);
+  }
+  return n;
+}
+
+/**
+ * @brief 批量解码一个周期的 0x60B 帧
+ *
+ */
+inline void decodeGeneralBatch(const can_frame* frames, size_t n, ObjectCycleSoA& out) {
+  n = loadWords(frames, n, out.words);
+  decodeColumn(out.words, n, general::kId, out.id);
+  decodeColumn(out.words, n, general::kDistLong, out.dist_long);
+  decodeColumn(out.words, n, general::kDistLat, out.dist_lat);
+  decodeColumn(out.words, n, general::kVrelLong, out.vrel_long);
+  decodeColumn(out.words, n, general::kVrelLat, out.vrel_lat);
+  decodeColumn(out.words, n, general::kSectorNumber, out.sector_number);
+  decodeColumn(out.words, n, general::kDynProp, out.dyn_prop);
+  decodeColumn(out.words, n, general::kRcs, out.rcs);
+  out.general_size = n;
+}
+
+/**
+ * @brief 批量解码一个周期的 0x60C 帧
+ *
+ */
+inline void decodeQualityBatch(const can_frame* frames, size_t n, ObjectCycleSoA& out) {
+  n = loadWords(frames, n, out.words);
+  decodeColumn(out.words, n, quality::kId, out.quality_id);
+  decodeColumn(out.words, n, quality::kProbOfExist, out.prob_of_exist);
+  decodeColumn(out.words, n, quality::kMeasState, out.meas_state);
+  out.quality_size = n;
+}
+
+/**
+ * @brief 批量解码一个周期的 0x60D 帧
+ *
+ */
+inline void decodeExtendedBatch(const can_frame* frames, size_t n, ObjectCycleSoA& out) {
+  n = loadWords(frames, n, out.words);
+  decodeColumn(out.words, n, extended::kId, out.extended_id);
+  decodeColumn(out.words, n, extended::kArelLong, out.arel_long);
+  decodeColumn(out.words, n, extended::kArelLat, out.arel_lat);
+  decodeColumn(out.words, n, extended::kClass, out.obj_class);
+  decodeColumn(out.words, n, extended::kOrientationAngle, out.orientation_angle);
+  decodeColumn(out.words, n, extended::kLength, out.length);
+  decodeColumn(out.words, n, extended::kWidth, out.width);
+  out.extended_size = n;
+}
+
+}  // namespace ars408
+}  // namespace millimeter_wave_radar
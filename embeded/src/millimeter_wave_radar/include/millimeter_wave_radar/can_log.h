@@ -0,0 +1,180 @@
+/**
+ * @file can_log.h
+ * @brief 原始can帧二进制日志
+ *
+ * 文件格式: 32字节文件头 + 定长记录(接收时间 + can_frame, 24字节)，记录按时间顺序追加。
+ * 定长记录可以直接 mmap 后按下标访问，按时间定位用二分查找，不需要额外索引。
+ * 字段按本机字节序存放，文件头中记录字节序标记，读取时校验。
+ */
+
+#pragma once
+
+#include <fcntl.h>
+#include <linux/can.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+
+#include "millimeter_wave_radar/can_socket.h"
+
+namespace millimeter_wave_radar {
+
+struct CanLogHeader {
+  char magic[8];         // "MMWCANLG"
+  uint32_t version;      // 1
+  uint32_t record_size;  // sizeof(CanLogRecord)
+  uint32_t byte_order;   // 0x01020304, 本机字节序写入
+  uint32_t reserved[3];
+};
+
+struct CanLogRecord {
+  uint64_t stamp_ns;
+  can_frame frame;
+};
+
+static_assert(sizeof(CanLogHeader) == 32, "CanLogHeader layout");
+static_assert(sizeof(CanLogRecord) == 24, "CanLogRecord layout");
+
+constexpr char kCanLogMagic[8] = {'M', 'M', 'W', 'C', 'A', 'N', 'L', 'G'};
+constexpr uint32_t kCanLogVersion = 1;
+constexpr uint32_t kCanLogByteOrder = 0x01020304;
+
+/**
+ * @brief 追加写入日志, 内部缓冲后按块写盘
+ *
+ */
+class CanLogWriter {
+ public:
+  CanLogWriter() : file_(nullptr) {}
+  ~CanLogWriter() { close(); }
+
+  bool open(const std::string& path) {
+    file_ = fopen(path.c_str(), "wb");
+    if (!file_) {
+      perror("Error opening can log");
+      return false;
+    }
+    setvbuf(file_, nullptr, _IOFBF, 1 << 20);
+    CanLogHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kCanLogMagic, sizeof(header.magic));
+    header.version = kCanLogVersion;
+    header.record_size = sizeof(CanLogRecord);
+    header.byte_order = kCanLogByteOrder;
+    return fwrite(&header, sizeof(header), 1, file_) == 1;
+  }
+
+  bool write(const StampedFrame* frames, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+      CanLogRecord rec;
+      rec.stamp_ns = frames[i].stamp_ns;
+      rec.frame = frames[i].frame;
+      if (fwrite(&rec, sizeof(rec), 1, file_) != 1) return false;
+    }
+    return true;
+  }
+
+  void flush() {
+    if (file_) fflush(file_);
+  }
+
+  void close() {
+    if (file_) {
+      fclose(file_);
+      file_ = nullptr;
+    }
+  }
+
+ private:
+  FILE* file_;
+};
+
+/**
+ * @brief 以 mmap 方式只读打开日志
+ *
+ */
+class CanLogReader {
+ public:
+  CanLogReader() : data_(nullptr), map_size_(0), records_(nullptr), size_(0) {}
+  ~CanLogReader() { close(); }
+
+  CanLogReader(const CanLogReader&) = delete;
+  CanLogReader& operator=(const CanLogReader&) = delete;
+
+  bool open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      perror("Error opening can log");
+      return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < sizeof(CanLogHeader)) {
+      fprintf(stderr, "can log too short: %s\n", path.c_str());
+      ::close(fd);
+      return false;
+    }
+    map_size_ = static_cast<size_t>(st.st_size);
+    void* p = mmap(nullptr, map_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+      perror("Error mapping can log");
+      map_size_ = 0;
+      return false;
+    }
+    data_ = static_cast<const char*>(p);
+
+    const CanLogHeader* header = reinterpret_cast<const CanLogHeader*>(data_);
+    if (memcmp(header->magic, kCanLogMagic, sizeof(kCanLogMagic)) != 0 || header->version != kCanLogVersion ||
+        header->record_size != sizeof(CanLogRecord) || header->byte_order != kCanLogByteOrder) {
+      fprintf(stderr, "invalid can log header: %s\n", path.c_str());
+      close();
+      return false;
+    }
+    records_ = reinterpret_cast<const CanLogRecord*>(data_ + sizeof(CanLogHeader));
+    // 末尾未写完整的记录忽略
+    size_ = (map_size_ - sizeof(CanLogHeader)) / sizeof(CanLogRecord);
+    madvise(const_cast<char*>(data_), map_size_, MADV_SEQUENTIAL);
+    return true;
+  }
+
+  void close() {
+    if (data_) {
+      munmap(const_cast<char*>(data_), map_size_);
+      data_ = nullptr;
+    }
+    records_ = nullptr;
+    size_ = 0;
+    map_size_ = 0;
+  }
+
+  size_t size() const { return size_; }
+  const CanLogRecord& operator[](size_t i) const { return records_[i]; }
+  const CanLogRecord* begin() const { return records_; }
+  const CanLogRecord* end() const { return records_ + size_; }
+
+  /**
+   * @brief 第一条接收时间不早于 stamp_ns 的记录下标
+   *
+   * @param stamp_ns
+   * @return size_t 全部早于时返回 size()
+   */
+  size_t lowerBound(uint64_t stamp_ns) const {
+    const CanLogRecord* it = std::lower_bound(
+        begin(), end(), stamp_ns, [](const CanLogRecord& rec, uint64_t t) { return rec.stamp_ns < t; });
+    return static_cast<size_t>(it - begin());
+  }
+
+ private:
+  const char* data_;
+  size_t map_size_;
+  const CanLogRecord* records_;
+  size_t size_;
+};
+
+}  // namespace millimeter_wave_radar
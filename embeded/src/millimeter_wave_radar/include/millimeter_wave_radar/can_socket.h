@@ -0,0 +1,174 @@
+/**
+ * @file can_socket.h
+ * @brief SocketCAN 原始套接字封装：recvmmsg 批量读取并带内核接收时间戳
+ */
+
+#pragma once
+
+#include <errno.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include <net/if.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace millimeter_wave_radar {
+
+/**
+ * @brief 带内核接收时间戳的can帧
+ *
+ */
+struct StampedFrame {
+  can_frame frame;
+  uint64_t stamp_ns;  // 内核接收时间(ns), 硬件时间戳优先, 0表示不可用
+};
+
+class CanSocket {
+ public:
+  static constexpr size_t kMaxBatch = 64;  // recvmmsg 单次最多读取的帧数
+
+  CanSocket() : fd_(-1) {
+    memset(msgs_, 0, sizeof(msgs_));
+    for (size_t i = 0; i < kMaxBatch; ++i) {
+      iovs_[i].iov_base = &frames_[i];
+      iovs_[i].iov_len = sizeof(can_frame);
+      msgs_[i].msg_hdr.msg_iov = &iovs_[i];
+      msgs_[i].msg_hdr.msg_iovlen = 1;
+      msgs_[i].msg_hdr.msg_control = ctrl_[i];
+    }
+  }
+  ~CanSocket() { close(); }
+
+  CanSocket(const CanSocket&) = delete;
+  CanSocket& operator=(const CanSocket&) = delete;
+
+  /**
+   * @brief 打开并绑定到指定接口
+   *
+   * @param ifname 例如 can0 / vcan0
+   * @param rcv_timeout_ms 读超时, 便于调用方检查退出标志, 0为一直阻塞
+   * @return true
+   * @return false
+   */
+  bool open(const char* ifname, int rcv_timeout_ms = 100) {
+    fd_ = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    if (fd_ < 0) {
+      perror("Error creating socket");
+      return false;
+    }
+
+    struct sockaddr_can addr;
+    struct ifreq ifr;
+    memset(&addr, 0, sizeof(addr));
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, ifname, IFNAMSIZ - 1);
+    if (ioctl(fd_, SIOCGIFINDEX, &ifr) < 0) {
+      perror("Error getting interface index");
+      close();
+      return false;
+    }
+
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = ifr.ifr_ifindex;
+
+    if (bind(fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+      perror("Error binding socket");
+      close();
+      return false;
+    }
+
+    // 内核接收时间戳, 网卡支持时同时取硬件时间戳
+    int ts_flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE | SOF_TIMESTAMPING_RX_HARDWARE |
+                   SOF_TIMESTAMPING_RAW_HARDWARE;
+    if (setsockopt(fd_, SOL_SOCKET, SO_TIMESTAMPING, &ts_flags, sizeof(ts_flags)) < 0) {
+      perror("Error enabling SO_TIMESTAMPING");
+    }
+    if (rcv_timeout_ms > 0) {
+      struct timeval tv = {rcv_timeout_ms / 1000, (rcv_timeout_ms % 1000) * 1000};
+      setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    }
+    return true;
+  }
+
+  /**
+   * @brief 阻塞到第一帧到达, 随后把已在队列中的帧一次取完
+   *
+   * @param out
+   * @param max_n 不超过 kMaxBatch
+   * @return int 读到的帧数, 超时或被中断返回0, 出错返回-1
+   */
+  int read(StampedFrame* out, size_t max_n) {
+    if (max_n > kMaxBatch) max_n = kMaxBatch;
+    for (size_t i = 0; i < max_n; ++i) {
+      msgs_[i].msg_hdr.msg_controllen = sizeof(ctrl_[i]);
+      msgs_[i].msg_hdr.msg_flags = 0;
+    }
+    int n = recvmmsg(fd_, msgs_, max_n, MSG_WAITFORONE, nullptr);
+    if (n < 0) {
+      if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+      perror("Error reading from socket");
+      return -1;
+    }
+
+    int m = 0;
+    for (int i = 0; i < n; ++i) {
+      if (msgs_[i].msg_len != sizeof(can_frame)) continue;
+      out[m].frame = frames_[i];
+      out[m].stamp_ns = rxTimestamp(msgs_[i].msg_hdr);
+      ++m;
+    }
+    return m;
+  }
+
+  bool write(const can_frame& frame) {
+    ssize_t n = ::write(fd_, &frame, sizeof(frame));
+    if (n != sizeof(frame)) {
+      perror("Error writing to socket");
+      return false;
+    }
+    return true;
+  }
+
+  void close() {
+    if (fd_ >= 0) {
+      ::close(fd_);
+      fd_ = -1;
+    }
+  }
+
+  int fd() const { return fd_; }
+
+ private:
+  /**
+   * @brief 从控制消息中取出接收时间戳
+   *
+   * @param msg
+   * @return uint64_t 纳秒, 不可用时为0
+   */
+  static uint64_t rxTimestamp(const struct msghdr& msg) {
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+         cmsg = CMSG_NXTHDR(const_cast<struct msghdr*>(&msg), cmsg)) {
+      if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SO_TIMESTAMPING) continue;
+      struct scm_timestamping ts;
+      memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+      // ts[2]为硬件原始时间戳, ts[0]为软件时间戳
+      const struct timespec& t = (ts.ts[2].tv_sec || ts.ts[2].tv_nsec) ? ts.ts[2] : ts.ts[0];
+      return static_cast<uint64_t>(t.tv_sec) * 1000000000ull + static_cast<uint64_t>(t.tv_nsec);
+    }
+    return 0;
+  }
+
+  int fd_;
+  can_frame frames_[kMaxBatch];
+  struct iovec iovs_[kMaxBatch];
+  struct mmsghdr msgs_[kMaxBatch];
+  char ctrl_[kMaxBatch][CMSG_SPACE(sizeof(struct scm_timestamping))];
+};
+
+}  // namespace millimeter_wave_radar
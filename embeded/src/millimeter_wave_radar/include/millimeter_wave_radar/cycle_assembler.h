@@ -0,0 +1,180 @@
+/**
+ * @file cycle_assembler.h
+ * @brief 按测量周期(meas_count)组装雷达目标帧，检测周期是否完整及超时
+ *
+ * 一个周期以 0x60A 列表头开始，头里给出本周期目标数 N，随后依次是 N 个 0x60B，
+ * 若雷达开启了质量/扩展信息，再跟 N 个 0x60C 和 N 个 0x60D。
+ * 收齐所有帧时立即交付该周期，不必等到下一个列表头；
+ * 下一个列表头先到或超过超时时间仍未收齐时，按不完整周期交付。
+ *
+ * 周期缓存为双缓冲，按 meas_count 奇偶选择，交付出去的周期在下一周期组装期间保持有效。
+ */
+
+#pragma once
+
+#include <linux/can.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "millimeter_wave_radar/ars408_decoder.h"
+
+namespace millimeter_wave_radar {
+
+/**
+ * @brief 一个测量周期收到的原始帧
+ *
+ */
+struct CycleFrames {
+  uint16_t meas_count = 0;
+  uint8_t objects_number = 0;  // 列表头声明的目标数
+  uint64_t stamp_ns = 0;       // 列表头的接收时间
+  uint64_t start_ns = 0;       // 开始组装的单调时钟时间, 用于超时判断
+  bool complete = false;
+  std::vector<can_frame> general;
+  std::vector<can_frame> quality;
+  std::vector<can_frame> extended;
+
+  CycleFrames() {
+    general.reserve(ars408::ObjectCycleSoA::kMaxObjects);
+    quality.reserve(ars408::ObjectCycleSoA::kMaxObjects);
+    extended.reserve(ars408::ObjectCycleSoA::kMaxObjects);
+  }
+
+  void reset() {
+    complete = false;
+    general.clear();
+    quality.clear();
+    extended.clear();
+  }
+};
+
+class CycleAssembler {
+ public:
+  struct Stats {
+    uint64_t complete_cycles = 0;
+    uint64_t incomplete_cycles = 0;  // 被下一个列表头打断或超时
+    uint64_t missing_frames = 0;     // 不完整周期中缺少的帧数
+    uint64_t lost_cycles = 0;        // meas_count 不连续
+    uint64_t stray_frames = 0;       // 不属于任何正在组装周期的帧
+  };
+
+  /**
+   * @brief Construct a new Cycle Assembler
+   *
+   * @param timeout_ns 列表头之后多长时间仍未收齐则按不完整交付
+   */
+  explicit CycleAssembler(uint64_t timeout_ns) : timeout_ns_(timeout_ns) {}
+
+  /**
+   * @brief 输入一帧, 若因此结束了周期则调用 on_cycle(const CycleFrames&)
+   *
+   * @param frame
+   * @param stamp_ns 帧的接收时间
+   * @param now_ns 当前单调时钟时间
+   * @param on_cycle
+   */
+  template <typename OnCycle>
+  void onFrame(const can_frame& frame, uint64_t stamp_ns, uint64_t now_ns, OnCycle&& on_cycle) {
+    switch (frame.can_id & CAN_EFF_MASK) {
+      case ars408::kObjectStatus:
+        onStatus(frame, stamp_ns, now_ns, on_cycle);
+        break;
+      case ars408::kObjectGeneral:
+        append(active_ ? &active_->general : nullptr, frame, on_cycle);
+        break;
+      case ars408::kObjectQuality:
+        expect_quality_ = true;
+        append(active_ ? &active_->quality : nullptr, frame, on_cycle);
+        break;
+      case ars408::kObjectExtended:
+        expect_extended_ = true;
+        append(active_ ? &active_->extended : nullptr, frame, on_cycle);
+        break;
+      default:
+        break;
+    }
+  }
+
+  /**
+   * @brief 检查正在组装的周期是否超时, 超时则按不完整交付
+   *
+   * @param now_ns 当前单调时钟时间
+   * @param on_cycle
+   */
+  template <typename OnCycle>
+  void poll(uint64_t now_ns, OnCycle&& on_cycle) {
+    if (active_ && now_ns - active_->start_ns > timeout_ns_) {
+      on_cycle(finish(false));
+    }
+  }
+
+  const Stats& stats() const { return stats_; }
+
+ private:
+  template <typename OnCycle>
+  void onStatus(const can_frame& frame, uint64_t stamp_ns, uint64_t now_ns, OnCycle& on_cycle) {
+    const ars408::ObjectListStatus status = ars408::decodeStatus(frame);
+    if (active_) on_cycle(finish(false));
+
+    if (has_last_count_) {
+      uint16_t gap = static_cast<uint16_t>(status.meas_count - last_count_ - 1);
+      if (gap < 0x8000) stats_.lost_cycles += gap;
+    }
+    last_count_ = status.meas_count;
+    has_last_count_ = true;
+
+    CycleFrames& cycle = slots_[status.meas_count & 1];
+    cycle.reset();
+    cycle.meas_count = status.meas_count;
+    cycle.objects_number = status.objects_number;
+    cycle.stamp_ns = stamp_ns;
+    cycle.start_ns = now_ns;
+    active_ = &cycle;
+
+    // 空周期只有列表头
+    if (isComplete(cycle)) on_cycle(finish(true));
+  }
+
+  template <typename OnCycle>
+  void append(std::vector<can_frame>* frames, const can_frame& frame, OnCycle& on_cycle) {
+    if (!frames || frames->size() >= active_->objects_number) {
+      ++stats_.stray_frames;
+      return;
+    }
+    frames->push_back(frame);
+    if (isComplete(*active_)) on_cycle(finish(true));
+  }
+
+  bool isComplete(const CycleFrames& cycle) const {
+    const size_t n = cycle.objects_number;
+    return cycle.general.size() == n && (!expect_quality_ || cycle.quality.size() == n) &&
+           (!expect_extended_ || cycle.extended.size() == n);
+  }
+
+  const CycleFrames& finish(bool complete) {
+    CycleFrames* cycle = active_;
+    active_ = nullptr;
+    cycle->complete = complete;
+    if (complete) {
+      ++stats_.complete_cycles;
+    } else {
+      const size_t n = cycle->objects_number;
+      ++stats_.incomplete_cycles;
+      stats_.missing_frames += (n - cycle->general.size()) + (expect_quality_ ? n - cycle->quality.size() : 0) +
+                               (expect_extended_ ? n - cycle->extended.size() : 0);
+    }
+    return *cycle;
+  }
+
+  uint64_t timeout_ns_;
+  CycleFrames slots_[2];
+  CycleFrames* active_ = nullptr;
+  bool expect_quality_ = false;   // 一旦收到过 0x60C 即认为之后每周期都有
+  bool expect_extended_ = false;  // 一旦收到过 0x60D 即认为之后每周期都有
+  uint16_t last_count_ = 0;
+  bool has_last_count_ = false;
+  Stats stats_;
+};
+
+}  // namespace millimeter_wave_radar
@@ -0,0 +1,312 @@
+/**
+ * @file object_tracker.h
+ * @brief 雷达目标多周期跟踪：门限 + 全局最近邻关联 + 匀速模型卡尔曼滤波
+ *
+ * 状态为 [x, vx, y, vy]，雷达同时测量距离和相对速度，纵向/横向两轴互相独立，
+ * 每轴是一个2维卡尔曼滤波，协方差只需存3个数。所有航迹按列(SoA)存放，
+ * 预测和更新都是对数组逐元素的无分支循环，编译器可直接向量化(NEON/SSE)。
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "millimeter_wave_radar/ars408_decoder.h"
+
+namespace millimeter_wave_radar {
+
+class ObjectTracker {
+ public:
+  static constexpr size_t kMaxTracks = 512;
+
+  struct Config {
+    float accel_noise = 2.0f;     // 过程噪声, 加速度标准差 m/s²
+    float pos_noise = 0.5f;       // 距离测量标准差 m
+    float vel_noise = 0.25f;      // 速度测量标准差 m/s
+    float gate = 13.28f;          // 位置+速度马氏距离平方门限(4自由度 99%)
+    uint16_t confirm_hits = 3;    // 连续关联多少次后确认航迹
+    uint16_t max_misses = 3;      // 确认航迹连续丢失多少次后删除
+    float init_pos_var = 1.0f;    // 新航迹位置方差
+    float init_vel_var = 4.0f;    // 新航迹速度方差
+  };
+
+  /**
+   * @brief 一条航迹的输出
+   *
+   */
+  struct Track {
+    uint32_t track_id;
+    uint8_t object_id;  // 最近一次关联的雷达目标id
+    float x, y, vx, vy;
+    float x_var, y_var;
+    uint16_t hits;
+    uint16_t misses;
+  };
+
+  ObjectTracker() : ObjectTracker(Config()) {}
+  explicit ObjectTracker(const Config& config) : config_(config) { pairs_.reserve(4096); }
+
+  /**
+   * @brief 处理一个周期的测量
+   *
+   * @param cycle 已解码的周期, 使用 0x60B 的距离和速度
+   * @param dt 与上一周期的时间间隔(秒)
+   */
+  void step(const ars408::ObjectCycleSoA& cycle, float dt) {
+    const size_t m = cycle.general_size;
+    predict(dt);
+    associate(cycle, m);
+    update(cycle);
+    manage(cycle, m);
+  }
+
+  size_t size() const { return size_; }
+
+  /**
+   * @brief 导出已确认的航迹
+   *
+   * @param out
+   */
+  void confirmedTracks(std::vector<Track>& out) const {
+    out.clear();
+    for (size_t i = 0; i < size_; ++i) {
+      if (hits_[i] < config_.confirm_hits) continue;
+      Track t;
+      t.track_id = id_[i];
+      t.object_id = object_id_[i];
+      t.x = x_[i];
+      t.y = y_[i];
+      t.vx = vx_[i];
+      t.vy = vy_[i];
+      t.x_var = xa_[i];
+      t.y_var = ya_[i];
+      t.hits = hits_[i];
+      t.misses = misses_[i];
+      out.push_back(t);
+    }
+  }
+
+ private:
+  struct Pair {
+    float cost;
+    uint16_t track;
+    uint16_t meas;
+    bool operator<(const Pair& o) const { return cost < o.cost; }
+  };
+
+  /**
+   * @brief 匀速模型预测, 每轴协方差 [[a,b],[b,c]]
+   *
+   */
+  void predict(float dt) {
+    const float s2 = config_.accel_noise * config_.accel_noise;
+    const float q11 = 0.25f * dt * dt * dt * dt * s2;
+    const float q12 = 0.5f * dt * dt * dt * s2;
+    const float q22 = dt * dt * s2;
+    predictAxis(x_, vx_, xa_, xb_, xc_, dt, q11, q12, q22);
+    predictAxis(y_, vy_, ya_, yb_, yc_, dt, q11, q12, q22);
+  }
+
+  void predictAxis(float* p, const float* v, float* a, float* b, float* c, float dt, float q11, float q12,
+                   float q22) {
+    const size_t n = size_;
+    for (size_t i = 0; i < n; ++i) {
+      p[i] += v[i] * dt;
+      a[i] += dt * (2.0f * b[i] + dt * c[i]) + q11;
+      b[i] += dt * c[i] + q12;
+      c[i] += q22;
+    }
+  }
+
+  /**
+   * @brief 门限内候选对按代价排序后贪心分配(全局最近邻)
+   *
+   */
+  void associate(const ars408::ObjectCycleSoA& cycle, size_t m) {
+    const float rp = config_.pos_noise * config_.pos_noise;
+    const float rv = config_.vel_noise * config_.vel_noise;
+    pairs_.clear();
+    for (size_t t = 0; t < size_; ++t) {
+      // 忽略轴内位置/速度的相关项, 按对角近似计算马氏距离
+      const float inv_sx = 1.0f / (xa_[t] + rp);
+      const float inv_sy = 1.0f / (ya_[t] + rp);
+      const float inv_svx = 1.0f / (xc_[t] + rv);
+      const float inv_svy = 1.0f / (yc_[t] + rv);
+      const float x = x_[t], y = y_[t], vx = vx_[t], vy = vy_[t];
+      // 先整行算距离(可向量化), 再挑出门限内的候选
+      for (size_t j = 0; j < m; ++j) {
+        const float dx = cycle.dist_long[j] - x;
+        const float dy = cycle.dist_lat[j] - y;
+        const float dvx = cycle.vrel_long[j] - vx;
+        const float dvy = cycle.vrel_lat[j] - vy;
+        cost_row_[j] = dx * dx * inv_sx + dy * dy * inv_sy + dvx * dvx * inv_svx + dvy * dvy * inv_svy;
+      }
+      for (size_t j = 0; j < m; ++j) {
+        if (cost_row_[j] < config_.gate) {
+          pairs_.push_back(Pair{cost_row_[j], static_cast<uint16_t>(t), static_cast<uint16_t>(j)});
+        }
+      }
+    }
+    std::sort(pairs_.begin(), pairs_.end());
+
+    std::fill(meas_of_track_, meas_of_track_ + size_, -1);
+    std::fill(track_of_meas_, track_of_meas_ + m, -1);
+    for (const Pair& p : pairs_) {
+      if (meas_of_track_[p.track] >= 0 || track_of_meas_[p.meas] >= 0) continue;
+      meas_of_track_[p.track] = p.meas;
+      track_of_meas_[p.meas] = p.track;
+    }
+  }
+
+  /**
+   * @brief 卡尔曼更新, 未关联的航迹增益为0, 整个循环无分支
+   *
+   */
+  void update(const ars408::ObjectCycleSoA& cycle) {
+    const size_t n = size_;
+    for (size_t i = 0; i < n; ++i) {
+      const int16_t j = meas_of_track_[i];
+      const bool hit = j >= 0;
+      const size_t k = hit ? static_cast<size_t>(j) : 0;
+      zx_[i] = hit ? cycle.dist_long[k] : x_[i];
+      zvx_[i] = hit ? cycle.vrel_long[k] : vx_[i];
+      zy_[i] = hit ? cycle.dist_lat[k] : y_[i];
+      zvy_[i] = hit ? cycle.vrel_lat[k] : vy_[i];
+      mask_[i] = hit ? 1.0f : 0.0f;
+    }
+    const float rp = config_.pos_noise * config_.pos_noise;
+    const float rv = config_.vel_noise * config_.vel_noise;
+    updateAxis(x_, vx_, xa_, xb_, xc_, zx_, zvx_, rp, rv);
+    updateAxis(y_, vy_, ya_, yb_, yc_, zy_, zvy_, rp, rv);
+  }
+
+  /**
+   * @brief 单轴更新, 量测为 [位置, 速度], H = I, R = diag(rp, rv)
+   *
+   */
+  void updateAxis(float* p, float* v, float* a, float* b, float* c, const float* zp, const float* zv, float rp,
+                  float rv) {
+    const size_t n = size_;
+    for (size_t i = 0; i < n; ++i) {
+      const float w = mask_[i];
+      const float s11 = a[i] + rp, s12 = b[i], s22 = c[i] + rv;
+      const float inv_det = 1.0f / (s11 * s22 - s12 * s12);
+      // K = P * S^-1
+      const float k11 = w * (a[i] * s22 - b[i] * s12) * inv_det;
+      const float k12 = w * (b[i] * s11 - a[i] * s12) * inv_det;
+      const float k21 = w * (b[i] * s22 - c[i] * s12) * inv_det;
+      const float k22 = w * (c[i] * s11 - b[i] * s12) * inv_det;
+      const float ep = zp[i] - p[i], ev = zv[i] - v[i];
+      p[i] += k11 * ep + k12 * ev;
+      v[i] += k21 * ep + k22 * ev;
+      // P = (I - K) P
+      const float na = (1.0f - k11) * a[i] - k12 * b[i];
+      const float nb = (1.0f - k11) * b[i] - k12 * c[i];
+      const float nc = -k21 * b[i] + (1.0f - k22) * c[i];
+      a[i] = na;
+      b[i] = nb;
+      c[i] = nc;
+    }
+  }
+
+  /**
+   * @brief 更新命中/丢失计数, 删除过期航迹, 为未关联的测量新建航迹
+   *
+   */
+  void manage(const ars408::ObjectCycleSoA& cycle, size_t m) {
+    for (size_t i = 0; i < size_; ++i) {
+      if (meas_of_track_[i] >= 0) {
+        object_id_[i] = cycle.id[meas_of_track_[i]];
+        if (hits_[i] < 0xffff) ++hits_[i];
+        misses_[i] = 0;
+      } else {
+        ++misses_[i];
+      }
+    }
+
+    for (size_t i = 0; i < size_;) {
+      const bool confirmed = hits_[i] >= config_.confirm_hits;
+      const bool dead = confirmed ? misses_[i] > config_.max_misses : misses_[i] > 0;
+      if (dead) {
+        remove(i);
+      } else {
+        ++i;
+      }
+    }
+
+    for (size_t j = 0; j < m && size_ < kMaxTracks; ++j) {
+      if (track_of_meas_[j] >= 0) continue;
+      const size_t i = size_++;
+      id_[i] = next_id_++;
+      object_id_[i] = cycle.id[j];
+      x_[i] = cycle.dist_long[j];
+      vx_[i] = cycle.vrel_long[j];
+      y_[i] = cycle.dist_lat[j];
+      vy_[i] = cycle.vrel_lat[j];
+      xa_[i] = ya_[i] = config_.init_pos_var;
+      xb_[i] = yb_[i] = 0.0f;
+      xc_[i] = yc_[i] = config_.init_vel_var;
+      hits_[i] = 1;
+      misses_[i] = 0;
+    }
+  }
+
+  /**
+   * @brief 用最后一条航迹覆盖第 i 条, O(1) 删除
+   *
+   */
+  void remove(size_t i) {
+    const size_t last = --size_;
+    id_[i] = id_[last];
+    object_id_[i] = object_id_[last];
+    x_[i] = x_[last];
+    vx_[i] = vx_[last];
+    y_[i] = y_[last];
+    vy_[i] = vy_[last];
+    xa_[i] = xa_[last];
+    xb_[i] = xb_[last];
+    xc_[i] = xc_[last];
+    ya_[i] = ya_[last];
+    yb_[i] = yb_[last];
+    yc_[i] = yc_[last];
+    hits_[i] = hits_[last];
+    misses_[i] = misses_[last];
+  }
+
+  Config config_;
+  size_t size_ = 0;
+  uint32_t next_id_ = 1;
+
+  // 航迹状态
+  uint32_t id_[kMaxTracks];
+  uint8_t object_id_[kMaxTracks];
+  alignas(16) float x_[kMaxTracks];
+  alignas(16) float vx_[kMaxTracks];
+  alignas(16) float y_[kMaxTracks];
+  alignas(16) float vy_[kMaxTracks];
+  alignas(16) float xa_[kMaxTracks];
+  alignas(16) float xb_[kMaxTracks];
+  alignas(16) float xc_[kMaxTracks];
+  alignas(16) float ya_[kMaxTracks];
+  alignas(16) float yb_[kMaxTracks];
+  alignas(16) float yc_[kMaxTracks];
+  uint16_t hits_[kMaxTracks];
+  uint16_t misses_[kMaxTracks];
+
+  // 每周期的临时数据
+  std::vector<Pair> pairs_;
+  alignas(16) float cost_row_[ars408::ObjectCycleSoA::kMaxObjects];
+  int16_t meas_of_track_[kMaxTracks];
+  int16_t track_of_meas_[ars408::ObjectCycleSoA::kMaxObjects];
+  alignas(16) float zx_[kMaxTracks];
+  alignas(16) float zvx_[kMaxTracks];
+  alignas(16) float zy_[kMaxTracks];
+  alignas(16) float zvy_[kMaxTracks];
+  alignas(16) float mask_[kMaxTracks];
+};
+
+}  // namespace millimeter_wave_radar
@@ -0,0 +1,95 @@
+/**
+ * @file spsc_ring.h
+ * @brief 单生产者单消费者无锁环形队列，容量在编译期确定且预先分配
+ *
+ * 只允许一个线程 push、一个线程 pop。head_/tail_ 分别只由消费者/生产者写入，
+ * 各自缓存对端的索引，避免每次操作都读取对端所在的缓存行。
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace millimeter_wave_radar {
+
+template <typename T, size_t Capacity>
+class SpscRing {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+ public:
+  SpscRing() : head_(0), cached_tail_(0), tail_(0), cached_head_(0) {}
+
+  SpscRing(const SpscRing&) = delete;
+  SpscRing& operator=(const SpscRing&) = delete;
+
+  /**
+   * @brief 生产者批量写入，空间不足时只写入能容纳的部分
+   *
+   * @param items
+   * @param n
+   * @return size_t 实际写入的数量
+   */
+  size_t push(const T* items, size_t n) {
+    const uint64_t tail = tail_.load(std::memory_order_relaxed);
+    if (Capacity - (tail - cached_head_) < n) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+    }
+    size_t free_slots = Capacity - (tail - cached_head_);
+    if (n > free_slots) n = free_slots;
+    for (size_t i = 0; i < n; ++i) {
+      buffer_[(tail + i) & kMask] = items[i];
+    }
+    tail_.store(tail + n, std::memory_order_release);
+    return n;
+  }
+
+  bool push(const T& item) { return push(&item, 1) == 1; }
+
+  /**
+   * @brief 消费者批量读取
+   *
+   * @param out
+   * @param max_n
+   * @return size_t 实际读出的数量, 队列为空时返回0
+   */
+  size_t pop(T* out, size_t max_n) {
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    if (cached_tail_ == head) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+    }
+    size_t n = static_cast<size_t>(cached_tail_ - head);
+    if (n > max_n) n = max_n;
+    for (size_t i = 0; i < n; ++i) {
+      out[i] = buffer_[(head + i) & kMask];
+    }
+    head_.store(head + n, std::memory_order_release);
+    return n;
+  }
+
+  size_t size() const {
+    return static_cast<size_t>(tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire));
+  }
+
+  static constexpr size_t capacity() { return Capacity; }
+
+ private:
+  static constexpr uint64_t kMask = Capacity - 1;
+  static constexpr size_t kCacheLine = 64;
+
+  // 两侧索引之间用填充隔开到不同缓存行; 不用 alignas, 以免 C++14 下 new 出超对齐对象
+  char pad0_[kCacheLine];
+  // 消费者侧
+  std::atomic<uint64_t> head_;
+  uint64_t cached_tail_;
+  char pad1_[kCacheLine - sizeof(uint64_t) * 2];
+  // 生产者侧
+  std::atomic<uint64_t> tail_;
+  uint64_t cached_head_;
+  char pad2_[kCacheLine - sizeof(uint64_t) * 2];
+
+  T buffer_[Capacity];
+};
+
+}  // namespace millimeter_wave_radar
@@ -0,0 +1,60 @@
+/**
+ * @file can_record.cc
+ * @brief 录制can接口上的原始帧到二进制日志
+ *
+ * 用法: can_record <ifname> <output.log> [seconds]
+ * 不给时长则录制到 Ctrl-C
+ */
+
+#include <signal.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include "millimeter_wave_radar/can_log.h"
+#include "millimeter_wave_radar/can_socket.h"
+
+using namespace millimeter_wave_radar;
+
+static std::atomic<bool> g_running(true);
+
+static void onSignal(int) { g_running.store(false); }
+
+int main(int argc, char* argv[]) {
+  if (argc < 3) {
+    std::cerr << "usage: " << argv[0] << " <ifname> <output.log> [seconds]" << std::endl;
+    return 1;
+  }
+  const double seconds = argc > 3 ? atof(argv[3]) : 0;
+
+  CanSocket sock;
+  if (!sock.open(argv[1])) return 1;
+  CanLogWriter writer;
+  if (!writer.open(argv[2])) return 1;
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  const auto start = std::chrono::steady_clock::now();
+  const auto deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                    std::chrono::duration<double>(seconds));
+  StampedFrame frames[CanSocket::kMaxBatch];
+  uint64_t total = 0;
+  while (g_running.load()) {
+    if (seconds > 0 && std::chrono::steady_clock::now() >= deadline) break;
+    int n = sock.read(frames, CanSocket::kMaxBatch);
+    if (n < 0) break;
+    if (!writer.write(frames, n)) {
+      std::cerr << "write failed" << std::endl;
+      break;
+    }
+    total += n;
+  }
+  writer.close();
+
+  const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "recorded " << total << " frames in " << elapsed << " s" << std::endl;
+  return 0;
+}
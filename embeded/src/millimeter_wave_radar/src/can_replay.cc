@@ -0,0 +1,75 @@
+/**
+ * @file can_replay.cc
+ * @brief 把 can_record 录制的日志按原时间间隔回放到can接口(通常是vcan)
+ *
+ * 用法: can_replay <input.log> <ifname> [speed] [start_sec]
+ *   speed: 回放倍速, 默认1, 0为不限速
+ *   start_sec: 从日志开始后第几秒开始回放
+ *
+ * 创建vcan: ip link add dev vcan0 type vcan && ip link set up vcan0
+ */
+
+#include <signal.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+#include "millimeter_wave_radar/can_log.h"
+#include "millimeter_wave_radar/can_socket.h"
+
+using namespace millimeter_wave_radar;
+
+static std::atomic<bool> g_running(true);
+
+static void onSignal(int) { g_running.store(false); }
+
+int main(int argc, char* argv[]) {
+  if (argc < 3) {
+    std::cerr << "usage: " << argv[0] << " <input.log> <ifname> [speed] [start_sec]" << std::endl;
+    return 1;
+  }
+  const double speed = argc > 3 ? atof(argv[3]) : 1.0;
+  const double start_sec = argc > 4 ? atof(argv[4]) : 0;
+
+  CanLogReader log;
+  if (!log.open(argv[1])) return 1;
+  CanSocket sock;
+  if (!sock.open(argv[2], 0)) return 1;
+  if (log.size() == 0) {
+    std::cout << "empty log" << std::endl;
+    return 0;
+  }
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  size_t begin = log.lowerBound(log[0].stamp_ns + static_cast<uint64_t>(start_sec * 1e9));
+  if (begin >= log.size()) {
+    std::cout << "start time beyond end of log" << std::endl;
+    return 0;
+  }
+  const uint64_t first_stamp = log[begin].stamp_ns;
+  const auto start = std::chrono::steady_clock::now();
+  size_t sent = 0;
+  for (size_t i = begin; i < log.size() && g_running.load(); ++i) {
+    if (speed > 0) {
+      const auto offset =
+          std::chrono::nanoseconds(static_cast<int64_t>(static_cast<double>(log[i].stamp_ns - first_stamp) / speed));
+      std::this_thread::sleep_until(start + offset);
+    }
+    if (!sock.write(log[i].frame)) {
+      // 发送队列满时稍等重试一次
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+      if (!sock.write(log[i].frame)) break;
+    }
+    ++sent;
+  }
+
+  const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "replayed " << sent << " frames in " << elapsed << " s (" << sent / (elapsed > 0 ? elapsed : 1)
+            << " frames/s)" << std::endl;
+  return 0;
+}
@@ -1,25 +1,34 @@
 #include <ros/ros.h>
+#include <boost/make_shared.hpp>
 #include <linux/can.h>
-#include <linux/can/raw.h>
-#include <net/if.h>
-#include <string.h>
-#include <sys/ioctl.h>
-#include <sys/socket.h>
-#include <unistd.h>
-#include <condition_variable>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <mutex>
-#include <queue>
+#include <string>
 #include <thread>
 #include <vector>
 
 #include "millimeter_wave_radar/MmwObject.h"
 #include "millimeter_wave_radar/MmwObjects.h"
+#include "millimeter_wave_radar/MmwTrack.h"
+#include "millimeter_wave_radar/MmwTracks.h"
+#include "millimeter_wave_radar/ars408_decoder.h"
+#include "millimeter_wave_radar/can_log.h"
+#include "millimeter_wave_radar/can_socket.h"
+#include "millimeter_wave_radar/cycle_assembler.h"
+#include "millimeter_wave_radar/object_tracker.h"
+#include "millimeter_wave_radar/spsc_ring.h"
 
 using Object = millimeter_wave_radar::MmwObject;
 using Objects = millimeter_wave_radar::MmwObjects;
+using Tracks = millimeter_wave_radar::MmwTracks;
+using millimeter_wave_radar::StampedFrame;
+namespace ars408 = millimeter_wave_radar::ars408;
 
 // struct Object {
 //   uint8_t id;             // 目标id
@@ -44,171 +53,310 @@ using Objects = millimeter_wave_radar::MmwObjects;
 
 class Radar {
  public:
-  Radar() : ifname_("can0") {
+  /**
+   * @brief Construct a new Radar
+   *
+   * @param nh 发布话题用的句柄, nodelet 中传入 getMTNodeHandle() 即可走进程内零拷贝
+   * @param pnh 私有参数: ~ifname(can0), ~cycle_timeout(秒, 0.1), ~enable_tracker(true),
+   *            ~replay_file(空, 非空时从 can_record 录制的日志读帧而不是can接口), ~replay_speed(1.0, 0为不限速)
+   */
+  explicit Radar(const ros::NodeHandle& nh = ros::NodeHandle(), const ros::NodeHandle& pnh = ros::NodeHandle("~"))
+      : ifname_(pnh.param<std::string>("ifname", "can0")),
+        replay_file_(pnh.param<std::string>("replay_file", "")),
+        replay_speed_(pnh.param("replay_speed", 1.0)),
+        running_(true),
+        dropped_frames_(0),
+        assembler_(static_cast<uint64_t>(pnh.param("cycle_timeout", 0.1) * 1e9)),
+        enable_tracker_(pnh.param("enable_tracker", true)),
+        gnh_(nh) {
     objects_pub_ = gnh_.advertise<millimeter_wave_radar::MmwObjects>("objects", 10);
+    if (enable_tracker_) {
+      tracker_.reset(new millimeter_wave_radar::ObjectTracker());
+      tracks_pub_ = gnh_.advertise<millimeter_wave_radar::MmwTracks>("tracks", 10);
+    }
   }
 
   /**
-   * @brief 获取检测到的目标信息
+   * @brief 批量解码一个周期的 0x60B/0x60C/0x60D 帧, 按目标id合并到消息中
    *
-   * @return std::vector<Object>*
+   * @param cycle
+   * @param soa 解码用的列缓存
+   * @param msg
    */
-  std::vector<Object>* getObjects() { return &objects_; }
+  static void fillObjects(const millimeter_wave_radar::CycleFrames& cycle, ars408::ObjectCycleSoA& soa,
+                          Objects& msg) {
+    ars408::decodeGeneralBatch(cycle.general.data(), cycle.general.size(), soa);
+    ars408::decodeQualityBatch(cycle.quality.data(), cycle.quality.size(), soa);
+    ars408::decodeExtendedBatch(cycle.extended.data(), cycle.extended.size(), soa);
+
+    msg.stamp = ros::Time();
+    if (cycle.stamp_ns != 0) {
+      msg.stamp.fromNSec(cycle.stamp_ns);
+    }
+    msg.meas_count = cycle.meas_count;
+    msg.complete = cycle.complete;
+
+    std::vector<Object>& objects = msg.objects;
+    objects.resize(soa.general_size);
+    int16_t slot_of_id[ars408::ObjectCycleSoA::kMaxObjects];
+    std::fill(slot_of_id, slot_of_id + ars408::ObjectCycleSoA::kMaxObjects, -1);
+    for (size_t i = 0; i < soa.general_size; ++i) {
+      Object& obj = objects[i];
+      obj = Object();
+      obj.id = soa.id[i];
+      obj.dist_long = soa.dist_long[i];
+      obj.dist_lat = soa.dist_lat[i];
+      obj.vrel_long = soa.vrel_long[i];
+      obj.vrel_lat = soa.vrel_lat[i];
+      obj.sector_number = soa.sector_number[i];
+      obj.dyn_prop = soa.dyn_prop[i];
+      obj.rcs = soa.rcs[i];
+      slot_of_id[soa.id[i]] = static_cast<int16_t>(i);
+    }
+    for (size_t i = 0; i < soa.quality_size; ++i) {
+      int16_t slot = slot_of_id[soa.quality_id[i]];
+      if (slot < 0) continue;
+      objects[slot].prob_of_exist = soa.prob_of_exist[i];
+      objects[slot].meas_state = soa.meas_state[i];
+    }
+    for (size_t i = 0; i < soa.extended_size; ++i) {
+      int16_t slot = slot_of_id[soa.extended_id[i]];
+      if (slot < 0) continue;
+      Object& obj = objects[slot];
+      obj.arel_long = soa.arel_long[i];
+      obj.arel_lat = soa.arel_lat[i];
+      obj.obj_class = soa.obj_class[i];
+      obj.orientation_angle = soa.orientation_angle[i];
+      obj.length = soa.length[i];
+      obj.width = soa.width[i];
+    }
+  }
 
   /**
-   * @brief 主流程，负责从can接口读取消息并解析
+   * @brief 获取最近一次发布的目标信息, 可在其他线程调用
    *
+   * @return Objects::ConstPtr
    */
-  void run() {
-    std::thread reader_thread(std::bind(&Radar::can_reader, this, ifname_));
+  Objects::ConstPtr getObjects() const {
+    std::lock_guard<std::mutex> lock(latest_mutex_);
+    return latest_;
+  }
 
-    while (true) {
-      std::unique_lock<std::mutex> lock(mutex_);
-      cv_.wait(lock, [this] { return !can_queue_.empty(); });
+  /**
+   * @brief 通知 run() 退出
+   *
+   */
+  void stop() { running_.store(false); }
 
-      // 从队列中取出 CAN 帧并处理
-      can_frame frame = can_queue_.front();
-      can_queue_.pop();
+  /**
+   * @brief 主流程，负责从can接口读取消息并解析
+   *
+   * 读线程把帧写入无锁环形队列，当前线程按批取出解析，队列为空时短暂休眠，
+   * 不再按帧唤醒。周期收齐(或超时)后立即解码发布。
+   */
+  void run() {
+    std::thread reader_thread = replay_file_.empty()
+                                    ? std::thread(std::bind(&Radar::can_reader, this, ifname_.c_str()))
+                                    : std::thread(std::bind(&Radar::log_reader, this, replay_file_, replay_speed_));
 
-      // 处理 CAN 帧
-      process_can_frame(frame);
+    auto on_cycle = [this](const millimeter_wave_radar::CycleFrames& cycle) { publishCycle(cycle); };
+    StampedFrame batch[kParseBatch];
+    while (running_.load() && ros::ok()) {
+      size_t n = can_ring_.pop(batch, kParseBatch);
+      if (n == 0) {
+        assembler_.poll(monotonicNs(), on_cycle);
+        std::this_thread::sleep_for(std::chrono::microseconds(kIdleSleepUs));
+        continue;
+      }
+      const uint64_t now = monotonicNs();
+      for (size_t i = 0; i < n; ++i) {
+        assembler_.onFrame(batch[i].frame, batch[i].stamp_ns, now, on_cycle);
+      }
     }
 
+    running_.store(false);
     reader_thread.join();
+    if (dropped_frames_.load() > 0) {
+      ROS_WARN("radar can ring overflow, dropped %lu frames", static_cast<unsigned long>(dropped_frames_.load()));
+    }
+    const auto& stats = assembler_.stats();
+    ROS_INFO("radar cycles: %lu complete, %lu incomplete (%lu frames missing), %lu lost",
+             static_cast<unsigned long>(stats.complete_cycles), static_cast<unsigned long>(stats.incomplete_cycles),
+             static_cast<unsigned long>(stats.missing_frames), static_cast<unsigned long>(stats.lost_cycles));
   }
 
  private:
-  void can_reader(const char* ifname) {
-    int sock = socket(PF_CAN, SOCK_RAW, CAN_RAW);
-    if (sock < 0) {
-      perror("Error creating socket");
-      return;
-    }
-
-    struct sockaddr_can addr;
-    struct ifreq ifr;
-    strcpy(ifr.ifr_name, ifname);
-    ioctl(sock, SIOCGIFINDEX, &ifr);
+  static constexpr size_t kRingSize = 1024;   // 约4个满载(250目标)周期
+  static constexpr size_t kReadBatch = millimeter_wave_radar::CanSocket::kMaxBatch;
+  static constexpr size_t kParseBatch = 128;  // 解析线程单次最多取出的帧数
+  static constexpr size_t kMsgPoolSize = 3;   // 预分配的发布消息数
+  static constexpr float kDefaultCycleTime = 0.072f;  // 缺少时间戳时假定的周期(秒)
+  static constexpr int64_t kIdleSleepUs = 500;  // 队列为空时的休眠(微秒)
 
-    addr.can_family = AF_CAN;
-    addr.can_ifindex = ifr.ifr_ifindex;
+  static uint64_t monotonicNs() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+  }
 
-    if (bind(sock, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
-      perror("Error binding socket");
-      close(sock);
+  void can_reader(const char* ifname) {
+    millimeter_wave_radar::CanSocket sock;
+    if (!sock.open(ifname)) {
       return;
     }
 
-    while (true) {
-      can_frame frame;
-      ssize_t nbytes = read(sock, &frame, sizeof(frame));
-      if (nbytes < 0) {
-        perror("Error reading from socket");
-        break;
-      } else if (nbytes == sizeof(frame)) {
-        {
-          std::lock_guard<std::mutex> lock(mutex_);
-          can_queue_.push(frame);
-        }
-        cv_.notify_one();
+    StampedFrame stamped[kReadBatch];
+    while (running_.load(std::memory_order_relaxed)) {
+      int n = sock.read(stamped, kReadBatch);
+      if (n < 0) break;
+      size_t pushed = can_ring_.push(stamped, n);
+      if (pushed < static_cast<size_t>(n)) {
+        dropped_frames_.fetch_add(n - pushed, std::memory_order_relaxed);
       }
     }
-
-    close(sock);
   }
 
-  void process_can_frame(const can_frame& frame) {
-    // 处理收到的 CAN 帧
-    std::cout << "Received CAN frame: ID=0x" << std::hex << frame.can_id << ", DLC=" << static_cast<int>(frame.can_dlc)
-              << ", Data=";
-    for (int i = 0; i < frame.can_dlc; ++i) {
-      std::cout << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(frame.data[i]) << " ";
-    }
-    std::cout << std::dec << std::setfill(' ') << "\n";
-    if ((uint32_t)frame.can_id == 0x60a) {
-      auto head_info = parseObjectListStatus(frame);
-      std::cout << "n: " << head_info[0] << std::endl;
-      std::cout << "meas count: " << head_info[1] << std::endl;
-      std::cout << "interface version: " << head_info[2] << std::endl;
-    } else if ((uint32_t)frame.can_id == 0x60b) {
-      parseObjectGeneralInformation(frame);
+  /**
+   * @brief 按记录的时间间隔回放日志到解析线程
+   *
+   * @param path can_record 录制的日志
+   * @param speed 回放倍速, 0为不限速
+   */
+  void log_reader(const std::string& path, double speed) {
+    millimeter_wave_radar::CanLogReader log;
+    if (!log.open(path)) {
+      return;
+    }
+    ROS_INFO("replaying %lu frames from %s at %s", static_cast<unsigned long>(log.size()), path.c_str(),
+             speed > 0 ? std::to_string(speed).c_str() : "max speed");
+
+    const auto start = std::chrono::steady_clock::now();
+    const uint64_t first_stamp = log.size() > 0 ? log[0].stamp_ns : 0;
+    StampedFrame stamped[kReadBatch];
+    size_t i = 0;
+    while (i < log.size() && running_.load(std::memory_order_relaxed)) {
+      if (speed > 0) {
+        const auto offset = std::chrono::nanoseconds(
+            static_cast<int64_t>(static_cast<double>(log[i].stamp_ns - first_stamp) / speed));
+        std::this_thread::sleep_until(start + offset);
+      }
+      // 同一时刻(或不限速时)的帧成批送入
+      size_t n = 0;
+      const uint64_t batch_stamp = log[i].stamp_ns;
+      while (i < log.size() && n < kReadBatch && (speed <= 0 || log[i].stamp_ns == batch_stamp)) {
+        stamped[n].frame = log[i].frame;
+        stamped[n].stamp_ns = log[i].stamp_ns;
+        ++n;
+        ++i;
+      }
+      // 回放时不丢帧, 队列满则等待
+      size_t pushed = 0;
+      while (pushed < n && running_.load(std::memory_order_relaxed)) {
+        pushed += can_ring_.push(stamped + pushed, n - pushed);
+        if (pushed < n) std::this_thread::yield();
+      }
     }
+    ROS_INFO("replay finished");
   }
 
   /**
-   * @brief  解析目标列表头信息(0x60a)
+   * @brief 取一个没有被订阅者持有的预分配消息
    *
-   * @param frame
-   * @return std::vector<int>
+   * 发布出去的消息可能仍被进程内订阅者持有, 此时不能改写, 只复用引用计数为1的消息
+   *
+   * @return Objects::Ptr
    */
-  std::vector<int> parseObjectListStatus(const can_frame& frame) {
-    // 先清空objects_
-    publishObjects();
-    std::vector<Object>().swap(objects_);
-
-    int objects_number = static_cast<int>(frame.data[0]);
-    int objects_meas_count = (static_cast<int>(frame.data[1]) << 8) + static_cast<int>(frame.data[2]);
-    int objects_interface_version = static_cast<int>(frame.data[3]) >> 4;
-    return std::vector<int>{objects_number, objects_meas_count, objects_interface_version};
+  Objects::Ptr acquireMessage() {
+    for (auto& msg : msg_pool_) {
+      if (msg && msg.unique()) return msg;
+    }
+    Objects::Ptr& slot = msg_pool_[next_pool_slot_++ % kMsgPoolSize];
+    slot = boost::make_shared<Objects>();
+    slot->objects.reserve(ars408::ObjectCycleSoA::kMaxObjects);
+    return slot;
   }
 
   /**
-   * @brief 解析目标的距离和速度信息, 存放到objects_中
+   * @brief 批量解码一个周期的 0x60B/0x60C/0x60D 帧, 按目标id合并后发布
    *
-   * @param frame
+   * @param cycle
    */
-  void parseObjectGeneralInformation(const can_frame& frame) {
-    Object obj;
-    obj.id = static_cast<int>(frame.data[0]);
-
-    float min, res;  // Res: 分辨率  Min:偏移量
-    int output;
-    // dist longitudinal
-    min = -500, res = 0.2;
-    output = (static_cast<int>(frame.data[1]) << 5) + (static_cast<int>(frame.data[2]) >> 3);
-    obj.dist_long = output * res + min;
-
-    // dist lateral
-    min = -204.6, res = 0.2;
-    output = (static_cast<int>(frame.data[2] & 7) << 8) + static_cast<int>(frame.data[3]);
-    obj.dist_lat = output * res + min;
-
-    // vrel longitudinal
-    min = -128.0, res = 0.25;
-    output = static_cast<int>(frame.data[4] << 2) + static_cast<int>(frame.data[5] >> 6);
-    obj.vrel_long = output * res + min;
-
-    // vrel lateral
-    min = -64, res = 0.25;
-    output = (static_cast<int>(frame.data[5] & 0x3f) << 3) + static_cast<int>(frame.data[6] >> 5);
-    obj.vrel_lat = output * res + min;
-
-    // sector number
-    obj.sector_number = static_cast<int>((frame.data[6] >> 3) & 0x03);
-
-    std::cout << obj;
-
-    objects_.emplace_back(obj);
-  }
+  void publishCycle(const millimeter_wave_radar::CycleFrames& cycle) {
+    {
+      // 释放上一周期的引用, 让它能被 acquireMessage() 复用
+      std::lock_guard<std::mutex> lock(latest_mutex_);
+      latest_.reset();
+    }
+    Objects::Ptr msg = acquireMessage();
+    fillObjects(cycle, cycle_, *msg);
 
+    // 发布后不再改写 msg, 直到订阅者全部释放
+    objects_pub_.publish(msg);
+    {
+      std::lock_guard<std::mutex> lock(latest_mutex_);
+      latest_ = msg;
+    }
+
+    if (tracker_) {
+      updateTracks(cycle);
+    }
+  }
 
   /**
-   * @brief 发布雷达信息话题
-   * 
+   * @brief 用本周期的目标更新跟踪器并发布已确认航迹
+   *
+   * @param cycle
    */
-  void publishObjects() {
-    Objects obj;
-    obj.objects = objects_;
-    objects_pub_.publish(obj);
+  void updateTracks(const millimeter_wave_radar::CycleFrames& cycle) {
+    float dt = kDefaultCycleTime;
+    if (cycle.stamp_ns != 0 && last_cycle_stamp_ns_ != 0 && cycle.stamp_ns > last_cycle_stamp_ns_) {
+      dt = static_cast<float>(cycle.stamp_ns - last_cycle_stamp_ns_) * 1e-9f;
+    }
+    last_cycle_stamp_ns_ = cycle.stamp_ns;
+    tracker_->step(cycle_, dt);
+
+    tracker_->confirmedTracks(confirmed_tracks_);
+    Tracks::Ptr msg = boost::make_shared<Tracks>();
+    msg->stamp.fromNSec(cycle.stamp_ns);
+    msg->meas_count = cycle.meas_count;
+    msg->tracks.resize(confirmed_tracks_.size());
+    for (size_t i = 0; i < confirmed_tracks_.size(); ++i) {
+      const millimeter_wave_radar::ObjectTracker::Track& t = confirmed_tracks_[i];
+      millimeter_wave_radar::MmwTrack& out = msg->tracks[i];
+      out.track_id = t.track_id;
+      out.object_id = t.object_id;
+      out.dist_long = t.x;
+      out.dist_lat = t.y;
+      out.vrel_long = t.vx;
+      out.vrel_lat = t.vy;
+      out.dist_long_var = t.x_var;
+      out.dist_lat_var = t.y_var;
+      out.hits = t.hits;
+      out.misses = t.misses;
+    }
+    tracks_pub_.publish(msg);
   }
 
-  const char* ifname_;
-  std::mutex mutex_;
-  std::condition_variable cv_;
-  std::vector<Object> objects_;
-  std::queue<can_frame> can_queue_;
+  std::string ifname_;
+  std::string replay_file_;
+  double replay_speed_;
+  std::atomic<bool> running_;
+  std::atomic<uint64_t> dropped_frames_;
+  millimeter_wave_radar::SpscRing<StampedFrame, kRingSize> can_ring_;
+  millimeter_wave_radar::CycleAssembler assembler_;
+  ars408::ObjectCycleSoA cycle_;
+  Objects::Ptr msg_pool_[kMsgPoolSize];
+  size_t next_pool_slot_ = 0;
+  mutable std::mutex latest_mutex_;  // latest_ 由解析线程写, getObjects() 可能在其他线程读
+  Objects::ConstPtr latest_;
+  bool enable_tracker_;
+  std::unique_ptr<millimeter_wave_radar::ObjectTracker> tracker_;
+  std::vector<millimeter_wave_radar::ObjectTracker::Track> confirmed_tracks_;
+  uint64_t last_cycle_stamp_ns_ = 0;
 
   // ros
   ros::NodeHandle gnh_;
   ros::Publisher objects_pub_;
+  ros::Publisher tracks_pub_;
 };
+
@@ -0,0 +1,286 @@
+/**
+ * @file radar_bench.cc
+ * @brief 雷达解析链路基准: 周期组装 -> 批量解码 -> 填充消息 -> 跟踪 -> 发布
+ *
+ * 用法: radar_bench [input.log] [repeat]
+ *   不给日志时生成满载(250目标, 含0x60C/0x60D)的模拟周期
+ *
+ * 输出:
+ *   frames/s          不限速送入解析的吞吐
+ *   parse latency     单帧处理耗时分位数(收齐一个周期的那一帧包含解码、跟踪和publish()调用)
+ *   decode+track latency  周期最后一帧到消息填充和跟踪完成的耗时分位数
+ *   publish latency   publish() 到同进程订阅者回调收到消息的耗时分位数;
+ *                     消息取自与节点相同的预分配池, 走进程内零拷贝. 需要 roscore, 连不上时跳过
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <unordered_map>
+
+#include "millimeter_wave_radar.cc"
+
+using namespace millimeter_wave_radar;
+
+namespace {
+
+uint64_t nowNs() {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+/**
+ * @brief 按信号表把原始值写回帧, 用于生成模拟数据
+ *
+ */
+void encode(can_frame& frame, const ars408::Signal& sig, uint32_t raw) {
+  uint64_t word = ars408::loadWord(frame);
+  word &= ~(sig.mask() << sig.shift());
+  word |= (static_cast<uint64_t>(raw) & sig.mask()) << sig.shift();
+  word = __builtin_bswap64(word);
+  memcpy(frame.data, &word, sizeof(word));
+}
+
+can_frame makeFrame(uint32_t id) {
+  can_frame frame;
+  memset(&frame, 0, sizeof(frame));
+  frame.can_id = id;
+  frame.can_dlc = 8;
+  return frame;
+}
+
+/**
+ * @brief 生成 cycles 个满载周期, 目标匀速运动
+ *
+ */
+std::vector<CanLogRecord> synthesize(size_t cycles, size_t objects) {
+  std::vector<CanLogRecord> records;
+  records.reserve(cycles * (1 + objects * 3));
+  const uint64_t cycle_ns = 72000000;
+  for (size_t c = 0; c < cycles; ++c) {
+    uint64_t stamp = 1000000000ull + c * cycle_ns;
+    can_frame header = makeFrame(ars408::kObjectStatus);
+    encode(header, ars408::status::kNofObjects, objects);
+    encode(header, ars408::status::kMeasCounter, c & 0xffff);
+    records.push_back(CanLogRecord{stamp, header});
+    for (size_t i = 0; i < objects; ++i) {
+      can_frame f = makeFrame(ars408::kObjectGeneral);
+      encode(f, ars408::general::kId, i);
+      // dist_long = 5 + i*1.5 + vx*t, 原始值 = (phys - offset) / factor
+      const float t = c * 0.072f;
+      const float vx = static_cast<float>(i % 7) - 3.0f;
+      const float x = 5.0f + i * 1.5f + vx * t;
+      const float y = static_cast<float>(i % 20) * 4.0f - 40.0f;
+      encode(f, ars408::general::kDistLong, static_cast<uint32_t>((x + 500.0f) / 0.2f));
+      encode(f, ars408::general::kDistLat, static_cast<uint32_t>((y + 204.6f) / 0.2f));
+      encode(f, ars408::general::kVrelLong, static_cast<uint32_t>((vx + 128.0f) / 0.25f));
+      encode(f, ars408::general::kVrelLat, static_cast<uint32_t>(64.0f / 0.25f));
+      records.push_back(CanLogRecord{stamp + 1000 * (i + 1), f});
+    }
+    for (size_t i = 0; i < objects; ++i) {
+      can_frame f = makeFrame(ars408::kObjectQuality);
+      encode(f, ars408::quality::kId, i);
+      encode(f, ars408::quality::kProbOfExist, 7);
+      records.push_back(CanLogRecord{stamp + 1000 * (objects + i + 1), f});
+    }
+    for (size_t i = 0; i < objects; ++i) {
+      can_frame f = makeFrame(ars408::kObjectExtended);
+      encode(f, ars408::extended::kId, i);
+      encode(f, ars408::extended::kLength, 20);
+      encode(f, ars408::extended::kWidth, 10);
+      records.push_back(CanLogRecord{stamp + 1000 * (2 * objects + i + 1), f});
+    }
+  }
+  return records;
+}
+
+/**
+ * @brief 发布一侧: 与 Radar 相同的消息池和进程内订阅者, 记录 publish() 到回调的耗时
+ *
+ */
+class PublishProbe {
+ public:
+  PublishProbe() : spinner_(1) {
+    pub_ = nh_.advertise<Objects>("objects", 10);
+    sub_ = nh_.subscribe<Objects>("objects", 10, &PublishProbe::onObjects, this);
+    spinner_.start();
+  }
+
+  ~PublishProbe() { spinner_.stop(); }
+
+  /**
+   * @brief 等订阅者连上
+   *
+   * @return false 超时
+   */
+  bool waitConnected(double timeout) {
+    const ros::WallTime deadline = ros::WallTime::now() + ros::WallDuration(timeout);
+    while (pub_.getNumSubscribers() == 0) {
+      if (ros::WallTime::now() > deadline) return false;
+      ros::WallDuration(0.01).sleep();
+    }
+    return true;
+  }
+
+  /**
+   * @brief 同 Radar::acquireMessage(), 只复用订阅者已经释放的消息
+   *
+   */
+  Objects::Ptr acquireMessage() {
+    for (auto& msg : pool_) {
+      if (msg && msg.unique()) return msg;
+    }
+    Objects::Ptr& slot = pool_[next_slot_++ % kPoolSize];
+    slot = boost::make_shared<Objects>();
+    slot->objects.reserve(ars408::ObjectCycleSoA::kMaxObjects);
+    return slot;
+  }
+
+  void publish(const Objects::Ptr& msg) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      in_flight_[msg.get()] = nowNs();
+    }
+    pub_.publish(msg);
+    published_++;
+  }
+
+  /**
+   * @brief 等已发布的消息都送到, 订阅者队列满丢掉的不再等
+   *
+   */
+  void drain(double timeout) {
+    const ros::WallTime deadline = ros::WallTime::now() + ros::WallDuration(timeout);
+    size_t last = 0;
+    while (ros::WallTime::now() < deadline) {
+      ros::WallDuration(0.05).sleep();
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (samples_.size() == published_ || (samples_.size() == last && last > 0)) break;
+      last = samples_.size();
+    }
+  }
+
+  size_t published() const { return published_; }
+
+  std::vector<uint64_t> samples() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return samples_;
+  }
+
+ private:
+  void onObjects(const Objects::ConstPtr& msg) {
+    const uint64_t now = nowNs();
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = in_flight_.find(msg.get());
+    if (it == in_flight_.end()) return;
+    samples_.push_back(now - it->second);
+    in_flight_.erase(it);
+  }
+
+  static constexpr size_t kPoolSize = 3;
+
+  ros::NodeHandle nh_;
+  ros::Publisher pub_;
+  ros::Subscriber sub_;
+  ros::AsyncSpinner spinner_;
+  Objects::Ptr pool_[kPoolSize];
+  size_t next_slot_ = 0;
+  size_t published_ = 0;
+  std::mutex mutex_;
+  std::unordered_map<const Objects*, uint64_t> in_flight_;  // 消息 -> publish() 时刻
+  std::vector<uint64_t> samples_;
+};
+
+void printPercentiles(const char* name, std::vector<uint64_t>& samples) {
+  if (samples.empty()) {
+    std::cout << name << ": no samples" << std::endl;
+    return;
+  }
+  std::sort(samples.begin(), samples.end());
+  auto at = [&samples](double q) { return samples[static_cast<size_t>(q * (samples.size() - 1))] / 1000.0; };
+  std::cout << name << " (us): p50=" << at(0.5) << " p90=" << at(0.9) << " p99=" << at(0.99)
+            << " p99.9=" << at(0.999) << " max=" << at(1.0) << " n=" << samples.size() << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  ros::init(argc, argv, "radar_bench", ros::init_options::NoRosout | ros::init_options::AnonymousName);
+  std::unique_ptr<PublishProbe> probe;
+  if (ros::master::check()) {
+    probe.reset(new PublishProbe());
+    if (!probe->waitConnected(5.0)) {
+      std::cerr << "subscriber did not connect, skipping publish" << std::endl;
+      probe.reset();
+    }
+  } else {
+    std::cerr << "no ros master, skipping publish" << std::endl;
+  }
+
+  CanLogReader log;
+  std::vector<CanLogRecord> synthetic;
+  const CanLogRecord* records;
+  size_t count;
+  if (argc > 1) {
+    if (!log.open(argv[1])) return 1;
+    records = log.begin();
+    count = log.size();
+  } else {
+    synthetic = synthesize(1000, 250);
+    records = synthetic.data();
+    count = synthetic.size();
+  }
+  const int repeat = argc > 2 ? atoi(argv[2]) : 5;
+
+  CycleAssembler assembler(100000000);
+  std::unique_ptr<ars408::ObjectCycleSoA> soa(new ars408::ObjectCycleSoA());
+  std::unique_ptr<ObjectTracker> tracker(new ObjectTracker());
+  Objects local_msg;
+  std::vector<uint64_t> parse_ns;
+  std::vector<uint64_t> decode_track_ns;
+  parse_ns.reserve(count * repeat);
+  uint64_t last_stamp = 0;
+  uint64_t frame_enter = 0;
+
+  auto on_cycle = [&](const CycleFrames& cycle) {
+    Objects::Ptr pooled = probe ? probe->acquireMessage() : Objects::Ptr();
+    Objects& msg = pooled ? *pooled : local_msg;
+    Radar::fillObjects(cycle, *soa, msg);
+    float dt = 0.072f;
+    if (last_stamp != 0 && cycle.stamp_ns > last_stamp) dt = (cycle.stamp_ns - last_stamp) * 1e-9f;
+    last_stamp = cycle.stamp_ns;
+    tracker->step(*soa, dt);
+    decode_track_ns.push_back(nowNs() - frame_enter);
+    if (probe) probe->publish(pooled);
+  };
+
+  const uint64_t begin = nowNs();
+  for (int r = 0; r < repeat; ++r) {
+    last_stamp = 0;
+    for (size_t i = 0; i < count; ++i) {
+      frame_enter = nowNs();
+      assembler.onFrame(records[i].frame, records[i].stamp_ns, frame_enter, on_cycle);
+      parse_ns.push_back(nowNs() - frame_enter);
+    }
+  }
+  const double elapsed = (nowNs() - begin) * 1e-9;
+
+  const auto& stats = assembler.stats();
+  std::cout << "frames: " << count * repeat << " in " << elapsed << " s, " << (count * repeat) / elapsed
+            << " frames/s" << std::endl;
+  std::cout << "cycles: " << stats.complete_cycles << " complete, " << stats.incomplete_cycles << " incomplete, "
+            << stats.lost_cycles << " lost; tracks: " << tracker->size() << std::endl;
+  printPercentiles("parse latency", parse_ns);
+  printPercentiles("decode+track latency", decode_track_ns);
+  if (probe) {
+    probe->drain(2.0);
+    std::vector<uint64_t> publish_ns = probe->samples();
+    std::cout << "published: " << probe->published() << ", delivered: " << publish_ns.size() << std::endl;
+    printPercentiles("publish latency", publish_ns);
+  }
+  return 0;
+}
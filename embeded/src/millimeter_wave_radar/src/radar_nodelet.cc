@@ -0,0 +1,34 @@
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+
+#include <memory>
+#include <thread>
+
+#include "millimeter_wave_radar.cc"
+
+namespace millimeter_wave_radar {
+
+/**
+ * @brief 雷达 nodelet, 与订阅者在同一 nodelet manager 中运行时目标列表以指针传递, 不做序列化
+ *
+ */
+class RadarNodelet : public nodelet::Nodelet {
+ public:
+  ~RadarNodelet() override {
+    if (radar_) radar_->stop();
+    if (worker_.joinable()) worker_.join();
+  }
+
+ private:
+  void onInit() override {
+    radar_.reset(new Radar(getMTNodeHandle(), getMTPrivateNodeHandle()));
+    worker_ = std::thread(&Radar::run, radar_.get());
+  }
+
+  std::unique_ptr<Radar> radar_;
+  std::thread worker_;
+};
+
+}  // namespace millimeter_wave_radar
+
+PLUGINLIB_EXPORT_CLASS(millimeter_wave_radar::RadarNodelet, nodelet::Nodelet)
@@ -0,0 +1,297 @@
+// 回显服务端压测: 单线程 epoll 客户端建立 conns 个连接, 每个连接发 size 字节, 收齐回显后再发下一个.
+// 所有连接建好后统计 seconds 秒内完成的请求数和往返延迟;
+// 给出 server_pid 时还输出服务端这段时间的 CPU 占用, 以及结束时的线程数和常驻内存.
+// 用法: echo_bench [port] [conns] [seconds] [size] [server_pid]
+// 例: ./reactor_echo_server 8989 1 & ./echo_bench 8989 10000 10 64 $!
+//     ./reactor_echo_server 8991 1 uring & ./echo_bench 8991 10000 10 64 $!
+//     ./multi_thread_server 8990 & ./echo_bench 8990 10000 10 64 $!
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/tcp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_CONNECTING 256           // 同时进行的 connect 数, 太多会溢出服务端的 listen 队列
+#define LATENCY_BUCKETS (1 << 20)    // 延迟直方图, 10us 一格, 约 10s
+#define LATENCY_UNIT_NS 10000
+
+enum { CONNECTING, RUNNING };
+
+struct client {
+  int fd;
+  int state;
+  size_t sent;
+  size_t received;
+  uint64_t start_ns;
+};
+
+struct bench {
+  int epoll_fd;
+  struct sockaddr_in addr;
+  size_t size;
+  char* message;
+  int connecting;
+  int connected;
+  int failed;
+  int measuring;
+  uint64_t requests;
+  uint64_t* latency;
+  uint64_t max_latency_ns;
+};
+
+static uint64_t now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void watch(struct bench* bench, struct client* client, uint32_t events, int op) {
+  struct epoll_event ev;
+  ev.events = events;
+  ev.data.ptr = client;
+  epoll_ctl(bench->epoll_fd, op, client->fd, &ev);
+}
+
+static void drop(struct bench* bench, struct client* client) {
+  close(client->fd);
+  client->fd = -1;
+  bench->failed++;
+}
+
+static int open_client(struct bench* bench, struct client* client) {
+  client->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  if (client->fd < 0) {
+    return -1;
+  }
+  int on = 1;
+  setsockopt(client->fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+  client->state = CONNECTING;
+  if (connect(client->fd, (struct sockaddr*)&bench->addr, sizeof(bench->addr)) < 0 && errno != EINPROGRESS) {
+    close(client->fd);
+    client->fd = -1;
+    return -1;
+  }
+  watch(bench, client, EPOLLOUT, EPOLL_CTL_ADD);
+  bench->connecting++;
+  return 0;
+}
+
+// 发送请求剩下的部分, 发不完时等可写
+static int send_request(struct bench* bench, struct client* client) {
+  while (client->sent < bench->size) {
+    ssize_t n = send(client->fd, bench->message + client->sent, bench->size - client->sent, MSG_NOSIGNAL);
+    if (n > 0) {
+      client->sent += n;
+    } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      watch(bench, client, EPOLLIN | EPOLLOUT, EPOLL_CTL_MOD);
+      return 0;
+    } else {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+static int start_request(struct bench* bench, struct client* client) {
+  client->sent = client->received = 0;
+  client->start_ns = now_ns();
+  return send_request(bench, client);
+}
+
+static void finish_request(struct bench* bench, struct client* client) {
+  if (!bench->measuring) {
+    return;
+  }
+  uint64_t ns = now_ns() - client->start_ns;
+  uint64_t bucket = ns / LATENCY_UNIT_NS;
+  bench->latency[bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1]++;
+  if (ns > bench->max_latency_ns) {
+    bench->max_latency_ns = ns;
+  }
+  bench->requests++;
+}
+
+static void handle(struct bench* bench, struct client* client, uint32_t events) {
+  if (client->state == CONNECTING) {
+    bench->connecting--;
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (getsockopt(client->fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err != 0) {
+      drop(bench, client);
+      return;
+    }
+    client->state = RUNNING;
+    bench->connected++;
+    watch(bench, client, EPOLLIN, EPOLL_CTL_MOD);
+    if (start_request(bench, client) < 0) {
+      drop(bench, client);
+    }
+    return;
+  }
+
+  if (events & EPOLLOUT) {
+    if (send_request(bench, client) < 0) {
+      drop(bench, client);
+      return;
+    }
+    if (client->sent == bench->size) {
+      watch(bench, client, EPOLLIN, EPOLL_CTL_MOD);
+    }
+  }
+
+  if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+    char buf[64 * 1024];
+    ssize_t n = recv(client->fd, buf, sizeof(buf), 0);
+    if (n <= 0) {
+      if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return;
+      }
+      drop(bench, client);
+      return;
+    }
+    client->received += n;
+    if (client->received >= bench->size && client->sent == bench->size) {
+      finish_request(bench, client);
+      if (start_request(bench, client) < 0) {
+        drop(bench, client);
+      }
+    }
+  }
+}
+
+// 从 /proc/<pid>/stat 读进程累计的 CPU 时间(秒)
+static double process_cpu_seconds(int pid) {
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+  FILE* fp = fopen(path, "r");
+  if (fp == NULL) {
+    return 0;
+  }
+  char line[1024];
+  double seconds = 0;
+  if (fgets(line, sizeof(line), fp) != NULL) {
+    // 进程名可能有空格, 从最后一个 ')' 之后数字段, utime/stime 是第 14/15 个字段
+    char* p = strrchr(line, ')');
+    unsigned long utime = 0, stime = 0;
+    if (p != NULL && sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) == 2) {
+      seconds = (double)(utime + stime) / sysconf(_SC_CLK_TCK);
+    }
+  }
+  fclose(fp);
+  return seconds;
+}
+
+static void print_process_status(int pid) {
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/%d/status", pid);
+  FILE* fp = fopen(path, "r");
+  if (fp == NULL) {
+    return;
+  }
+  char line[256];
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    if (strncmp(line, "VmRSS:", 6) == 0 || strncmp(line, "Threads:", 8) == 0) {
+      printf("server %s", line);
+    }
+  }
+  fclose(fp);
+}
+
+static double percentile(const struct bench* bench, double p) {
+  uint64_t target = (uint64_t)(bench->requests * p), count = 0;
+  for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+    count += bench->latency[i];
+    if (count > target) {
+      return (i + 1) * LATENCY_UNIT_NS / 1e3;
+    }
+  }
+  return bench->max_latency_ns / 1e3;
+}
+
+int main(int argc, char* argv[]) {
+  const int port = argc > 1 ? atoi(argv[1]) : 8989;
+  const int conns = argc > 2 ? atoi(argv[2]) : 10000;
+  const double seconds = argc > 3 ? atof(argv[3]) : 10;
+  const size_t size = argc > 4 ? strtoul(argv[4], NULL, 10) : 64;
+  const int server_pid = argc > 5 ? atoi(argv[5]) : 0;
+
+  // 每个连接一个 fd
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+  }
+
+  struct bench bench;
+  memset(&bench, 0, sizeof(bench));
+  bench.epoll_fd = epoll_create1(0);
+  bench.addr.sin_family = AF_INET;
+  bench.addr.sin_port = htons(port);
+  inet_pton(AF_INET, "127.0.0.1", &bench.addr.sin_addr.s_addr);
+  bench.size = size > 0 ? size : 1;
+  bench.message = malloc(bench.size);
+  memset(bench.message, 'x', bench.size);
+  bench.latency = calloc(LATENCY_BUCKETS, sizeof(uint64_t));
+
+  struct client* clients = calloc(conns, sizeof(struct client));
+  struct epoll_event* events = malloc(sizeof(struct epoll_event) * 1024);
+  int opened = 0;
+
+  // 建立连接, 最多等 30 秒
+  const uint64_t connect_begin = now_ns();
+  while ((opened < conns || bench.connecting > 0) && now_ns() - connect_begin < 30000000000ULL) {
+    while (opened < conns && bench.connecting < MAX_CONNECTING) {
+      if (open_client(&bench, &clients[opened++]) < 0) {
+        bench.failed++;
+      }
+    }
+    int n = epoll_wait(bench.epoll_fd, events, 1024, 100);
+    for (int i = 0; i < n; i++) {
+      handle(&bench, events[i].data.ptr, events[i].events);
+    }
+  }
+  const double connect_seconds = (now_ns() - connect_begin) / 1e9;
+  printf("connected %d of %d in %.2f s, failed %d\n", bench.connected, conns, connect_seconds, bench.failed);
+
+  // 计时
+  const double cpu_begin = server_pid > 0 ? process_cpu_seconds(server_pid) : 0;
+  const uint64_t begin = now_ns();
+  bench.measuring = 1;
+  while (now_ns() - begin < seconds * 1e9) {
+    int n = epoll_wait(bench.epoll_fd, events, 1024, 100);
+    for (int i = 0; i < n; i++) {
+      handle(&bench, events[i].data.ptr, events[i].events);
+    }
+  }
+  const double elapsed = (now_ns() - begin) / 1e9;
+  const double cpu = server_pid > 0 ? process_cpu_seconds(server_pid) - cpu_begin : 0;
+
+  printf("requests %llu in %.2f s: %.0f req/s, %.1f MB/s each way\n", (unsigned long long)bench.requests, elapsed,
+         bench.requests / elapsed, bench.requests * bench.size / elapsed / 1e6);
+  printf("latency us: p50 %.0f, p99 %.0f, p999 %.0f, max %.0f\n", percentile(&bench, 0.5),
+         percentile(&bench, 0.99), percentile(&bench, 0.999), bench.max_latency_ns / 1e3);
+  if (server_pid > 0) {
+    printf("server cpu %.0f%%\n", cpu / elapsed * 100);
+    print_process_status(server_pid);
+  }
+
+  for (int i = 0; i < opened; i++) {
+    if (clients[i].fd >= 0) {
+      close(clients[i].fd);
+    }
+  }
+  free(events);
+  free(clients);
+  free(bench.latency);
+  free(bench.message);
+  close(bench.epoll_fd);
+  return 0;
+}
@@ -1,10 +1,13 @@
+// 每个连接一个线程的回显服务端, 作为 reactor_echo_server 的对照
+// 用法: multi_thread_server [port]
 #include <arpa/inet.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/wait.h>
 #include <unistd.h>
-#include <pthread.h>
 
 void sys_err(char* str) {
   perror(str);
@@ -12,47 +15,74 @@ void sys_err(char* str) {
 }
 
 void* callback(void* arg) {
+  // fd 按值放进指针传过来, 不能把 int 的地址传给线程, 主线程下次 accept 会改掉它
+  int cfd = (int)(intptr_t)arg;
+  char buf[16 * 1024];
   while (1) {
-    char buf[1024];
-    memset(buf, 0, sizeof(buf));
-    arg = (int*)arg;
-    int ret = recv(arg, buf, strlen(buf) + 1, 0);
-    if (ret <= 0) {
-      sys_err("send error");
+    ssize_t len = recv(cfd, buf, sizeof(buf), 0);
+    if (len <= 0) {
+      break;
+    }
+    // 回显, send 可能只发出一部分
+    ssize_t sent = 0;
+    while (sent < len) {
+      ssize_t ret = send(cfd, buf + sent, len - sent, MSG_NOSIGNAL);
+      if (ret <= 0) {
+        break;
+      }
+      sent += ret;
+    }
+    if (sent < len) {
+      break;
     }
-    printf("recv: %s\n", buf);
-    sleep(1);
   }
+  close(cfd);
+  return NULL;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
   int lfd = socket(AF_INET, SOCK_STREAM, 0);
   if (lfd == -1) {
     sys_err("socket");
   }
 
+  int on = 1;
+  setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
   struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
   addr.sin_family = AF_INET;
-  addr.sin_port = htons(8989);
+  addr.sin_port = htons(argc > 1 ? atoi(argv[1]) : 8989);
   addr.sin_addr.s_addr = INADDR_ANY;
-  int ret = bind(lfd, &addr, sizeof(addr));
+  int ret = bind(lfd, (struct sockaddr*)&addr, sizeof(addr));
   if (ret == -1) {
     sys_err("bind");
   }
 
-  ret = listen(lfd, 128);
+  // 与 reactor 的默认值相同, 压测时大量连接同时到来
+  ret = listen(lfd, 1024);
   if (ret == -1) {
     sys_err("listen");
   }
+  signal(SIGPIPE, SIG_IGN);
 
   struct sockaddr_in cliaddr;
   socklen_t addrlen = sizeof(cliaddr);
   while (1) {
-    int cfd = accept(lfd, &cliaddr, &addrlen);
+    int cfd = accept(lfd, (struct sockaddr*)&cliaddr, &addrlen);
+    if (cfd == -1) {
+      perror("accept");
+      continue;
+    }
     pthread_t tid;
-    pthread_create(&tid, NULL, callback, cfd);
+    ret = pthread_create(&tid, NULL, callback, (void*)(intptr_t)cfd);
+    if (ret != 0) {
+      fprintf(stderr, "pthread_create: %s\n", strerror(ret));
+      close(cfd);
+      continue;
+    }
     pthread_detach(tid);
   }
 
   return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,577 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "reactor_internal.h"
+#include "uring.h"
+
+void slab_init(struct slab* slab, size_t object_size, size_t per_page) {
+  const size_t align = sizeof(max_align_t);
+  slab->object_size = (object_size + align - 1) / align * align;
+  slab->per_page = per_page > 0 ? per_page : 1;
+  slab->free_list = NULL;
+  slab->pages = NULL;
+}
+
+void* slab_alloc(struct slab* slab) {
+  if (slab->free_list == NULL) {
+    struct slab_page* page = malloc(sizeof(struct slab_page) + slab->object_size * slab->per_page);
+    if (page == NULL) {
+      return NULL;
+    }
+    page->next = slab->pages;
+    slab->pages = page;
+
+    char* objects = (char*)page->align;
+    for (size_t i = slab->per_page; i > 0; i--) {
+      struct slab_node* node = (struct slab_node*)(objects + (i - 1) * slab->object_size);
+      node->next = slab->free_list;
+      slab->free_list = node;
+    }
+  }
+
+  struct slab_node* node = slab->free_list;
+  slab->free_list = node->next;
+  return node;
+}
+
+void slab_free(struct slab* slab, void* object) {
+  struct slab_node* node = object;
+  node->next = slab->free_list;
+  slab->free_list = node;
+}
+
+void slab_destroy(struct slab* slab) {
+  while (slab->pages != NULL) {
+    struct slab_page* next = slab->pages->next;
+    free(slab->pages);
+    slab->pages = next;
+  }
+  slab->free_list = NULL;
+}
+
+static void close_worker(struct worker* worker) {
+  if (worker->uring != NULL) {
+    uring_worker_close(worker);
+  }
+  if (worker->listen_fd >= 0) {
+    close(worker->listen_fd);
+  }
+  if (worker->epoll_fd >= 0) {
+    close(worker->epoll_fd);
+  }
+  if (worker->event_fd >= 0) {
+    close(worker->event_fd);
+  }
+  worker->listen_fd = worker->epoll_fd = worker->event_fd = -1;
+}
+
+static int open_epoll(struct worker* worker) {
+  worker->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (worker->epoll_fd < 0) {
+    return -1;
+  }
+
+  // 监听 socket 和 eventfd 用成员地址区分于连接
+  struct epoll_event ev;
+  ev.events = EPOLLIN | EPOLLET;
+  ev.data.ptr = &worker->listen_fd;
+  if (epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, worker->listen_fd, &ev) < 0) {
+    return -1;
+  }
+  ev.events = EPOLLIN;
+  ev.data.ptr = &worker->event_fd;
+  return epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, worker->event_fd, &ev);
+}
+
+static int open_worker(struct worker* worker, const struct reactor_options* options) {
+  worker->listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  worker->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (worker->listen_fd < 0 || worker->event_fd < 0) {
+    return -1;
+  }
+
+  // 每个线程一个监听 socket, 内核按四元组哈希把连接分给它们, 不会惊群
+  int on = 1;
+  setsockopt(worker->listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  if (setsockopt(worker->listen_fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0) {
+    return -1;
+  }
+  // accept 出来的连接继承 TCP_NODELAY, 省去每个连接一次 setsockopt
+  setsockopt(worker->listen_fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(options->port);
+  addr.sin_addr.s_addr = INADDR_ANY;
+  if (bind(worker->listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+      listen(worker->listen_fd, options->backlog) < 0) {
+    return -1;
+  }
+
+  if (worker->reactor->backend == REACTOR_BACKEND_URING) {
+    return uring_worker_open(worker);
+  }
+  return open_epoll(worker);
+}
+
+struct reactor* reactor_create(const struct reactor_options* options) {
+  struct reactor* reactor = calloc(1, sizeof(struct reactor));
+  if (reactor == NULL) {
+    return NULL;
+  }
+
+  reactor->options = *options;
+  struct reactor_options* opts = &reactor->options;
+  if (opts->threads <= 0) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    opts->threads = cpus > 0 ? (int)cpus : 1;
+  }
+  if (opts->backlog <= 0) {
+    opts->backlog = 1024;
+  }
+  if (opts->buffer_size == 0) {
+    opts->buffer_size = 16 * 1024;
+  }
+  if (opts->max_events <= 0) {
+    opts->max_events = 256;
+  }
+  if (opts->ring_buffers == 0) {
+    opts->ring_buffers = 256;
+  }
+  reactor->backend = opts->backend == REACTOR_BACKEND_URING && uring_supported() ? REACTOR_BACKEND_URING
+                                                                                 : REACTOR_BACKEND_EPOLL;
+
+  reactor->n_workers = opts->threads;
+  reactor->workers = calloc(reactor->n_workers, sizeof(struct worker));
+  if (reactor->workers == NULL) {
+    free(reactor);
+    return NULL;
+  }
+
+  for (int i = 0; i < reactor->n_workers; i++) {
+    struct worker* worker = &reactor->workers[i];
+    worker->reactor = reactor;
+    worker->listen_fd = worker->epoll_fd = worker->event_fd = -1;
+    slab_init(&worker->conns, sizeof(struct reactor_conn), 256);
+    slab_init(&worker->buffers, opts->buffer_size, 64);
+    if (open_worker(worker, opts) < 0) {
+      int err = errno;
+      // 内核缺少 provided buffer ring 等功能时 io_uring 初始化失败, 退回 epoll
+      if (i == 0 && reactor->backend == REACTOR_BACKEND_URING) {
+        close_worker(worker);
+        reactor->backend = REACTOR_BACKEND_EPOLL;
+        i--;
+        continue;
+      }
+      for (int j = 0; j <= i; j++) {
+        close_worker(&reactor->workers[j]);
+      }
+      free(reactor->workers);
+      free(reactor);
+      errno = err;
+      return NULL;
+    }
+  }
+  return reactor;
+}
+
+struct reactor_conn* conn_create(struct worker* worker, int fd) {
+  struct reactor_conn* conn = slab_alloc(&worker->conns);
+  if (conn == NULL) {
+    return NULL;
+  }
+  memset(conn, 0, sizeof(*conn));
+  conn->fd = fd;
+  conn->worker = worker;
+  conn->held_head = conn->held_tail = -1;
+
+  conn->next = worker->head;
+  if (worker->head != NULL) {
+    worker->head->prev = conn;
+  }
+  worker->head = conn;
+  STAT_ADD(worker->stats.accepted, 1);
+  return conn;
+}
+
+void conn_release_buffers(struct reactor_conn* conn) {
+  struct slab* buffers = &conn->worker->buffers;
+  if (conn->in != NULL && conn->in_len == 0) {
+    slab_free(buffers, conn->in);
+    conn->in = NULL;
+  }
+  if (conn->out != NULL && conn->out_begin == conn->out_end && !conn->send_inflight) {
+    slab_free(buffers, conn->out);
+    conn->out = NULL;
+    conn->out_begin = conn->out_end = 0;
+  }
+}
+
+void conn_free(struct reactor_conn* conn) {
+  struct worker* worker = conn->worker;
+  if (worker->reactor->options.handler.on_close != NULL) {
+    worker->reactor->options.handler.on_close(conn);
+  }
+
+  conn->in_len = 0;
+  conn->out_begin = conn->out_end = 0;
+  conn->send_inflight = 0;
+  conn_release_buffers(conn);
+
+  if (conn->prev != NULL) {
+    conn->prev->next = conn->next;
+  } else {
+    worker->head = conn->next;
+  }
+  if (conn->next != NULL) {
+    conn->next->prev = conn->prev;
+  }
+  slab_free(&worker->conns, conn);
+  STAT_ADD(worker->stats.closed, 1);
+}
+
+int conn_process_input(struct reactor_conn* conn) {
+  const struct reactor_handler* handler = &conn->worker->reactor->options.handler;
+  size_t consumed = 0;
+  while (consumed < conn->in_len && !conn->closing) {
+    ssize_t n = handler->on_data(conn, conn->in + consumed, conn->in_len - consumed);
+    if (n < 0 || conn->broken) {
+      return -1;
+    }
+    if (n == 0) {
+      break;
+    }
+    consumed += n;
+  }
+
+  if (consumed > 0) {
+    memmove(conn->in, conn->in + consumed, conn->in_len - consumed);
+    conn->in_len -= consumed;
+  }
+  return 0;
+}
+
+static void destroy_conn(struct reactor_conn* conn) {
+  STAT_ADD(conn->worker->stats.syscalls, 1);
+  close(conn->fd);
+  conn_free(conn);
+}
+
+// 返回 -1 出错, 0 还有没发完的, 1 全部发完
+static int write_conn(struct reactor_conn* conn) {
+  while (conn->out_begin < conn->out_end) {
+    STAT_ADD(conn->worker->stats.syscalls, 1);
+    ssize_t n = send(conn->fd, conn->out + conn->out_begin, conn->out_end - conn->out_begin, MSG_NOSIGNAL);
+    if (n > 0) {
+      conn->out_begin += n;
+      STAT_ADD(conn->worker->stats.bytes_out, n);
+    } else if (n < 0 && errno == EINTR) {
+      continue;
+    } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return 0;
+    } else {
+      return -1;
+    }
+  }
+  conn->out_begin = conn->out_end = 0;
+  return 1;
+}
+
+// 边沿触发: 一直读到 EAGAIN(或读不满缓冲区), 每次读到的数据立即处理, 最后统一发送输出.
+// hangup 表示对端已关闭写, 不会再有事件, 必须读到 0 为止
+static int read_conn(struct reactor_conn* conn, int resume, int hangup) {
+  struct worker* worker = conn->worker;
+  const size_t size = worker->reactor->options.buffer_size;
+  if (resume && conn_process_input(conn) < 0) {
+    return -1;
+  }
+
+  while (1) {
+    while (!conn->closing) {
+      if (conn->in == NULL && (conn->in = slab_alloc(&worker->buffers)) == NULL) {
+        return -1;
+      }
+
+      const size_t space = size - conn->in_len;
+      if (space == 0) {
+        if (conn->out_begin < conn->out_end) {
+          conn->read_paused = 1;
+          break;
+        }
+        return -1;  // 消息比缓冲区大
+      }
+
+      STAT_ADD(worker->stats.syscalls, 1);
+      ssize_t n = recv(conn->fd, conn->in + conn->in_len, space, 0);
+      if (n > 0) {
+        conn->in_len += n;
+        STAT_ADD(worker->stats.bytes_in, n);
+        if (conn_process_input(conn) < 0) {
+          return -1;
+        }
+        // 读不满说明内核缓冲区已空, 之后到达的数据会再触发一次事件, 省一次返回 EAGAIN 的 recv
+        if ((size_t)n < space && !hangup) {
+          break;
+        }
+      } else if (n == 0) {
+        // 对端不再发送, 发完已有的输出再关
+        conn->closing = 1;
+      } else if (errno == EINTR) {
+        continue;
+      } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        break;
+      } else {
+        return -1;
+      }
+    }
+
+    int written = write_conn(conn);
+    if (written < 0 || (written > 0 && conn->closing)) {
+      return -1;
+    }
+    // 暂停读之后输出一次就发完了, 不会再有 EPOLLOUT 来恢复, 这里接着处理剩下的输入再读
+    if (written == 0 || !conn->read_paused) {
+      break;
+    }
+    conn->read_paused = 0;
+    if (conn_process_input(conn) < 0) {
+      return -1;
+    }
+  }
+  conn_release_buffers(conn);
+  return 0;
+}
+
+static void handle_conn(struct reactor_conn* conn, uint32_t events) {
+  if (events & EPOLLERR) {
+    destroy_conn(conn);
+    return;
+  }
+
+  if ((events & EPOLLOUT) && conn->out_begin < conn->out_end) {
+    int written = write_conn(conn);
+    if (written < 0 || (written > 0 && conn->closing)) {
+      destroy_conn(conn);
+      return;
+    }
+    if (written > 0 && conn->read_paused) {
+      conn->read_paused = 0;
+      if (read_conn(conn, 1, (events & (EPOLLRDHUP | EPOLLHUP)) != 0) < 0) {
+        destroy_conn(conn);
+        return;
+      }
+    }
+    conn_release_buffers(conn);
+  }
+
+  if ((events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) && !conn->read_paused) {
+    if (read_conn(conn, 0, (events & (EPOLLRDHUP | EPOLLHUP)) != 0) < 0) {
+      destroy_conn(conn);
+    }
+  }
+}
+
+static void accept_conns(struct worker* worker) {
+  const struct reactor_handler* handler = &worker->reactor->options.handler;
+  while (1) {
+    STAT_ADD(worker->stats.syscalls, 1);
+    int fd = accept4(worker->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      // EAGAIN 取完了; EMFILE 等错误留在队列里, 等下一个连接到来时再试
+      break;
+    }
+
+    struct reactor_conn* conn = conn_create(worker, fd);
+    if (conn == NULL) {
+      close(fd);
+      continue;
+    }
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = conn;
+    STAT_ADD(worker->stats.syscalls, 1);
+    if (epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+      destroy_conn(conn);
+      continue;
+    }
+
+    if (handler->on_open != NULL) {
+      handler->on_open(conn);
+      int written = conn->broken ? -1 : write_conn(conn);
+      if (written < 0 || (written > 0 && conn->closing)) {
+        destroy_conn(conn);
+        continue;
+      }
+      conn_release_buffers(conn);
+    }
+  }
+}
+
+static void epoll_loop(struct worker* worker) {
+  struct reactor* reactor = worker->reactor;
+  const int max_events = reactor->options.max_events;
+  struct epoll_event* events = malloc(sizeof(struct epoll_event) * max_events);
+  if (events == NULL) {
+    return;
+  }
+
+  while (!reactor->stopping) {
+    STAT_ADD(worker->stats.syscalls, 1);
+    int n = epoll_wait(worker->epoll_fd, events, max_events, -1);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+
+    for (int i = 0; i < n; i++) {
+      void* ptr = events[i].data.ptr;
+      if (ptr == &worker->listen_fd) {
+        accept_conns(worker);
+      } else if (ptr == &worker->event_fd) {
+        uint64_t value;
+        while (read(worker->event_fd, &value, sizeof(value)) > 0) {
+        }
+      } else {
+        handle_conn(ptr, events[i].events);
+      }
+    }
+  }
+
+  free(events);
+}
+
+static void* worker_loop(void* arg) {
+  struct worker* worker = arg;
+  if (worker->reactor->backend == REACTOR_BACKEND_URING) {
+    uring_worker_loop(worker);
+  } else {
+    epoll_loop(worker);
+  }
+  return NULL;
+}
+
+int reactor_run(struct reactor* reactor) {
+  int started = 1;
+  for (int i = 1; i < reactor->n_workers; i++, started++) {
+    if (pthread_create(&reactor->workers[i].thread, NULL, worker_loop, &reactor->workers[i]) != 0) {
+      reactor_stop(reactor);
+      break;
+    }
+  }
+
+  worker_loop(&reactor->workers[0]);
+  for (int i = 1; i < started; i++) {
+    pthread_join(reactor->workers[i].thread, NULL);
+  }
+  return started == reactor->n_workers ? 0 : -1;
+}
+
+void reactor_stop(struct reactor* reactor) {
+  reactor->stopping = 1;
+  for (int i = 0; i < reactor->n_workers; i++) {
+    uint64_t one = 1;
+    ssize_t ret = write(reactor->workers[i].event_fd, &one, sizeof(one));
+    (void)ret;
+  }
+}
+
+void reactor_destroy(struct reactor* reactor) {
+  for (int i = 0; i < reactor->n_workers; i++) {
+    struct worker* worker = &reactor->workers[i];
+    // io_uring 后端的连接在 uring_worker_close() 里随文件表一起关闭
+    while (worker->uring == NULL && worker->head != NULL) {
+      destroy_conn(worker->head);
+    }
+    close_worker(worker);
+    slab_destroy(&worker->conns);
+    slab_destroy(&worker->buffers);
+  }
+  free(reactor->workers);
+  free(reactor);
+}
+
+enum reactor_backend reactor_get_backend(const struct reactor* reactor) {
+  return reactor->backend;
+}
+
+int reactor_send(struct reactor_conn* conn, const void* data, size_t len) {
+  const size_t size = conn->worker->reactor->options.buffer_size;
+  if (conn->closing || conn->broken || len > size) {
+    return -1;
+  }
+  if (conn->out == NULL && (conn->out = slab_alloc(&conn->worker->buffers)) == NULL) {
+    return -1;
+  }
+
+  // 放不下时先挪到缓冲区开头, 还放不下就先发一部分. 内核正在发送时都不能做
+  if (size - conn->out_end < len && conn->out_begin > 0 && !conn->send_inflight) {
+    memmove(conn->out, conn->out + conn->out_begin, conn->out_end - conn->out_begin);
+    conn->out_end -= conn->out_begin;
+    conn->out_begin = 0;
+  }
+  if (size - conn->out_end < len && conn->worker->uring == NULL) {
+    if (write_conn(conn) < 0) {
+      conn->broken = 1;
+      return -1;
+    }
+    if (conn->out_begin > 0) {
+      memmove(conn->out, conn->out + conn->out_begin, conn->out_end - conn->out_begin);
+      conn->out_end -= conn->out_begin;
+      conn->out_begin = 0;
+    }
+  }
+  if (size - conn->out_end < len) {
+    return -1;
+  }
+
+  memcpy(conn->out + conn->out_end, data, len);
+  conn->out_end += len;
+  return 0;
+}
+
+void reactor_close(struct reactor_conn* conn) {
+  conn->closing = 1;
+}
+
+int reactor_fd(const struct reactor_conn* conn) {
+  return conn->worker->uring != NULL ? -1 : conn->fd;
+}
+
+void* reactor_user(const struct reactor_conn* conn) {
+  return conn->worker->reactor->options.user;
+}
+
+void* reactor_conn_data(const struct reactor_conn* conn) {
+  return conn->data;
+}
+
+void reactor_set_conn_data(struct reactor_conn* conn, void* data) {
+  conn->data = data;
+}
+
+void reactor_get_stats(const struct reactor* reactor, struct reactor_stats* stats) {
+  memset(stats, 0, sizeof(*stats));
+  for (int i = 0; i < reactor->n_workers; i++) {
+    const struct reactor_stats* s = &reactor->workers[i].stats;
+    stats->accepted += __atomic_load_n(&s->accepted, __ATOMIC_RELAXED);
+    stats->closed += __atomic_load_n(&s->closed, __ATOMIC_RELAXED);
+    stats->bytes_in += __atomic_load_n(&s->bytes_in, __ATOMIC_RELAXED);
+    stats->bytes_out += __atomic_load_n(&s->bytes_out, __ATOMIC_RELAXED);
+    stats->syscalls += __atomic_load_n(&s->syscalls, __ATOMIC_RELAXED);
+  }
+}
@@ -0,0 +1,98 @@
+// 事件驱动的 TCP 服务端: 每个工作线程一个事件循环和一个 SO_REUSEPORT 监听 socket,
+// 由内核把新连接分给各线程, 连接从此只在该线程上处理, 线程之间不加锁.
+// 连接和读写缓冲区都从线程自己的 slab 分配, 连接空闲时归还缓冲区, 大量空闲连接只占连接结构体.
+// 协议由 reactor_handler 的回调实现, 见 reactor_echo_server.c.
+//
+// 事件循环有两种后端:
+// 1、epoll: 边沿触发, 非阻塞 accept4/recv/send
+// 2、io_uring: 多次触发的 accept 把连接直接放进注册的文件表, 多次触发的 recv 从内核管理的
+//    provided buffer 环里取缓冲区, send 也提交到环上, 一次 io_uring_enter 处理一批连接.
+//    需要内核 >= 6.0, 不支持时 reactor_create() 退回 epoll
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct reactor;
+struct reactor_conn;
+
+struct reactor_handler {
+  // 新连接, 可为 NULL
+  void (*on_open)(struct reactor_conn* conn);
+
+  // 收到数据, data 是尚未消费的全部输入.
+  // 返回消费的字节数, 剩下的留到下次; 返回 -1 关闭连接.
+  // 缓冲区满了还一个字节都不消费时, 若输出未发完则暂停读, 否则认为消息过长并关闭连接.
+  ssize_t (*on_data)(struct reactor_conn* conn, const char* data, size_t len);
+
+  // 连接关闭前, 可为 NULL
+  void (*on_close)(struct reactor_conn* conn);
+};
+
+enum reactor_backend {
+  REACTOR_BACKEND_EPOLL,
+  REACTOR_BACKEND_URING,
+};
+
+struct reactor_options {
+  uint16_t port;
+  int threads;         // 工作线程数, <= 0 时用 CPU 数
+  int backlog;         // listen 队列长度, 默认 1024
+  size_t buffer_size;  // 每个连接读/写缓冲区的大小, 默认 16KB
+  int max_events;      // 每次 epoll_wait 最多取的事件数, 默认 256
+  enum reactor_backend backend;
+  unsigned ring_buffers;  // io_uring 后端每个线程给 recv 的 buffer_size 大小的缓冲区数, 2 的幂, 默认 256
+  struct reactor_handler handler;
+  void* user;          // 传给回调的上下文, 见 reactor_user()
+};
+
+// 创建并监听, 失败返回 NULL 并设置 errno
+struct reactor* reactor_create(const struct reactor_options* options);
+
+// 在当前线程和 threads - 1 个新线程上处理事件, 直到 reactor_stop()
+int reactor_run(struct reactor* reactor);
+
+// 可在任意线程或信号处理函数中调用
+void reactor_stop(struct reactor* reactor);
+
+// reactor_run() 返回后调用, 关闭所有连接
+void reactor_destroy(struct reactor* reactor);
+
+// 实际使用的后端
+enum reactor_backend reactor_get_backend(const struct reactor* reactor);
+
+// 追加到连接的写缓冲区, 本次读到的数据都处理完后一起发送.
+// 写缓冲区放不下时返回 -1, 什么也不写; 此时 on_data 应少消费, 等输出发完再处理剩下的输入.
+int reactor_send(struct reactor_conn* conn, const void* data, size_t len);
+
+// 发完写缓冲区后关闭
+void reactor_close(struct reactor_conn* conn);
+
+// io_uring 后端的连接只在注册的文件表里, 没有 fd, 返回 -1
+int reactor_fd(const struct reactor_conn* conn);
+void* reactor_user(const struct reactor_conn* conn);
+void* reactor_conn_data(const struct reactor_conn* conn);
+void reactor_set_conn_data(struct reactor_conn* conn, void* data);
+
+struct reactor_stats {
+  uint64_t accepted;
+  uint64_t closed;
+  uint64_t bytes_in;
+  uint64_t bytes_out;
+  uint64_t syscalls;  // 事件循环里的系统调用次数
+};
+
+// 所有线程的计数之和, 近似值
+void reactor_get_stats(const struct reactor* reactor, struct reactor_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
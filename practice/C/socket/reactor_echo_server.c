@@ -0,0 +1,54 @@
+// 基于 reactor 的回显服务端
+// 用法: reactor_echo_server [port] [threads] [epoll|uring]
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "reactor.h"
+
+static struct reactor* server;
+
+static void on_signal(int num) {
+  (void)num;
+  reactor_stop(server);
+}
+
+// 收到多少回多少, 写缓冲区放不下时不消费, 等发完再回
+static ssize_t echo(struct reactor_conn* conn, const char* data, size_t len) {
+  return reactor_send(conn, data, len) == 0 ? (ssize_t)len : 0;
+}
+
+int main(int argc, char* argv[]) {
+  struct reactor_options options = {0};
+  options.port = argc > 1 ? atoi(argv[1]) : 8989;
+  options.threads = argc > 2 ? atoi(argv[2]) : 0;
+  options.backend = argc > 3 && strcmp(argv[3], "uring") == 0 ? REACTOR_BACKEND_URING : REACTOR_BACKEND_EPOLL;
+  options.handler.on_data = echo;
+
+  server = reactor_create(&options);
+  if (server == NULL) {
+    perror("reactor_create");
+    return 1;
+  }
+
+  struct sigaction act;
+  act.sa_handler = on_signal;
+  act.sa_flags = 0;
+  sigemptyset(&act.sa_mask);
+  sigaction(SIGINT, &act, NULL);
+  sigaction(SIGTERM, &act, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  printf("listening on %d (%s)\n", options.port,
+         reactor_get_backend(server) == REACTOR_BACKEND_URING ? "io_uring" : "epoll");
+  reactor_run(server);
+
+  struct reactor_stats stats;
+  reactor_get_stats(server, &stats);
+  printf("accepted %llu, closed %llu, in %llu bytes, out %llu bytes, %llu syscalls\n",
+         (unsigned long long)stats.accepted, (unsigned long long)stats.closed, (unsigned long long)stats.bytes_in,
+         (unsigned long long)stats.bytes_out, (unsigned long long)stats.syscalls);
+  reactor_destroy(server);
+  return 0;
+}
@@ -0,0 +1,101 @@
+// reactor.c(公共部分和 epoll 后端) 与 reactor_uring.c(io_uring 后端) 共用的内部结构
+#ifndef REACTOR_INTERNAL_H
+#define REACTOR_INTERNAL_H
+
+#include <pthread.h>
+#include <signal.h>
+
+#include "reactor.h"
+
+// 只有所属线程写, 其他线程用 reactor_get_stats() 读
+#define STAT_ADD(field, n) __atomic_store_n(&(field), (field) + (n), __ATOMIC_RELAXED)
+
+// 固定大小对象的分配器: 按页向 malloc 申请, 释放的对象挂到空闲链表上复用, 只在销毁时归还内存
+struct slab_node {
+  struct slab_node* next;
+};
+
+struct slab_page {
+  struct slab_page* next;
+  max_align_t align[];
+};
+
+struct slab {
+  size_t object_size;
+  size_t per_page;
+  struct slab_node* free_list;
+  struct slab_page* pages;
+};
+
+void slab_init(struct slab* slab, size_t object_size, size_t per_page);
+void* slab_alloc(struct slab* slab);
+void slab_free(struct slab* slab, void* object);
+void slab_destroy(struct slab* slab);
+
+struct uring_worker;
+
+struct worker {
+  struct reactor* reactor;
+  pthread_t thread;
+  int listen_fd;
+  int epoll_fd;
+  int event_fd;  // reactor_stop() 用来唤醒 epoll_wait / io_uring_enter
+  struct uring_worker* uring;
+  struct slab conns;
+  struct slab buffers;
+  struct reactor_conn* head;  // 所有连接, reactor_destroy() 时关闭
+  struct reactor_stats stats;
+};
+
+struct reactor {
+  struct reactor_options options;
+  enum reactor_backend backend;  // 实际使用的后端
+  int n_workers;
+  struct worker* workers;
+  volatile sig_atomic_t stopping;
+};
+
+struct reactor_conn {
+  int fd;           // io_uring 后端是文件表下标
+  int closing;      // reactor_close() 或对端关闭之后, 发完就关
+  int read_paused;  // 输入缓冲区满而输出没发完, 等输出发完再读
+  int broken;       // reactor_send() 里写失败
+  struct worker* worker;
+  char* in;  // 没有未消费的输入时归还给 slab
+  size_t in_len;
+  char* out;  // 没有待发送的输出时归还给 slab
+  size_t out_begin;
+  size_t out_end;
+  void* data;
+  struct reactor_conn* prev;
+  struct reactor_conn* next;
+
+  // io_uring 后端
+  int send_inflight;  // 内核正在发 out 里的数据, 这时不能挪动 out
+  int recv_armed;     // 多次触发的 recv 还在
+  int dead;           // 等进行中的操作完成后释放
+  int starved;        // 缓冲区用完导致 recv 停了, 在 starved 链表上
+  int held_head;      // 暂停读时留着的 provided buffer, 见 reactor_uring.c
+  int held_tail;
+  size_t held_offset;
+  struct reactor_conn* starved_next;
+};
+
+// 分配连接并加入 worker 的链表
+struct reactor_conn* conn_create(struct worker* worker, int fd);
+
+// 调用 on_close 并释放连接, 不关闭 fd
+void conn_free(struct reactor_conn* conn);
+
+// 把输入交给 on_data, 直到它不再消费. 返回 -1 时应关闭连接
+int conn_process_input(struct reactor_conn* conn);
+
+// 归还空的输入/输出缓冲区
+void conn_release_buffers(struct reactor_conn* conn);
+
+// io_uring 后端, 没有 io_uring 时不会被调用
+int uring_worker_open(struct worker* worker);
+void uring_worker_loop(struct worker* worker);
+void uring_worker_close(struct worker* worker);
+
+#endif
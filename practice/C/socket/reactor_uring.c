@@ -0,0 +1,519 @@
+// reactor 的 io_uring 后端
+//
+// 每个工作线程一个 ring:
+// 1、监听 socket 上一个多次触发的 accept, 新连接直接放进注册的文件表(IORING_FILE_INDEX_ALLOC),
+//    之后的 recv/send/close 都用文件表下标(IOSQE_FIXED_FILE), 没有普通 fd
+// 2、每个连接一个多次触发的 recv, 数据落在内核从 provided buffer 环里挑的缓冲区, 没有积压时
+//    on_data 直接在这块缓冲区上处理, 处理完还给内核; 只有不完整的消息才拷进连接的输入缓冲区
+// 3、每个连接同时最多一个 send, 发的是连接的输出缓冲区
+// 4、eventfd 上一个多次触发的 poll, reactor_stop() 用它唤醒
+// 输出发不完时暂停读: 取消 recv, 已经收到的缓冲区挂在连接上, 等输出发完再按顺序处理
+#define _GNU_SOURCE
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "reactor_internal.h"
+#include "uring.h"
+
+#ifdef URING_AVAILABLE
+
+// user_data 的低 3 位是操作类型, 其余是连接或 worker 的地址(至少 8 字节对齐)
+enum { OP_ACCEPT = 1, OP_WAKE, OP_RECV, OP_SEND, OP_CANCEL, OP_CLOSE };
+#define OP_MASK 7ULL
+
+struct uring_worker {
+  struct uring ring;
+  struct uring_buf_ring bufs;
+  int bufs_dirty;    // 有还给内核但还没 commit 的缓冲区
+  int* held_next;    // 暂停读时每个 provided buffer 在连接队列里的下一个
+  size_t* held_len;
+  struct reactor_conn* starved;  // recv 因为没有缓冲区停了的连接
+};
+
+static uint64_t pack(void* ptr, int op) {
+  return (uint64_t)(uintptr_t)ptr | op;
+}
+
+static void return_buf(struct uring_worker* u, int bid) {
+  uring_buf_ring_add(&u->bufs, bid);
+  u->bufs_dirty = 1;
+}
+
+static void arm_accept(struct worker* worker) {
+  struct io_uring_sqe* sqe = uring_get_sqe(&worker->uring->ring);
+  if (sqe == NULL) {
+    return;
+  }
+  sqe->opcode = IORING_OP_ACCEPT;
+  sqe->fd = worker->listen_fd;
+  sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+  sqe->file_index = IORING_FILE_INDEX_ALLOC;
+  uring_sqe_set_data(sqe, pack(worker, OP_ACCEPT));
+}
+
+static void arm_wake(struct worker* worker) {
+  struct io_uring_sqe* sqe = uring_get_sqe(&worker->uring->ring);
+  if (sqe == NULL) {
+    return;
+  }
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = worker->event_fd;
+  sqe->poll32_events = POLLIN;
+  sqe->len = IORING_POLL_ADD_MULTI;
+  uring_sqe_set_data(sqe, pack(worker, OP_WAKE));
+}
+
+static void arm_recv(struct reactor_conn* conn) {
+  struct uring_worker* u = conn->worker->uring;
+  struct io_uring_sqe* sqe = uring_get_sqe(&u->ring);
+  if (sqe == NULL) {
+    return;
+  }
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = conn->fd;
+  sqe->flags = IOSQE_FIXED_FILE | IOSQE_BUFFER_SELECT;
+  sqe->buf_group = u->bufs.group;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  uring_sqe_set_data(sqe, pack(conn, OP_RECV));
+  conn->recv_armed = 1;
+}
+
+static void cancel_recv(struct reactor_conn* conn) {
+  struct io_uring_sqe* sqe = uring_get_sqe(&conn->worker->uring->ring);
+  if (sqe == NULL) {
+    return;
+  }
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->addr = pack(conn, OP_RECV);
+  uring_sqe_set_data(sqe, pack(NULL, OP_CANCEL));
+}
+
+static void close_slot(struct worker* worker, int slot) {
+  struct io_uring_sqe* sqe = uring_get_sqe(&worker->uring->ring);
+  if (sqe == NULL) {
+    return;
+  }
+  sqe->opcode = IORING_OP_CLOSE;
+  sqe->file_index = slot + 1;
+  uring_sqe_set_data(sqe, pack(NULL, OP_CLOSE));
+}
+
+static void flush(struct reactor_conn* conn) {
+  if (conn->send_inflight || conn->out_begin == conn->out_end) {
+    return;
+  }
+  struct io_uring_sqe* sqe = uring_get_sqe(&conn->worker->uring->ring);
+  if (sqe == NULL) {
+    return;
+  }
+  sqe->opcode = IORING_OP_SEND;
+  sqe->fd = conn->fd;
+  sqe->flags = IOSQE_FIXED_FILE;
+  sqe->addr = (uint64_t)(uintptr_t)(conn->out + conn->out_begin);
+  sqe->len = conn->out_end - conn->out_begin;
+  sqe->msg_flags = MSG_NOSIGNAL;
+  uring_sqe_set_data(sqe, pack(conn, OP_SEND));
+  conn->send_inflight = 1;
+}
+
+static void hold(struct reactor_conn* conn, int bid, size_t len) {
+  struct uring_worker* u = conn->worker->uring;
+  u->held_len[bid] = len;
+  u->held_next[bid] = -1;
+  if (conn->held_tail >= 0) {
+    u->held_next[conn->held_tail] = bid;
+  } else {
+    conn->held_head = bid;
+    conn->held_offset = 0;
+  }
+  conn->held_tail = bid;
+}
+
+// 没有进行中的操作时关闭文件表里的连接并释放
+static void try_free(struct reactor_conn* conn) {
+  if (!conn->dead || conn->recv_armed || conn->send_inflight) {
+    return;
+  }
+  struct worker* worker = conn->worker;
+  struct uring_worker* u = worker->uring;
+  close_slot(worker, conn->fd);
+
+  while (conn->held_head >= 0) {
+    int bid = conn->held_head;
+    conn->held_head = u->held_next[bid];
+    return_buf(u, bid);
+  }
+  if (conn->starved) {
+    struct reactor_conn** p = &u->starved;
+    while (*p != conn) {
+      p = &(*p)->starved_next;
+    }
+    *p = conn->starved_next;
+  }
+  conn_free(conn);
+}
+
+static void kill_conn(struct reactor_conn* conn) {
+  if (conn->dead) {
+    return;
+  }
+  conn->dead = 1;
+  if (conn->recv_armed) {
+    cancel_recv(conn);
+  }
+}
+
+static void pause_read(struct reactor_conn* conn) {
+  if (!conn->read_paused) {
+    conn->read_paused = 1;
+    if (conn->recv_armed) {
+      cancel_recv(conn);
+    }
+  }
+}
+
+// 把收到的数据交给 on_data. 返回用掉的字节数, 少于 len 表示要等输出发完; -1 表示应关闭连接
+static ssize_t deliver(struct reactor_conn* conn, const char* data, size_t len) {
+  struct worker* worker = conn->worker;
+  const size_t size = worker->reactor->options.buffer_size;
+  if (conn->in_len == 0) {
+    // 没有积压时直接在 provided buffer 上处理, 剩下的不完整消息拷进输入缓冲区
+    const struct reactor_handler* handler = &worker->reactor->options.handler;
+    size_t used = 0;
+    while (used < len && !conn->closing) {
+      ssize_t n = handler->on_data(conn, data + used, len - used);
+      if (n < 0 || conn->broken) {
+        return -1;
+      }
+      if (n == 0) {
+        break;
+      }
+      used += n;
+    }
+    if (used == len || conn->closing) {
+      return len;
+    }
+    if (conn->in == NULL && (conn->in = slab_alloc(&worker->buffers)) == NULL) {
+      return -1;
+    }
+    // provided buffer 与输入缓冲区一样大, 一定放得下
+    memcpy(conn->in, data + used, len - used);
+    conn->in_len = len - used;
+    return len;
+  }
+
+  size_t used = 0;
+  while (used < len && !conn->closing) {
+    if (conn->in_len == size) {
+      // 输入缓冲区满了还消费不掉: 输出没发完时等发完, 否则是消息比缓冲区大
+      if (conn_process_input(conn) < 0) {
+        return -1;
+      }
+      if (conn->in_len == size) {
+        return conn->out_begin < conn->out_end ? (ssize_t)used : -1;
+      }
+      continue;
+    }
+    const size_t space = size - conn->in_len;
+    const size_t n = len - used < space ? len - used : space;
+    memcpy(conn->in + conn->in_len, data + used, n);
+    conn->in_len += n;
+    used += n;
+  }
+  if (conn_process_input(conn) < 0) {
+    return -1;
+  }
+  return len;
+}
+
+// 输出发完后继续处理积压的输入和挂着的缓冲区
+static void resume_read(struct reactor_conn* conn) {
+  struct uring_worker* u = conn->worker->uring;
+  conn->read_paused = 0;
+  if (conn->in_len > 0) {
+    if (conn_process_input(conn) < 0) {
+      kill_conn(conn);
+      return;
+    }
+    if (conn->in_len == conn->worker->reactor->options.buffer_size) {
+      if (conn->out_begin == conn->out_end) {
+        kill_conn(conn);  // 消息比缓冲区大
+      } else {
+        conn->read_paused = 1;
+      }
+      return;
+    }
+  }
+
+  while (conn->held_head >= 0) {
+    int bid = conn->held_head;
+    const size_t offset = conn->held_offset;
+    ssize_t used = deliver(conn, uring_buf(&u->bufs, bid) + offset, u->held_len[bid] - offset);
+    if (used < 0) {
+      kill_conn(conn);
+      return;
+    }
+    if (offset + used < u->held_len[bid]) {
+      conn->held_offset += used;
+      conn->read_paused = 1;
+      return;
+    }
+    conn->held_head = u->held_next[bid];
+    conn->held_offset = 0;
+    if (conn->held_head < 0) {
+      conn->held_tail = -1;
+    }
+    return_buf(u, bid);
+  }
+}
+
+// 每次连接上有操作完成后调用: 发送输出, 按需关闭, 重新提交 recv
+static void settle(struct reactor_conn* conn) {
+  if (!conn->dead && conn->broken) {
+    kill_conn(conn);
+  }
+  if (!conn->dead) {
+    flush(conn);
+    if (conn->closing && !conn->send_inflight) {
+      kill_conn(conn);
+    }
+  }
+  if (conn->dead) {
+    try_free(conn);
+    return;
+  }
+
+  if (!conn->recv_armed && !conn->closing && !conn->read_paused && conn->held_head < 0 && !conn->starved) {
+    arm_recv(conn);
+  }
+  conn_release_buffers(conn);
+}
+
+static void handle_recv(struct reactor_conn* conn, const struct io_uring_cqe* cqe) {
+  struct uring_worker* u = conn->worker->uring;
+  if (!(cqe->flags & IORING_CQE_F_MORE)) {
+    conn->recv_armed = 0;
+  }
+
+  if (cqe->flags & IORING_CQE_F_BUFFER) {
+    const int bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+    if (cqe->res <= 0 || conn->dead) {
+      return_buf(u, bid);
+    } else {
+      STAT_ADD(conn->worker->stats.bytes_in, cqe->res);
+      if (conn->read_paused || conn->held_head >= 0) {
+        hold(conn, bid, cqe->res);
+      } else {
+        ssize_t used = deliver(conn, uring_buf(&u->bufs, bid), cqe->res);
+        if (used < 0) {
+          return_buf(u, bid);
+          kill_conn(conn);
+        } else if (used < cqe->res) {
+          hold(conn, bid, cqe->res);
+          conn->held_offset = used;
+          pause_read(conn);
+        } else {
+          return_buf(u, bid);
+        }
+      }
+    }
+  }
+
+  if (cqe->res == 0) {
+    // 对端不再发送, 发完已有的输出再关. 还有等输出发完才能处理的输入时先不管,
+    // 处理完后重新提交的 recv 会再收到一次
+    if (!conn->read_paused && conn->held_head < 0 && (conn->in_len == 0 || conn->out_begin == conn->out_end)) {
+      conn->closing = 1;
+    }
+  } else if (cqe->res == -ENOBUFS) {
+    if (!conn->starved) {
+      conn->starved = 1;
+      conn->starved_next = u->starved;
+      u->starved = conn;
+    }
+  } else if (cqe->res < 0 && cqe->res != -ECANCELED) {
+    kill_conn(conn);
+  }
+  settle(conn);
+}
+
+static void handle_send(struct reactor_conn* conn, const struct io_uring_cqe* cqe) {
+  conn->send_inflight = 0;
+  if (cqe->res < 0) {
+    kill_conn(conn);
+  } else {
+    conn->out_begin += cqe->res;
+    STAT_ADD(conn->worker->stats.bytes_out, cqe->res);
+    if (conn->out_begin == conn->out_end) {
+      conn->out_begin = conn->out_end = 0;
+      // on_data 之前因为输出放不下没消费的输入, 现在可以继续了
+      if (conn->read_paused || conn->in_len > 0) {
+        resume_read(conn);
+      }
+    }
+  }
+  settle(conn);
+}
+
+static void handle_accept(struct worker* worker, const struct io_uring_cqe* cqe) {
+  if (!(cqe->flags & IORING_CQE_F_MORE) && !worker->reactor->stopping) {
+    arm_accept(worker);
+  }
+  if (cqe->res < 0) {
+    return;
+  }
+
+  struct reactor_conn* conn = conn_create(worker, cqe->res);
+  if (conn == NULL) {
+    close_slot(worker, cqe->res);
+    return;
+  }
+  const struct reactor_handler* handler = &worker->reactor->options.handler;
+  if (handler->on_open != NULL) {
+    handler->on_open(conn);
+  }
+  settle(conn);
+}
+
+// 缓冲区还回去之后, 重新提交因为缺缓冲区停掉的 recv
+static void rearm_starved(struct uring_worker* u) {
+  struct reactor_conn* conn = u->starved;
+  u->starved = NULL;
+  while (conn != NULL) {
+    struct reactor_conn* next = conn->starved_next;
+    conn->starved = 0;
+    if (!conn->recv_armed && !conn->closing && !conn->read_paused && conn->held_head < 0) {
+      arm_recv(conn);
+    }
+    conn = next;
+  }
+}
+
+int uring_worker_open(struct worker* worker) {
+  struct uring_worker* u = calloc(1, sizeof(struct uring_worker));
+  if (u == NULL) {
+    return -1;
+  }
+  worker->uring = u;
+  const struct reactor_options* options = &worker->reactor->options;
+
+  int ret = uring_init(&u->ring, 4096, 16384);
+  if (ret < 0) {
+    errno = -ret;
+    return -1;
+  }
+
+  // 文件表的大小受 RLIMIT_NOFILE 限制
+  struct rlimit limit;
+  unsigned files = 65536;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < files) {
+    files = limit.rlim_cur;
+  }
+  ret = uring_register_files_sparse(&u->ring, files);
+  if (ret >= 0) {
+    ret = uring_buf_ring_init(&u->ring, &u->bufs, 0, options->ring_buffers, options->buffer_size);
+  }
+  if (ret < 0) {
+    errno = -ret;
+    return -1;
+  }
+
+  u->held_next = calloc(options->ring_buffers, sizeof(int));
+  u->held_len = calloc(options->ring_buffers, sizeof(size_t));
+  if (u->held_next == NULL || u->held_len == NULL) {
+    errno = ENOMEM;
+    return -1;
+  }
+
+  arm_accept(worker);
+  arm_wake(worker);
+  return 0;
+}
+
+void uring_worker_loop(struct worker* worker) {
+  struct uring_worker* u = worker->uring;
+  struct reactor* reactor = worker->reactor;
+  uint64_t enters = u->ring.enters;
+  while (!reactor->stopping) {
+    if (u->bufs_dirty) {
+      uring_buf_ring_commit(&u->bufs);
+      u->bufs_dirty = 0;
+    }
+    rearm_starved(u);
+
+    int ret = uring_submit_and_wait(&u->ring, 1);
+    STAT_ADD(worker->stats.syscalls, u->ring.enters - enters);
+    enters = u->ring.enters;
+    if (ret < 0 && ret != -EINTR && ret != -EAGAIN && ret != -EBUSY) {
+      break;
+    }
+
+    struct io_uring_cqe* cqe;
+    while ((cqe = uring_peek_cqe(&u->ring)) != NULL) {
+      const struct io_uring_cqe event = *cqe;
+      uring_cqe_seen(&u->ring);
+
+      void* ptr = (void*)(uintptr_t)(event.user_data & ~OP_MASK);
+      switch (event.user_data & OP_MASK) {
+        case OP_ACCEPT:
+          handle_accept(worker, &event);
+          break;
+        case OP_WAKE: {
+          uint64_t value;
+          STAT_ADD(worker->stats.syscalls, 1);
+          ssize_t n = read(worker->event_fd, &value, sizeof(value));
+          (void)n;
+          if (!(event.flags & IORING_CQE_F_MORE)) {
+            arm_wake(worker);
+          }
+          break;
+        }
+        case OP_RECV:
+          handle_recv(ptr, &event);
+          break;
+        case OP_SEND:
+          handle_send(ptr, &event);
+          break;
+        default:
+          break;
+      }
+    }
+  }
+}
+
+void uring_worker_close(struct worker* worker) {
+  struct uring_worker* u = worker->uring;
+  // 关闭 ring 时内核取消所有操作并关闭文件表里的连接
+  while (worker->head != NULL) {
+    conn_free(worker->head);
+  }
+  uring_buf_ring_free(&u->ring, &u->bufs);
+  uring_exit(&u->ring);
+  free(u->held_next);
+  free(u->held_len);
+  free(u);
+  worker->uring = NULL;
+}
+
+#else
+
+int uring_worker_open(struct worker* worker) {
+  (void)worker;
+  errno = ENOSYS;
+  return -1;
+}
+
+void uring_worker_loop(struct worker* worker) {
+  (void)worker;
+}
+
+void uring_worker_close(struct worker* worker) {
+  (void)worker;
+}
+
+#endif
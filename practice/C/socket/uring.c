@@ -0,0 +1,242 @@
+#define _GNU_SOURCE
+#include "uring.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+#ifdef URING_AVAILABLE
+
+int uring_init(struct uring* ring, unsigned entries, unsigned cq_entries) {
+  memset(ring, 0, sizeof(*ring));
+  ring->fd = -1;
+  struct io_uring_params p;
+  memset(&p, 0, sizeof(p));
+  p.flags = IORING_SETUP_CQSIZE;
+  p.cq_entries = cq_entries > 0 ? cq_entries : entries * 2;
+#ifdef IORING_SETUP_COOP_TASKRUN
+  // 完成事件留到下次 io_uring_enter 时再处理, 不打断正在运行的线程
+  p.flags |= IORING_SETUP_COOP_TASKRUN;
+#endif
+
+  int fd = syscall(__NR_io_uring_setup, entries, &p);
+  if (fd < 0 && errno == EINVAL) {
+    p.flags = IORING_SETUP_CQSIZE;
+    fd = syscall(__NR_io_uring_setup, entries, &p);
+  }
+  if (fd < 0) {
+    return -errno;
+  }
+  ring->fd = fd;
+  ring->flags = p.flags;
+  ring->features = p.features;
+
+  ring->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  ring->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    if (ring->cq_ring_size > ring->sq_ring_size) {
+      ring->sq_ring_size = ring->cq_ring_size;
+    }
+    ring->cq_ring_size = ring->sq_ring_size;
+  }
+
+  ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                       IORING_OFF_SQ_RING);
+  if (ring->sq_ring == MAP_FAILED) {
+    int err = errno;
+    close(fd);
+    return -err;
+  }
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    ring->cq_ring = ring->sq_ring;
+  } else {
+    ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                         IORING_OFF_CQ_RING);
+    if (ring->cq_ring == MAP_FAILED) {
+      int err = errno;
+      munmap(ring->sq_ring, ring->sq_ring_size);
+      close(fd);
+      return -err;
+    }
+  }
+
+  ring->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+  ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+  if (ring->sqes == MAP_FAILED) {
+    int err = errno;
+    if (ring->cq_ring != ring->sq_ring) {
+      munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    close(fd);
+    return -err;
+  }
+
+  char* sq = ring->sq_ring;
+  ring->sq_head = (unsigned*)(sq + p.sq_off.head);
+  ring->sq_tail = (unsigned*)(sq + p.sq_off.tail);
+  ring->sq_mask = *(unsigned*)(sq + p.sq_off.ring_mask);
+  ring->sq_entries = p.sq_entries;
+  // sqe 按顺序使用, 下标数组固定为 0..n-1
+  unsigned* array = (unsigned*)(sq + p.sq_off.array);
+  for (unsigned i = 0; i < p.sq_entries; i++) {
+    array[i] = i;
+  }
+
+  char* cq = ring->cq_ring;
+  ring->cq_head = (unsigned*)(cq + p.cq_off.head);
+  ring->cq_tail = (unsigned*)(cq + p.cq_off.tail);
+  ring->cq_mask = *(unsigned*)(cq + p.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+  return 0;
+}
+
+void uring_exit(struct uring* ring) {
+  if (ring->fd < 0) {
+    return;
+  }
+  munmap(ring->sqes, ring->sqes_size);
+  if (ring->cq_ring != ring->sq_ring) {
+    munmap(ring->cq_ring, ring->cq_ring_size);
+  }
+  munmap(ring->sq_ring, ring->sq_ring_size);
+  close(ring->fd);
+  ring->fd = -1;
+}
+
+struct io_uring_sqe* uring_get_sqe(struct uring* ring) {
+  unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+  if (ring->sqe_tail - head >= ring->sq_entries) {
+    uring_submit_and_wait(ring, 0);
+    head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    if (ring->sqe_tail - head >= ring->sq_entries) {
+      return NULL;
+    }
+  }
+
+  struct io_uring_sqe* sqe = &ring->sqes[ring->sqe_tail & ring->sq_mask];
+  ring->sqe_tail++;
+  memset(sqe, 0, sizeof(*sqe));
+  return sqe;
+}
+
+int uring_submit_and_wait(struct uring* ring, unsigned wait_nr) {
+  __atomic_store_n(ring->sq_tail, ring->sqe_tail, __ATOMIC_RELEASE);
+  unsigned to_submit = ring->sqe_tail - ring->submitted;
+  if (to_submit == 0 && wait_nr == 0) {
+    return 0;
+  }
+
+  ring->enters++;
+  int ret = syscall(__NR_io_uring_enter, ring->fd, to_submit, wait_nr, wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0,
+                    NULL, 0);
+  if (ret < 0) {
+    return -errno;
+  }
+  ring->submitted += ret;
+  return ret;
+}
+
+int uring_register(struct uring* ring, unsigned opcode, const void* arg, unsigned nr_args) {
+  int ret = syscall(__NR_io_uring_register, ring->fd, opcode, arg, nr_args);
+  return ret < 0 ? -errno : ret;
+}
+
+int uring_register_files_sparse(struct uring* ring, unsigned n) {
+  struct io_uring_rsrc_register reg;
+  memset(&reg, 0, sizeof(reg));
+  reg.nr = n;
+  reg.flags = IORING_RSRC_REGISTER_SPARSE;
+  return uring_register(ring, IORING_REGISTER_FILES2, &reg, sizeof(reg));
+}
+
+int uring_buf_ring_init(struct uring* ring, struct uring_buf_ring* bufs, unsigned short group, unsigned count,
+                        size_t size) {
+  memset(bufs, 0, sizeof(*bufs));
+  if (count == 0 || (count & (count - 1)) != 0 || count > 32768) {
+    return -EINVAL;
+  }
+
+  // 内核和用户共享的环要按页对齐
+  bufs->ring_size = count * sizeof(struct io_uring_buf);
+  void* mem = mmap(NULL, bufs->ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED) {
+    return -errno;
+  }
+  bufs->ring = mem;
+  if (posix_memalign((void**)&bufs->base, 4096, count * size) != 0) {
+    munmap(mem, bufs->ring_size);
+    return -ENOMEM;
+  }
+  bufs->size = size;
+  bufs->count = count;
+  bufs->group = group;
+
+  struct io_uring_buf_reg reg;
+  memset(&reg, 0, sizeof(reg));
+  reg.ring_addr = (uint64_t)(uintptr_t)mem;
+  reg.ring_entries = count;
+  reg.bgid = group;
+  int ret = uring_register(ring, IORING_REGISTER_PBUF_RING, &reg, 1);
+  if (ret < 0) {
+    free(bufs->base);
+    munmap(mem, bufs->ring_size);
+    memset(bufs, 0, sizeof(*bufs));
+    return ret;
+  }
+
+  for (unsigned i = 0; i < count; i++) {
+    uring_buf_ring_add(bufs, i);
+  }
+  uring_buf_ring_commit(bufs);
+  return 0;
+}
+
+void uring_buf_ring_free(struct uring* ring, struct uring_buf_ring* bufs) {
+  if (bufs->ring == NULL) {
+    return;
+  }
+  struct io_uring_buf_reg reg;
+  memset(&reg, 0, sizeof(reg));
+  reg.bgid = bufs->group;
+  uring_register(ring, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+  munmap(bufs->ring, bufs->ring_size);
+  free(bufs->base);
+  memset(bufs, 0, sizeof(*bufs));
+}
+
+int uring_supported(void) {
+  static int supported = -1;
+  if (supported >= 0) {
+    return supported;
+  }
+
+  // 多次触发的 recv 从 6.0 开始才有, 没法在提交前探测
+  struct utsname name;
+  int major = 0, minor = 0;
+  if (uname(&name) != 0 || sscanf(name.release, "%d.%d", &major, &minor) != 2 || major < 6) {
+    supported = 0;
+    return supported;
+  }
+
+  // 被 seccomp 或 io_uring_disabled 禁用时 setup 失败
+  struct uring ring;
+  supported = uring_init(&ring, 4, 0) == 0;
+  if (supported) {
+    uring_exit(&ring);
+  }
+  return supported;
+}
+
+#else
+
+int uring_supported(void) {
+  return 0;
+}
+
+#endif
@@ -0,0 +1,128 @@
+// io_uring 的最小封装: 直接用内核接口(<linux/io_uring.h> 和系统调用), 不依赖 liburing.
+// 只有单线程使用一个 ring 的场景: 取 sqe, 提交并等待, 遍历 cqe, 注册文件/缓冲区和 provided buffer ring.
+#ifndef URING_H
+#define URING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+// 需要多次触发的 recv(6.0) 的头文件, 同时也就有了 provided buffer ring 和 IORING_FILE_INDEX_ALLOC(5.19).
+// IORING_REGISTER_PBUF_RING 是枚举, 没法用 #ifdef 判断
+#if defined(IORING_RECV_MULTISHOT) && defined(IORING_FILE_INDEX_ALLOC)
+#define URING_AVAILABLE 1
+#endif
+#endif
+#endif
+
+#ifdef URING_AVAILABLE
+
+struct uring {
+  int fd;
+  unsigned flags;
+  unsigned features;
+
+  // 提交队列
+  unsigned* sq_head;
+  unsigned* sq_tail;
+  unsigned sq_mask;
+  unsigned sq_entries;
+  unsigned sqe_tail;  // 已取出但还没提交的 sqe 之后
+  unsigned submitted; // 已交给内核的 sqe 之后
+  struct io_uring_sqe* sqes;
+
+  // 完成队列
+  unsigned* cq_head;
+  unsigned* cq_tail;
+  unsigned cq_mask;
+  struct io_uring_cqe* cqes;
+
+  void* sq_ring;
+  size_t sq_ring_size;
+  void* cq_ring;
+  size_t cq_ring_size;
+  size_t sqes_size;
+
+  uint64_t enters;  // io_uring_enter 调用次数
+};
+
+// 内核选择缓冲区的 recv 用的缓冲区: count 个 size 字节, 编号 0..count-1
+struct uring_buf_ring {
+  struct io_uring_buf_ring* ring;
+  size_t ring_size;
+  char* base;
+  size_t size;
+  unsigned count;
+  unsigned short group;
+  unsigned short tail;
+};
+
+// cq_entries 为 0 时取 2 * entries. 成功返回 0, 失败返回 -errno
+int uring_init(struct uring* ring, unsigned entries, unsigned cq_entries);
+void uring_exit(struct uring* ring);
+
+// 提交队列满时先提交已有的; 返回的 sqe 已清零
+struct io_uring_sqe* uring_get_sqe(struct uring* ring);
+
+// 提交所有 sqe 并至少等 wait_nr 个完成, 返回提交数或 -errno
+int uring_submit_and_wait(struct uring* ring, unsigned wait_nr);
+
+// 没有完成事件时返回 NULL, 处理完调用 uring_cqe_seen()
+static inline struct io_uring_cqe* uring_peek_cqe(struct uring* ring) {
+  unsigned head = *ring->cq_head;
+  if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+    return NULL;
+  }
+  return &ring->cqes[head & ring->cq_mask];
+}
+
+static inline void uring_cqe_seen(struct uring* ring) {
+  __atomic_store_n(ring->cq_head, *ring->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+static inline void uring_sqe_set_data(struct io_uring_sqe* sqe, uint64_t data) {
+  sqe->user_data = data;
+}
+
+int uring_register(struct uring* ring, unsigned opcode, const void* arg, unsigned nr_args);
+
+// 注册 n 个空位的文件表, 配合 IORING_FILE_INDEX_ALLOC 让 accept 直接返回文件表下标
+int uring_register_files_sparse(struct uring* ring, unsigned n);
+
+int uring_buf_ring_init(struct uring* ring, struct uring_buf_ring* bufs, unsigned short group, unsigned count,
+                        size_t size);
+void uring_buf_ring_free(struct uring* ring, struct uring_buf_ring* bufs);
+
+static inline char* uring_buf(const struct uring_buf_ring* bufs, unsigned bid) {
+  return bufs->base + (size_t)bid * bufs->size;
+}
+
+// 把缓冲区还给内核, 调用 uring_buf_ring_commit() 后生效
+static inline void uring_buf_ring_add(struct uring_buf_ring* bufs, unsigned bid) {
+  struct io_uring_buf* buf = &bufs->ring->bufs[bufs->tail & (bufs->count - 1)];
+  buf->addr = (uint64_t)(uintptr_t)uring_buf(bufs, bid);
+  buf->len = (uint32_t)bufs->size;
+  buf->bid = (uint16_t)bid;
+  bufs->tail++;
+}
+
+static inline void uring_buf_ring_commit(struct uring_buf_ring* bufs) {
+  __atomic_store_n(&bufs->ring->tail, bufs->tail, __ATOMIC_RELEASE);
+}
+
+#endif
+
+// 本机是否能用 io_uring 后端: 编译时有头文件, 运行时内核 >= 6.0 且没有被禁用
+int uring_supported(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1802,7 +1802,9 @@ using shared_ummap_sink = basic_shared_mmap_sink<unsigned char>;
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <condition_variable>
+#include <cstdint>
 #include <deque>
 #include <fstream>
 #include <memory>
@@ -1812,6 +1814,11 @@ using shared_ummap_sink = basic_shared_mmap_sink<unsigned char>;
 #include <thread>
 #include <vector>
 
+#if !defined(CSV_NO_SIMD) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define CSV_SIMD_X86
+#include <immintrin.h>
+#endif
+
 #include <memory>
 #include <unordered_map>
 #include <string>
@@ -4985,6 +4992,33 @@ namespace csv {
             return *this;
         }
 
+        /** Sets the number of threads used to parse memory-mapped files
+         *
+         *  With more than one thread, each chunk is split at row boundaries into
+         *  blocks which are parsed concurrently and handed to the reader in file order.
+         *
+         *  @param[in] n Number of parser threads, 0 uses std::thread::hardware_concurrency()
+         *  @note Ignored when reading from streams
+         *  @note Splitting assumes quotes only appear around fields or as escaped "" pairs (RFC 4180).
+         *        A chunk with a quote in the middle of a field is parsed on one thread.
+         */
+        CSVFormat& threads(size_t n) {
+            this->n_threads = n;
+            return *this;
+        }
+
+        /** Use a row index stored next to the file as `<filename>.idx`, building
+         *  it if it is missing or out of date
+         *
+         *  @note Needed by CSVReader::seek(), CSVReader::slice() and CSVReader::record_count().
+         *        Ignored when reading from streams.
+         *  @see  CSVIndex
+         */
+        CSVFormat& row_index(bool use = true) {
+            this->use_row_index = use;
+            return *this;
+        }
+
         #ifndef DOXYGEN_SHOULD_SKIP_THIS
         char get_delim() const {
             // This error should never be received by end users.
@@ -5001,6 +5035,10 @@ namespace csv {
         std::vector<char> get_possible_delims() const { return this->possible_delimiters; }
         std::vector<char> get_trim_chars() const { return this->trim_chars; }
         CONSTEXPR VariableColumnPolicy get_variable_column_policy() const { return this->variable_column_policy; }
+        size_t get_threads() const {
+            if (this->n_threads > 0) return this->n_threads;
+            return std::max(std::thread::hardware_concurrency(), 1u);
+        }
         #endif
         
         /** CSVFormat for guessing the delimiter */
@@ -5044,6 +5082,12 @@ namespace csv {
 
         /**< Allow variable length columns? */
         VariableColumnPolicy variable_column_policy = VariableColumnPolicy::IGNORE_ROW;
+
+        /**< Number of threads used to parse memory-mapped files */
+        size_t n_threads = 1;
+
+        /**< Whether or not to use a row index */
+        bool use_row_index = false;
     };
 }
 /** @file
@@ -5682,6 +5726,8 @@ namespace csv {
     class CSVRow {
     public:
         friend internals::IBasicCSVParser;
+        friend class ColumnReader;
+        friend class CSVStat;
 
         CSVRow() = default;
         
@@ -5781,6 +5827,14 @@ namespace csv {
         /** Retrieve a string view corresponding to the specified index */
         csv::string_view get_field(size_t index) const;
 
+        /** Like get_field(size_t), but unescapes quoted fields into buffer instead of
+         *  the cache shared by all rows of a chunk, so it may be called from any thread
+         */
+        csv::string_view get_field(size_t index, std::string& buffer) const;
+
+        /** Append the field str of length length to out, removing quote escapes */
+        void unescape_field(csv::string_view str, size_t length, std::string& out) const;
+
         internals::RawCSVDataPtr data;
 
         /** Where in RawCSVData.data we start */
@@ -5903,6 +5957,195 @@ namespace csv {
             return make_ws_flags(flags.data(), flags.size());
         }
 
+#ifdef _MSC_VER
+#pragma region Structural Scanner
+#endif
+        /** The characters which may end a run of ordinary field characters */
+        struct StructuralChars {
+            char delim = ',';
+            char quote = '"';
+            bool quoting = true;
+        };
+
+        /** Recover the delimiter and quote character from a ParseFlagMap */
+        inline StructuralChars structural_chars(const ParseFlagMap& parse_flags) {
+            StructuralChars chars;
+            chars.quoting = false;
+            for (int i = -128; i < 128; i++) {
+                if (parse_flags[i + 128] == ParseFlags::DELIMITER)
+                    chars.delim = (char)i;
+                else if (parse_flags[i + 128] == ParseFlags::QUOTE) {
+                    chars.quote = (char)i;
+                    chars.quoting = true;
+                }
+            }
+
+            return chars;
+        }
+
+        /** Bitmaps of structural characters, where bit i of word w describes byte 64 * w + i */
+        struct StructuralMasks {
+            std::vector<uint64_t> delim;
+            std::vector<uint64_t> quote;
+            std::vector<uint64_t> newline;
+        };
+
+        /** Instruction sets the structural scanner can use */
+        enum class ScanLevel {
+            SCALAR = 0,
+            SSE2 = 1,
+            AVX2 = 2
+        };
+
+        /** Index of the lowest set bit, x must not be zero */
+        inline int ctz64(uint64_t x) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+            return __builtin_ctzll(x);
+#else
+            int n = 0;
+            while (!(x & 1)) { x >>= 1; n++; }
+            return n;
+#endif
+        }
+
+        inline int popcount64(uint64_t x) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+            return __builtin_popcountll(x);
+#else
+            int n = 0;
+            for (; x; x &= x - 1) n++;
+            return n;
+#endif
+        }
+
+        /** Bit i of the result is the XOR of bits 0 through i of x
+         *
+         *  Applied to a quote mask, the set bits are the bytes inside quotes
+         *  (counting the opening quote, but not the closing one).
+         */
+        inline uint64_t prefix_xor(uint64_t x) noexcept {
+            x ^= x << 1;
+            x ^= x << 2;
+            x ^= x << 4;
+            x ^= x << 8;
+            x ^= x << 16;
+            x ^= x << 32;
+            return x;
+        }
+
+        /** Classify n bytes, writing (n + 63) / 64 words to each mask */
+        inline void scan_structural_scalar(const StructuralChars& chars, const char* data, size_t n,
+            uint64_t* delim, uint64_t* quote, uint64_t* newline) noexcept {
+            for (size_t w = 0; w * 64 < n; w++) {
+                const size_t len = std::min(n - w * 64, (size_t)64);
+                const char* in = data + w * 64;
+                uint64_t d = 0, q = 0, nl = 0;
+                for (size_t i = 0; i < len; i++) {
+                    d |= (uint64_t)(in[i] == chars.delim) << i;
+                    q |= (uint64_t)(in[i] == chars.quote) << i;
+                    nl |= (uint64_t)(in[i] == '\r' || in[i] == '\n') << i;
+                }
+
+                delim[w] = d;
+                quote[w] = chars.quoting ? q : 0;
+                newline[w] = nl;
+            }
+        }
+
+#ifdef CSV_SIMD_X86
+        __attribute__((target("sse2")))
+        inline void scan_structural_sse2(const StructuralChars& chars, const char* data, size_t n,
+            uint64_t* delim, uint64_t* quote, uint64_t* newline) noexcept {
+            const __m128i vd = _mm_set1_epi8(chars.delim), vq = _mm_set1_epi8(chars.quote),
+                vcr = _mm_set1_epi8('\r'), vlf = _mm_set1_epi8('\n');
+
+            size_t w = 0;
+            for (; (w + 1) * 64 <= n; w++) {
+                uint64_t d = 0, q = 0, nl = 0;
+                for (int k = 0; k < 4; k++) {
+                    const __m128i v = _mm_loadu_si128((const __m128i*)(data + w * 64 + k * 16));
+                    d |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, vd)) << (16 * k);
+                    q |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, vq)) << (16 * k);
+                    nl |= (uint64_t)(uint16_t)_mm_movemask_epi8(
+                        _mm_or_si128(_mm_cmpeq_epi8(v, vcr), _mm_cmpeq_epi8(v, vlf))) << (16 * k);
+                }
+
+                delim[w] = d;
+                quote[w] = chars.quoting ? q : 0;
+                newline[w] = nl;
+            }
+
+            if (w * 64 < n)
+                scan_structural_scalar(chars, data + w * 64, n - w * 64, delim + w, quote + w, newline + w);
+        }
+
+        __attribute__((target("avx2")))
+        inline uint64_t movemask_avx2(__m256i lo, __m256i hi) noexcept {
+            return (uint64_t)(uint32_t)_mm256_movemask_epi8(lo) | ((uint64_t)(uint32_t)_mm256_movemask_epi8(hi) << 32);
+        }
+
+        __attribute__((target("avx2")))
+        inline void scan_structural_avx2(const StructuralChars& chars, const char* data, size_t n,
+            uint64_t* delim, uint64_t* quote, uint64_t* newline) noexcept {
+            const __m256i vd = _mm256_set1_epi8(chars.delim), vq = _mm256_set1_epi8(chars.quote),
+                vcr = _mm256_set1_epi8('\r'), vlf = _mm256_set1_epi8('\n');
+
+            size_t w = 0;
+            for (; (w + 1) * 64 <= n; w++) {
+                const __m256i lo = _mm256_loadu_si256((const __m256i*)(data + w * 64));
+                const __m256i hi = _mm256_loadu_si256((const __m256i*)(data + w * 64 + 32));
+
+                delim[w] = movemask_avx2(_mm256_cmpeq_epi8(lo, vd), _mm256_cmpeq_epi8(hi, vd));
+                quote[w] = chars.quoting ? movemask_avx2(_mm256_cmpeq_epi8(lo, vq), _mm256_cmpeq_epi8(hi, vq)) : 0;
+                newline[w] = movemask_avx2(
+                    _mm256_or_si256(_mm256_cmpeq_epi8(lo, vcr), _mm256_cmpeq_epi8(lo, vlf)),
+                    _mm256_or_si256(_mm256_cmpeq_epi8(hi, vcr), _mm256_cmpeq_epi8(hi, vlf)));
+            }
+
+            if (w * 64 < n)
+                scan_structural_scalar(chars, data + w * 64, n - w * 64, delim + w, quote + w, newline + w);
+        }
+#endif
+
+        /** The best instruction set supported by this CPU, detected once */
+        inline ScanLevel best_scan_level() noexcept {
+#ifdef CSV_SIMD_X86
+            static const ScanLevel level = []() {
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("avx2") ? ScanLevel::AVX2 : ScanLevel::SSE2;
+            }();
+            return level;
+#else
+            return ScanLevel::SCALAR;
+#endif
+        }
+
+        /** Classify n bytes using the given instruction set, or the best available one below it */
+        inline void scan_structural(ScanLevel level, const StructuralChars& chars, const char* data, size_t n,
+            uint64_t* delim, uint64_t* quote, uint64_t* newline) noexcept {
+            level = std::min(level, best_scan_level());
+#ifdef CSV_SIMD_X86
+            if (level == ScanLevel::AVX2)
+                return scan_structural_avx2(chars, data, n, delim, quote, newline);
+            if (level == ScanLevel::SSE2)
+                return scan_structural_sse2(chars, data, n, delim, quote, newline);
+#endif
+            scan_structural_scalar(chars, data, n, delim, quote, newline);
+        }
+
+        /** Fill masks for all of data using the best available instruction set */
+        inline void scan_structural(const StructuralChars& chars, csv::string_view data, StructuralMasks& masks) {
+            const size_t words = (data.size() + 63) / 64;
+            masks.delim.resize(words);
+            masks.quote.resize(words);
+            masks.newline.resize(words);
+            scan_structural(best_scan_level(), chars, data.data(), data.size(),
+                masks.delim.data(), masks.quote.data(), masks.newline.data());
+        }
+#ifdef _MSC_VER
+#pragma endregion
+#endif
+
         CSV_INLINE size_t get_file_size(csv::string_view filename);
 
         CSV_INLINE std::string get_csv_head(csv::string_view filename);
@@ -6080,6 +6323,13 @@ namespace csv {
 
             /** Create a new RawCSVDataPtr for a new chunk of data */
             void reset_data_ptr();
+
+            /** Whether or not an attempt to find Unicode BOM has been made */
+            bool unicode_bom_scan = false;
+            bool _utf8_bom = false;
+
+            /** Where complete rows should be pushed to */
+            RowCollection* _records = nullptr;
         private:
             /** An array where the (i + 128)th slot determines whether ASCII character i should
              *  be trimmed
@@ -6091,12 +6341,8 @@ namespace csv {
             /** Where we are in the current data block */
             size_t data_pos = 0;
 
-            /** Whether or not an attempt to find Unicode BOM has been made */
-            bool unicode_bom_scan = false;
-            bool _utf8_bom = false;
-
-            /** Where complete rows should be pushed to */
-            RowCollection* _records = nullptr;
+            /** Structural characters of the current data block */
+            StructuralMasks _masks;
 
             CONSTEXPR_17 bool ws_flag(const char ch) const noexcept {
                 return _ws_flags.data()[ch + 128];
@@ -6108,6 +6354,11 @@ namespace csv {
 
             void parse_field() noexcept;
 
+            /** Position of the next character which is not NOT_SPECIAL given the
+             *  current quote state, or the end of the data block
+             */
+            size_t next_structural(size_t pos) const noexcept;
+
             /** Finish parsing the current field */
             void push_field();
 
@@ -6196,12 +6447,15 @@ namespace csv {
          */
         class MmapParser : public IBasicCSVParser {
         public:
+            /** @param[in] start Offset of the record to start parsing from */
             MmapParser(csv::string_view filename,
                 const CSVFormat& format,
-                const ColNamesPtr& col_names = nullptr
+                const ColNamesPtr& col_names = nullptr,
+                size_t start = 0
             ) : IBasicCSVParser(format, col_names) {
                 this->_filename = filename.data();
                 this->source_size = get_file_size(filename);
+                this->mmap_pos = start;
             };
 
             ~MmapParser() {}
@@ -6212,6 +6466,106 @@ namespace csv {
             std::string _filename;
             size_t mmap_pos = 0;
         };
+
+        /** Parses a range of a larger buffer which begins at the start of a row
+         *
+         *  Used by ParallelMmapParser, one per worker thread
+         */
+        class RangeParser : public IBasicCSVParser {
+        public:
+            RangeParser(const CSVFormat& format, const ColNamesPtr& col_names)
+                : IBasicCSVParser(format, col_names) {
+                // Only the beginning of the file may have a byte order mark
+                this->unicode_bom_scan = true;
+            }
+
+            void next(size_t) override {}
+
+            /** Parse data into rows
+             *
+             *  @param[in] source Owner of the memory data points into
+             *  @param[in] last   Whether or not data ends at the end of the source
+             *  @returns How many characters were read that are part of complete rows
+             */
+            size_t parse_range(const std::shared_ptr<void>& source, csv::string_view data, bool last);
+        };
+
+        /** Find the offsets at which a buffer may be split into independently parseable ranges
+         *
+         *  @par Implementation
+         *  The buffer is divided into equal blocks. Quote characters in each block are counted
+         *  in parallel, and the parity of the running count (prefix XOR) tells whether each
+         *  block starts inside a quoted field. Each boundary is then moved forward to just past
+         *  the first newline outside of quotes, which is where a sequential parse would start a row.
+         *
+         *  @note Assumes quotes only appear around fields or as escaped "" pairs (RFC 4180).
+         *        If a quote is found in the middle of a field, data is returned as a single
+         *        range since quote parity no longer tells where rows start.
+         *
+         *  @param[in] data  Buffer beginning at the start of a row, outside of quotes
+         *  @returns Offsets of range starts, with data.size() appended. Ranges may be empty.
+         */
+        std::vector<size_t> split_rows(csv::string_view data, size_t n_ranges, size_t n_threads,
+            const ParseFlagMap& parse_flags);
+
+        /** Count the quote characters in each block_size block of data, using n_threads threads
+         *
+         *  @param[out] stray_quotes If not null, set to whether a quote was found between two
+         *                           ordinary characters, i.e. in the middle of an unquoted field
+         */
+        std::vector<size_t> count_block_quotes(csv::string_view data, size_t block_size, size_t n_threads,
+            const StructuralChars& chars, bool* stray_quotes = nullptr);
+
+        /** Find where every record of data begins, as the parser would split it
+         *
+         *  Uses the quote parity approach of split_rows(). Unquoted newlines are found
+         *  block by block on n_threads threads, then paired up sequentially since the
+         *  parser consumes a newline directly following another one (CRLF, LFLF) as
+         *  part of the same line break.
+         *
+         *  @param[in] data  Buffer beginning at the start of a record, outside of quotes
+         *  @returns Offset of each record, starting with 0 unless data is empty
+         */
+        std::vector<uint64_t> find_record_starts(csv::string_view data, size_t n_threads,
+            const ParseFlagMap& parse_flags);
+
+        /** Parser for memory-mapped files which parses each chunk on several threads
+         *
+         *  @par Implementation
+         *  Each call to next() maps threads * bytes of the file, splits it into blocks
+         *  at row boundaries and lets the worker threads claim blocks from a shared counter,
+         *  so a thread which finishes early takes the remaining blocks instead of idling.
+         *  Every block is parsed into its own row buffer. The buffers are appended to the
+         *  output in file order, so rows are seen in the same order as with MmapParser.
+         */
+        class ParallelMmapParser : public IBasicCSVParser {
+        public:
+            /** @param[in] start Offset of the record to start parsing from */
+            ParallelMmapParser(csv::string_view filename,
+                const CSVFormat& format,
+                const ColNamesPtr& col_names = nullptr,
+                size_t start = 0
+            ) : IBasicCSVParser(format, col_names) {
+                this->_filename = filename.data();
+                this->source_size = get_file_size(filename);
+                this->mmap_pos = start;
+
+                for (size_t i = 0; i < format.get_threads(); i++)
+                    this->workers.emplace_back(new RangeParser(format, col_names));
+            };
+
+            ~ParallelMmapParser() {}
+
+            void next(size_t bytes) override;
+
+        private:
+            /** Number of blocks per worker in each chunk */
+            static constexpr size_t BLOCKS_PER_THREAD = 4;
+
+            std::string _filename;
+            size_t mmap_pos = 0;
+            std::vector<std::unique_ptr<RangeParser>> workers;
+        };
     }
 }
 
@@ -6242,6 +6596,74 @@ namespace csv {
     CSVGuessResult guess_format(csv::string_view filename,
         const std::vector<char>& delims = { ',', '|', '\t', ';', '^', '~' });
 
+    /** @class CSVIndex
+     *  @brief Byte offsets of the records of a CSV file, for random access to its rows
+     *
+     *  Every record the parser would produce is indexed, including the header, any
+     *  rows above it, and rows which CSVReader drops for having the wrong number of
+     *  fields (such as blank lines). Quotes are tracked like split_rows(), so
+     *  stray quotes inside unquoted fields can throw the index off.
+     *
+     *  @par Sidecar File
+     *  save() writes the index to `<filename>.idx`: a header recording the size and
+     *  modification time of the CSV and the delimiter and quote character it was
+     *  indexed with, followed by one 64-bit offset per record. load() rejects an
+     *  index whose header does not match, so edited files are re-indexed.
+     */
+    class CSVIndex {
+    public:
+        CSVIndex() = default;
+
+        /** Index a file using CSVFormat::threads() threads */
+        static CSVIndex build(csv::string_view filename, const CSVFormat& format);
+
+        /** Load the sidecar index of a file if it is up to date, otherwise build and save one */
+        static CSVIndex open(csv::string_view filename, const CSVFormat& format);
+
+        /** Path of the sidecar index of a file */
+        static std::string sidecar_path(csv::string_view filename) {
+            return std::string(filename) + ".idx";
+        }
+
+        /** Load the sidecar index of a file
+         *
+         *  @returns False if there is none, or it does not match the file or format
+         */
+        bool load(csv::string_view filename, const CSVFormat& format);
+
+        /** Write this index next to the file it was built from
+         *
+         *  @returns False if the sidecar file could not be written
+         */
+        bool save() const;
+
+        /** Number of records in the file */
+        size_t size() const noexcept { return this->starts.size(); }
+
+        /** Offset of a record from the start of the file */
+        uint64_t operator[](size_t record) const { return this->starts[record]; }
+
+    private:
+        /** Sidecar file header */
+        struct Header {
+            char magic[8];
+            uint64_t file_size;
+            int64_t file_mtime;
+            uint64_t n_records;
+            char delim;
+            char quote;
+            char quoting;
+            char reserved[5];
+        };
+
+        /** The header an index of filename read with format should have */
+        static Header make_header(csv::string_view filename, const CSVFormat& format);
+
+        std::string filename;
+        Header header = {};
+        std::vector<uint64_t> starts;
+    };
+
     /** @class CSVReader
      *  @brief Main class for parsing CSVs from files and in-memory sources
      *
@@ -6369,6 +6791,17 @@ namespace csv {
         bool utf8_bom() const noexcept { return this->parser->utf8_bom(); }
         ///@}
 
+        /** @name Random Access
+         *  These need a row index (see CSVFormat::row_index()) and throw a
+         *  `std::runtime_error` otherwise. Row numbers count every record after
+         *  the header, including ones read_row() would drop.
+         */
+        ///@{
+        size_t record_count() const;
+        void seek(size_t row);
+        std::vector<CSVRow> slice(size_t first, size_t count);
+        ///@}
+
     protected:
         /**
          * \defgroup csv_internal CSV Parser Internals
@@ -6396,6 +6829,12 @@ namespace csv {
         /** Queue of parsed CSV rows */
         std::unique_ptr<RowCollection> records{new RowCollection(100)};
 
+        /** @name Random Access State */
+        ///@{
+        std::string filename;                   /**< File being read, empty for streams */
+        std::shared_ptr<CSVIndex> row_index;    /**< Row index if CSVFormat::row_index() was used */
+        ///@}
+
         size_t n_cols = 0;  /**< The number of columns in this CSV */
         size_t _n_rows = 0; /**< How many rows (minus header) have been read so far */
 
@@ -6422,6 +6861,15 @@ namespace csv {
         }
 
         void trim_header();
+
+        /** Index of the record holding the first row after the header */
+        size_t first_row_record() const noexcept { return (size_t)(this->_format.header + 1); }
+
+        /** Offset of a record according to the row index, or the file size past the last one */
+        size_t record_offset(size_t record) const;
+
+        /** Create a parser over the file starting at byte offset start */
+        void make_parser(size_t start);
     };
 }
 
@@ -6434,7 +6882,85 @@ namespace csv {
 #include <vector>
 
 namespace csv {
+    namespace internals {
+        /** Count, mean and sum of squared deviations of a stream of numbers
+         *
+         *  Values are added with Welford's algorithm and partial results are combined
+         *  with Chan et al.'s pairwise formula, so chunks can be processed in parallel.
+         */
+        struct RunningMoments {
+            long double n = 0;
+            long double mean = 0;
+            long double m2 = 0;
+
+            void push(long double x) noexcept;
+            void merge(const RunningMoments& other) noexcept;
+        };
+
+        /** Approximate count of distinct values (HyperLogLog)
+         *
+         *  Uses 2^PRECISION one-byte registers no matter how many values are
+         *  inserted, for a standard error of about 1.04 / sqrt(2^PRECISION).
+         */
+        class HyperLogLog {
+        public:
+            static constexpr int PRECISION = 12;
+
+            void insert(uint64_t hash) noexcept;
+            void merge(const HyperLogLog& other) noexcept;
+            size_t estimate() const noexcept;
+
+        private:
+            std::vector<uint8_t> registers = std::vector<uint8_t>((size_t)1 << PRECISION, 0);
+        };
+
+        /** Most frequent values of a stream in bounded memory (Misra-Gries summary)
+         *
+         *  At most capacity values are tracked. If fewer than capacity distinct values
+         *  were inserted the counts are exact, otherwise each count is an underestimate
+         *  by at most n / (capacity + 1), and every value occurring more often than that
+         *  is present.
+         */
+        class HeavyHitters {
+        public:
+            using FreqCount = std::unordered_map<std::string, size_t>;
+
+            HeavyHitters(size_t capacity = 500) : capacity(capacity) {}
+
+            void insert(csv::string_view value);
+            void merge(const HeavyHitters& other);
+            const FreqCount& counts() const noexcept { return this->_counts; }
+
+        private:
+            /** Subtract the (capacity + 1)th largest count from every count and drop those left at zero */
+            void shrink();
+
+            size_t capacity;
+            FreqCount _counts;
+        };
+
+        /** Mergeable statistics of one column, as computed by a CSVStat worker */
+        struct ColumnStats {
+            RunningMoments moments;
+            long double min = NAN;
+            long double max = NAN;
+            std::unordered_map<DataType, size_t> dtypes;
+            HyperLogLog distinct;
+            HeavyHitters counts;
+
+            void push(csv::string_view value);
+            void merge(const ColumnStats& other);
+        };
+    }
+
     /** Class for calculating statistics from CSV files and in-memory sources
+     *
+     *  @par Implementation
+     *  Statistics are computed in a single pass. Chunks of rows are handed to
+     *  CSVFormat::threads() workers, each keeping its own mergeable statistics
+     *  which are combined at the end. Memory use does not grow with the size or
+     *  cardinality of the data: frequency counts keep only the most frequent
+     *  values and distinct counts are estimated.
      *
      *  **Example**
      *  \include programs/csv_stats.cpp
@@ -6450,6 +6976,7 @@ namespace csv {
         std::vector<long double> get_mins() const;
         std::vector<long double> get_maxes() const;
         std::vector<FreqCount> get_counts() const;
+        std::vector<size_t> get_distinct() const;
         std::vector<TypeCount> get_dtypes() const;
 
         std::vector<std::string> get_col_names() const {
@@ -6459,154 +6986,428 @@ namespace csv {
         CSVStat(csv::string_view filename, CSVFormat format = CSVFormat::guess_csv());
         CSVStat(std::stringstream& source, CSVFormat format = CSVFormat());
     private:
-        // An array of rolling averages
-        // Each index corresponds to the rolling mean for the column at said index
-        std::vector<long double> rolling_means;
-        std::vector<long double> rolling_vars;
-        std::vector<long double> mins;
-        std::vector<long double> maxes;
-        std::vector<FreqCount> counts;
-        std::vector<TypeCount> dtypes;
-        std::vector<long double> n;
-
-        // Statistic calculators
-        void variance(const long double&, const size_t&);
-        void count(CSVField&, const size_t&);
-        void min_max(const long double&, const size_t&);
-        void dtype(CSVField&, const size_t&);
+        // Statistics of each column, indexed by column position
+        std::vector<internals::ColumnStats> stats;
 
         void calc();
-        void calc_chunk();
-        void calc_worker(const size_t&);
+        void calc_chunk(const std::vector<CSVRow>& rows, std::vector<internals::ColumnStats>& out) const;
 
         CSVReader reader;
-        std::deque<CSVRow> records = {};
     };
 }
 
-#include <string>
-#include <type_traits>
-#include <unordered_map>
-
-namespace csv {
-    /** Returned by get_file_info() */
-    struct CSVFileInfo {
-        std::string filename;               /**< Filename */
-        std::vector<std::string> col_names; /**< CSV column names */
-        char delim;                         /**< Delimiting character */
-        size_t n_rows;                      /**< Number of rows in a file */
-        size_t n_cols;                      /**< Number of columns in a CSV */
-    };
-
-    /** @name Shorthand Parsing Functions
-     *  @brief Convienience functions for parsing small strings
-     */
-     ///@{
-    CSVReader operator ""_csv(const char*, size_t);
-    CSVReader operator ""_csv_no_header(const char*, size_t);
-    CSVReader parse(csv::string_view in, CSVFormat format = CSVFormat());
-    CSVReader parse_no_header(csv::string_view in);
-    ///@}
-
-    /** @name Utility Functions */
-    ///@{
-    std::unordered_map<std::string, DataType> csv_data_types(const std::string&);
-    CSVFileInfo get_file_info(const std::string& filename);
-    int get_col_pos(csv::string_view filename, csv::string_view col_name,
-        const CSVFormat& format = CSVFormat::guess_csv());
-    ///@}
-}
 /** @file
-  *  A standalone header file for writing delimiter-separated files
-  */
+ *  Reads CSV files column by column into typed buffers
+ */
 
-#include <fstream>
-#include <iostream>
+#include <memory>
 #include <string>
-#include <tuple>
-#include <type_traits>
 #include <vector>
 
-
 namespace csv {
-    namespace internals {
-        static int DECIMAL_PLACES = 5;
+    /** Type a ColumnReader converts a column to */
+    enum class ColumnType {
+        INT64,  /**< 64-bit signed integers, stored as std::vector<int64_t> */
+        DOUBLE, /**< Floating point numbers, stored as std::vector<double> */
+        STRING  /**< Strings, stored back to back in a csv::StringColumn */
+    };
 
-        /** to_string() for unsigned integers */
-        template<typename T,
-            csv::enable_if_t<std::is_unsigned<T>::value, int> = 0>
-        inline std::string to_string(T value) {
-            std::string digits_reverse = "";
+    /** One column of a ColumnReader schema */
+    struct ColumnSpec {
+        std::string name; /**< Name of the column in the CSV header */
+        ColumnType type;  /**< What to convert the column's values to */
+    };
 
-            if (value == 0) return "0";
+    /** The columns a ColumnReader reads, in the order they appear in each ColumnBatch */
+    using ColumnSchema = std::vector<ColumnSpec>;
 
-            while (value > 0) {
-                digits_reverse += (char)('0' + (value % 10));
-                value /= 10;
-            }
+    /** The strings of a column stored in a single buffer
+     *
+     *  @par Memory Layout
+     *  String i is `chars[offsets[i], offsets[i + 1])`, so a batch of strings
+     *  costs two allocations no matter how many rows it has.
+     */
+    class StringColumn {
+    public:
+        /** Number of strings in this column */
+        size_t size() const noexcept { return this->offsets.size() - 1; }
 
-            return std::string(digits_reverse.rbegin(), digits_reverse.rend());
+        /** Return the ith string. The view is valid until the batch is refilled. */
+        csv::string_view operator[](size_t i) const {
+            return csv::string_view(this->chars.data() + this->offsets[i], this->offsets[i + 1] - this->offsets[i]);
         }
 
-        /** to_string() for signed integers */
-        template<
-            typename T,
-            csv::enable_if_t<std::is_integral<T>::value && std::is_signed<T>::value, int> = 0
-        >
-        inline std::string to_string(T value) {
-            if (value >= 0)
-                return to_string((size_t)value);
+        /** The characters of every string, back to back */
+        const std::string& data() const noexcept { return this->chars; }
 
-            return "-" + to_string((size_t)(value * -1));
+        void push_back(csv::string_view value) {
+            this->chars.append(value.data(), value.size());
+            this->offsets.push_back(this->chars.size());
         }
 
-        /** to_string() for floating point numbers */
-        template<
-            typename T,
-            csv::enable_if_t<std::is_floating_point<T>::value, int> = 0
-        >
-            inline std::string to_string(T value) {
-                std::string result;
+        void clear() {
+            this->chars.clear();
+            this->offsets.resize(1);
+        }
 
-                T integral_part;
-                T fractional_part = std::abs(std::modf(value, &integral_part));
-                integral_part = std::abs(integral_part);
+    private:
+        std::string chars;
+        std::vector<size_t> offsets = { 0 };
+    };
 
-                // Integral part
-                if (value < 0) result = "-";
+    /** A batch of consecutive rows stored column by column, as read by ColumnReader
+     *
+     *  Columns are numbered in schema order. Values which are empty or cannot be
+     *  converted to the column's type are stored as 0 (INT64) or NaN (DOUBLE) and
+     *  flagged in valid().
+     */
+    class ColumnBatch {
+    public:
+        /** Number of rows in this batch */
+        size_t size() const noexcept { return this->n_rows; }
 
-                if (integral_part == 0) {
-                    result = "0";
-                }
-                else {
-                    for (int n_digits = (int)(std::log(integral_part) / std::log(10));
-                         n_digits + 1 > 0; n_digits --) {
-                        int digit = (int)(std::fmod(integral_part, pow10(n_digits + 1)) / pow10(n_digits));
-                        result += (char)('0' + digit);
-                    }
-                }
+        /** Whether or not this batch has no rows */
+        bool empty() const noexcept { return this->n_rows == 0; }
 
-                // Decimal part
-                result += ".";
+        /** Number of columns in this batch */
+        size_t n_cols() const noexcept { return this->columns.size(); }
 
-                if (fractional_part > 0) {
-                    fractional_part *= (T)(pow10(DECIMAL_PLACES));
-                    for (int n_digits = DECIMAL_PLACES; n_digits > 0; n_digits--) {
-                        int digit = (int)(std::fmod(fractional_part, pow10(n_digits)) / pow10(n_digits - 1));
-                        result += (char)('0' + digit);
-                    }
-                }
-                else {
-                    result += "0";
-                }
+        /** Return the position of a column in this batch, or CSV_NOT_FOUND */
+        int index_of(csv::string_view col_name) const;
+
+        /** @name Column Retrieval
+         *  These throw a `std::runtime_error` if the column does not exist or has
+         *  a different type.
+         */
+        ///@{
+        const std::vector<int64_t>& int64s(size_t col) const;
+        const std::vector<int64_t>& int64s(csv::string_view col_name) const;
+        const std::vector<double>& doubles(size_t col) const;
+        const std::vector<double>& doubles(csv::string_view col_name) const;
+        const StringColumn& strings(size_t col) const;
+        const StringColumn& strings(csv::string_view col_name) const;
+
+        /** Whether each value of the column held a value of the column's type (1) or not (0) */
+        const std::vector<uint8_t>& valid(size_t col) const;
+        ///@}
+
+    private:
+        friend class ColumnReader;
+
+        struct Column {
+            std::string name;
+            ColumnType type;
+            std::vector<int64_t> int64s;
+            std::vector<double> doubles;
+            StringColumn strings;
+            std::vector<uint8_t> valid;
+
+            void push(csv::string_view value);
+            void push_null();
+        };
+
+        /** Empty every column, keeping allocated memory, and reserve space for rows */
+        void reset(const ColumnSchema& schema, size_t rows);
+
+        const Column& column(size_t col, ColumnType type) const;
+
+        std::vector<Column> columns;
+        size_t n_rows = 0;
+    };
+
+    /** @class ColumnReader
+     *  @brief Reads the columns of a schema into typed, contiguous buffers, one batch of rows at a time
+     *
+     *  Fields go straight from the parsed data into the column vectors, converted
+     *  according to the schema, instead of through CSVField and type guessing.
+     *  Columns which are not in the schema are never converted.
+     *
+     *  **Example**
+     *  @code
+     *  csv::ColumnReader reader("flight.csv", {
+     *      { "time_us", csv::ColumnType::INT64 },
+     *      { "altitude", csv::ColumnType::DOUBLE }
+     *  });
+     *
+     *  for (auto& batch : reader) {
+     *      auto& altitude = batch.doubles(1);
+     *      ...
+     *  }
+     *  @endcode
+     */
+    class ColumnReader {
+    public:
+        /** Default number of rows in a batch */
+        static constexpr size_t DEFAULT_BATCH_ROWS = 65536;
+
+        /** An input iterator over the batches of a ColumnReader.
+         *  All copies of an iterator share the batch they point to.
+         */
+        class iterator {
+        public:
+            #ifndef DOXYGEN_SHOULD_SKIP_THIS
+            using value_type = ColumnBatch;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const ColumnBatch*;
+            using reference = const ColumnBatch&;
+            using iterator_category = std::input_iterator_tag;
+            #endif
+
+            iterator() = default;
+            iterator(ColumnReader* reader, size_t batch_rows);
+
+            reference operator*() const { return *this->batch; }
+            pointer operator->() const { return this->batch.get(); }
+
+            iterator& operator++();
 
-                return result;
+            /** Returns true if both iterators are past the end or come from the same ColumnReader */
+            CONSTEXPR bool operator==(const iterator& other) const noexcept {
+                return this->daddy == other.daddy;
+            }
+
+            CONSTEXPR bool operator!=(const iterator& other) const noexcept { return !operator==(other); }
+        private:
+            ColumnReader* daddy = nullptr;  // Pointer to parent, or nullptr past the end
+            std::shared_ptr<ColumnBatch> batch = nullptr;
+            size_t batch_rows = DEFAULT_BATCH_ROWS;
+        };
+
+        /** @name Constructors
+         *  @throws std::runtime_error if a column of the schema is not in the CSV
+         */
+        ///@{
+        ColumnReader(csv::string_view filename, ColumnSchema schema, CSVFormat format = CSVFormat::guess_csv()) :
+            reader(filename, format), schema(std::move(schema)) {
+            this->resolve_columns();
+        }
+
+        template<typename TStream,
+            csv::enable_if_t<std::is_base_of<std::istream, TStream>::value, int> = 0>
+        ColumnReader(TStream& source, ColumnSchema schema, CSVFormat format = CSVFormat()) :
+            reader(source, format), schema(std::move(schema)) {
+            this->resolve_columns();
+        }
+        ///@}
+
+        /** @name Retrieving Batches */
+        ///@{
+        bool read_batch(ColumnBatch& batch, size_t max_rows = DEFAULT_BATCH_ROWS);
+        iterator begin(size_t batch_rows = DEFAULT_BATCH_ROWS);
+        HEDLEY_CONST iterator end() const noexcept { return iterator(); }
+        ///@}
+
+        /** The schema this reader was constructed with */
+        const ColumnSchema& get_schema() const noexcept { return this->schema; }
+
+        /** Column names of the underlying CSV */
+        std::vector<std::string> get_col_names() const { return this->reader.get_col_names(); }
+
+        /** Retrieves the number of rows that have been read so far */
+        size_t n_rows() const noexcept { return this->reader.n_rows(); }
+
+    private:
+        /** Find the position of each schema column in the CSV */
+        void resolve_columns();
+
+        CSVReader reader;
+        ColumnSchema schema;
+
+        /** Position of each schema column in a CSV row */
+        std::vector<size_t> positions;
+    };
+}
+
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+
+namespace csv {
+    /** Returned by get_file_info() */
+    struct CSVFileInfo {
+        std::string filename;               /**< Filename */
+        std::vector<std::string> col_names; /**< CSV column names */
+        char delim;                         /**< Delimiting character */
+        size_t n_rows;                      /**< Number of rows in a file */
+        size_t n_cols;                      /**< Number of columns in a CSV */
+    };
+
+    /** @name Shorthand Parsing Functions
+     *  @brief Convienience functions for parsing small strings
+     */
+     ///@{
+    CSVReader operator ""_csv(const char*, size_t);
+    CSVReader operator ""_csv_no_header(const char*, size_t);
+    CSVReader parse(csv::string_view in, CSVFormat format = CSVFormat());
+    CSVReader parse_no_header(csv::string_view in);
+    ///@}
+
+    /** @name Utility Functions */
+    ///@{
+    std::unordered_map<std::string, DataType> csv_data_types(const std::string&);
+    CSVFileInfo get_file_info(const std::string& filename);
+    int get_col_pos(csv::string_view filename, csv::string_view col_name,
+        const CSVFormat& format = CSVFormat::guess_csv());
+    ///@}
+}
+/** @file
+  *  A standalone header file for writing delimiter-separated files
+  */
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+
+#if defined(CSV_HAS_CXX17) && defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+#endif
+
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+#define CSV_HAS_TO_CHARS
+#endif
+
+namespace csv {
+    namespace internals {
+        /** Number of decimal places written for floating point numbers. If negative,
+         *  the shortest representation which reads back as the same value is written.
+         */
+        static int DECIMAL_PLACES = -1;
+
+        /** Write the decimal digits of value so that they end just before end
+         *
+         *  @returns Pointer to the first digit
+         */
+        inline char* format_digits(uint64_t value, char* end) noexcept {
+            static const char pairs[] =
+                "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+                "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+                "8081828384858687888990919293949596979899";
+
+            while (value >= 100) {
+                const size_t i = (size_t)(value % 100) * 2;
+                value /= 100;
+                *--end = pairs[i + 1];
+                *--end = pairs[i];
+            }
+
+            if (value >= 10) {
+                const size_t i = (size_t)value * 2;
+                *--end = pairs[i + 1];
+                *--end = pairs[i];
+            }
+            else {
+                *--end = (char)('0' + value);
+            }
+
+            return end;
+        }
+
+        /** Append an unsigned integer to out */
+        template<typename T,
+            csv::enable_if_t<std::is_unsigned<T>::value, int> = 0>
+        inline void append_number(std::string& out, T value) {
+            char buffer[24];
+            char* end = buffer + sizeof(buffer);
+            out.append(format_digits((uint64_t)value, end), end);
+        }
+
+        /** Append a signed integer to out */
+        template<
+            typename T,
+            csv::enable_if_t<std::is_integral<T>::value && std::is_signed<T>::value, int> = 0
+        >
+        inline void append_number(std::string& out, T value) {
+            char buffer[24];
+            char* end = buffer + sizeof(buffer);
+
+            // Negate as unsigned so that the minimum value does not overflow
+            char* begin = format_digits(value < 0 ? 0 - (uint64_t)value : (uint64_t)value, end);
+            if (value < 0) *--begin = '-';
+            out.append(begin, end);
+        }
+
+#ifndef CSV_HAS_TO_CHARS
+        inline float read_back(const char* str, float) { return strtof(str, nullptr); }
+        inline double read_back(const char* str, double) { return strtod(str, nullptr); }
+        inline long double read_back(const char* str, long double) { return strtold(str, nullptr); }
+
+        /** Shortest %g representation of value which reads back as the same value */
+        template<typename T>
+        inline int format_shortest(char* buffer, size_t size, T value) {
+            int length = 0;
+            for (int precision = std::numeric_limits<T>::digits10;
+                precision <= std::numeric_limits<T>::max_digits10; precision++) {
+                length = std::is_same<T, long double>::value
+                    ? snprintf(buffer, size, "%.*Lg", precision, (long double)value)
+                    : snprintf(buffer, size, "%.*g", precision, (double)value);
+                if (read_back(buffer, value) == value || value != value) break;
+            }
+
+            return length;
+        }
+#endif
+
+        /** Append a floating point number to out
+         *
+         *  @par Format
+         *  By default this is the shortest representation which reads back as the
+         *  same value (like std::to_chars), with ".0" added to integral values so
+         *  they are still read as floating point. After set_decimal_places(), values
+         *  are written in fixed notation with that many decimal places.
+         */
+        template<
+            typename T,
+            csv::enable_if_t<std::is_floating_point<T>::value, int> = 0
+        >
+        inline void append_number(std::string& out, T value) {
+            // Enough for any double in fixed notation with up to 100 decimal places
+            char buffer[512];
+            const int precision = std::min(DECIMAL_PLACES, 100);
+            size_t length = 0;
+
+#ifdef CSV_HAS_TO_CHARS
+            auto result = precision < 0
+                ? std::to_chars(buffer, buffer + sizeof(buffer), value)
+                : std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::fixed, precision);
+            length = result.ec == std::errc() ? (size_t)(result.ptr - buffer) : 0;
+#else
+            const int written = precision < 0
+                ? format_shortest(buffer, sizeof(buffer), value)
+                : std::is_same<T, long double>::value
+                    ? snprintf(buffer, sizeof(buffer), "%.*Lf", precision, (long double)value)
+                    : snprintf(buffer, sizeof(buffer), "%.*f", precision, (double)value);
+            length = written > 0 ? std::min((size_t)written, sizeof(buffer) - 1) : 0;
+#endif
+
+            out.append(buffer, length);
+            if (precision < 0 && std::isfinite(value)
+                && std::find_if(buffer, buffer + length, [](char ch) { return ch == '.' || ch == 'e'; }) == buffer + length)
+                out.append(".0");
+        }
+
+        /** to_string() for integers and floating point numbers
+         *
+         *  @see append_number()
+         */
+        template<typename T,
+            csv::enable_if_t<std::is_arithmetic<T>::value, int> = 0>
+        inline std::string to_string(T value) {
+            std::string result;
+            append_number(result, value);
+            return result;
         }
     }
 
     /** Sets how many places after the decimal will be written for floating point numbers
      *
-     *  @param  precision   Number of decimal places
+     *  @param  precision   Number of decimal places, or a negative number to write the
+     *                      shortest representation which reads back as the same value (default)
      */
     inline static void set_decimal_places(int precision) {
         internals::DECIMAL_PLACES = precision;
@@ -6649,7 +7450,9 @@ namespace csv {
         */
 
         DelimWriter(OutputStream& _out, bool _quote_minimal = true)
-            : out(_out), quote_minimal(_quote_minimal) {};
+            : out(_out), quote_minimal(_quote_minimal) {
+            this->buffer.reserve(BUFFER_SIZE + 1024);
+        };
 
         /** Construct a DelimWriter over the file
          *
@@ -6661,7 +7464,7 @@ namespace csv {
          *
          */
         ~DelimWriter() {
-            out.flush();
+            this->flush();
         }
 
         /** Format a sequence of strings and write to CSV according to RFC 4180
@@ -6675,8 +7478,8 @@ namespace csv {
         template<typename T, size_t Size>
         DelimWriter& operator<<(const std::array<T, Size>& record) {
             for (size_t i = 0; i < Size; i++) {
-                out << csv_escape(record[i]);
-                if (i + 1 != Size) out << Delim;
+                write_field(record[i]);
+                if (i + 1 != Size) buffer += Delim;
             }
 
             end_out();
@@ -6705,8 +7508,8 @@ namespace csv {
             const size_t ilen = record.size();
             size_t i = 0;
             for (const auto& field : record) {
-                out << csv_escape(field);
-                if (i + 1 != ilen) out << Delim;
+                write_field(field);
+                if (i + 1 != ilen) buffer += Delim;
                 i++;
             }
 
@@ -6718,10 +7521,16 @@ namespace csv {
          *
          */
         void flush() {
+            write_buffer();
             out.flush();
         }
 
     private:
+        /** Rows are formatted into a buffer which is written to the stream
+         *  once it grows past this many bytes
+         */
+        static constexpr size_t BUFFER_SIZE = 1 << 16;
+
         template<
             typename T,
             csv::enable_if_t<
@@ -6729,8 +7538,8 @@ namespace csv {
                 && !std::is_convertible<T, csv::string_view>::value
             , int> = 0
         >
-        std::string csv_escape(T in) {
-            return internals::to_string(in);
+        void write_field(T in) {
+            internals::append_number(buffer, in);
         }
 
         template<
@@ -6740,59 +7549,62 @@ namespace csv {
                 || std::is_convertible<T, csv::string_view>::value
             , int> = 0
         >
-        std::string csv_escape(T in) {
+        void write_field(const T& in) {
             IF_CONSTEXPR(std::is_convertible<T, csv::string_view>::value) {
-                return _csv_escape(in);
+                _csv_escape(in);
+                return;
             }
-            
-            return _csv_escape(std::string(in));
+
+            _csv_escape(std::string(in));
         }
 
-        std::string _csv_escape(csv::string_view in) {
-            /** Format a string to be RFC 4180-compliant
+        void _csv_escape(csv::string_view in) {
+            /** Append a string formatted to be RFC 4180-compliant
              *  @param[in]  in              String to be CSV-formatted
              *  @param[out] quote_minimal   Only quote fields if necessary.
              *                              If False, everything is quoted.
              */
 
-            // Do we need a quote escape
-            bool quote_escape = false;
-
-            for (auto ch : in) {
-                if (ch == Quote || ch == Delim || ch == '\r' || ch == '\n') {
-                    quote_escape = true;
+            // Find the first character which needs a quote escape, if any
+            size_t i = 0;
+            for (; i < in.size(); i++) {
+                const char ch = in[i];
+                if (ch == Quote || ch == Delim || ch == '\r' || ch == '\n')
                     break;
-                }
             }
 
-            if (!quote_escape) {
-                if (quote_minimal) return std::string(in);
+            if (i == in.size()) {
+                if (quote_minimal) buffer.append(in.data(), in.size());
                 else {
-                    std::string ret(1, Quote);
-                    ret += in.data();
-                    ret += Quote;
-                    return ret;
+                    buffer += Quote;
+                    buffer.append(in.data(), in.size());
+                    buffer += Quote;
                 }
+
+                return;
             }
 
-            // Start initial quote escape sequence
-            std::string ret(1, Quote);
-            for (auto ch: in) {
-                if (ch == Quote) ret += std::string(2, Quote);
-                else ret += ch;
+            // Copy the text between quotes, doubling each quote. Nothing before i is a quote.
+            buffer += Quote;
+            size_t copied = 0;
+            for (; i < in.size(); i++) {
+                if (in[i] == Quote) {
+                    buffer.append(in.data() + copied, i + 1 - copied);
+                    buffer += Quote;
+                    copied = i + 1;
+                }
             }
 
-            // Finish off quote escape
-            ret += Quote;
-            return ret;
+            buffer.append(in.data() + copied, in.size() - copied);
+            buffer += Quote;
         }
 
         /** Recurisve template for writing std::tuples */
         template<size_t Index = 0, typename... T>
         typename std::enable_if<Index < sizeof...(T), void>::type write_tuple(const std::tuple<T...>& record) {
-            out << csv_escape(std::get<Index>(record));
+            write_field(std::get<Index>(record));
 
-            IF_CONSTEXPR (Index + 1 < sizeof...(T)) out << Delim;
+            IF_CONSTEXPR (Index + 1 < sizeof...(T)) buffer += Delim;
 
             this->write_tuple<Index + 1>(record);
         }
@@ -6804,14 +7616,23 @@ namespace csv {
             end_out();
         }
 
-        /** Ends a line in 'out' and flushes, if Flush is true.*/
+        /** Ends a line and writes out the buffer if it is full, or flushes if Flush is true. */
         void end_out() {
-            out << '\n';
-            IF_CONSTEXPR(Flush) out.flush();
+            buffer += '\n';
+            IF_CONSTEXPR(Flush) this->flush();
+            else if (buffer.size() >= BUFFER_SIZE) write_buffer();
+        }
+
+        /** Write the buffered rows to the stream */
+        void write_buffer() {
+            if (buffer.empty()) return;
+            out.write(buffer.data(), (std::streamsize)buffer.size());
+            buffer.clear();
         }
 
         OutputStream & out;
         bool quote_minimal;
+        std::string buffer;
     };
 
     /** An alias for csv::DelimWriter for writing standard CSV files
@@ -6940,10 +7761,9 @@ namespace csv {
                 field_start = (int)(data_pos - current_row_start());
 
             // Optimization: Since NOT_SPECIAL characters tend to occur in contiguous
-            // sequences, use the loop below to avoid having to go through the outer
-            // switch statement as much as possible
-            while (data_pos < in.size() && compound_parse_flag(in[data_pos]) == ParseFlags::NOT_SPECIAL)
-                data_pos++;
+            // sequences, jump straight to the next structural character instead of
+            // going through the outer switch statement for each of them
+            data_pos = this->next_structural(data_pos);
 
             field_length = data_pos - (field_start + current_row_start());
 
@@ -6953,6 +7773,28 @@ namespace csv {
                 this->field_length--;
         }
 
+        CSV_INLINE size_t IBasicCSVParser::next_structural(size_t pos) const noexcept {
+            const size_t size = this->data_ptr->data.size();
+            const size_t words = this->_masks.quote.size();
+            const uint64_t* delim = this->_masks.delim.data();
+            const uint64_t* quote = this->_masks.quote.data();
+            const uint64_t* newline = this->_masks.newline.data();
+
+            // Inside quotes, only another quote is special
+            const uint64_t others = this->quote_escape ? 0 : ~(uint64_t)0;
+
+            size_t w = pos / 64;
+            if (w >= words) return size;
+
+            uint64_t bits = (quote[w] | ((delim[w] | newline[w]) & others)) & (~(uint64_t)0 << (pos % 64));
+            while (!bits) {
+                if (++w == words) return size;
+                bits = quote[w] | ((delim[w] | newline[w]) & others);
+            }
+
+            return std::min(w * 64 + ctz64(bits), size);
+        }
+
         CSV_INLINE void IBasicCSVParser::push_field()
         {
             // Update
@@ -6990,6 +7832,8 @@ namespace csv {
             this->trim_utf8_bom();
 
             auto& in = this->data_ptr->data;
+            scan_structural(structural_chars(this->_parse_flags), in, this->_masks);
+
             while (this->data_pos < in.size()) {
                 switch (compound_parse_flag(in[this->data_pos])) {
                 case ParseFlags::DELIMITER:
@@ -7097,8 +7941,14 @@ namespace csv {
             this->field_length = 0;
             this->reset_data_ptr();
 
-            // Create memory map
+            // Nothing left, e.g. after seeking past the last row
             size_t length = std::min(this->source_size - this->mmap_pos, bytes);
+            if (length == 0) {
+                this->_eof = true;
+                return;
+            }
+
+            // Create memory map
             std::error_code error;
             this->data_ptr->_data = std::make_shared<mio::basic_mmap_source<char>>(mio::make_mmap_source(this->_filename, this->mmap_pos, length, error));
             this->mmap_pos += length;
@@ -7120,6 +7970,293 @@ namespace csv {
 
             this->mmap_pos -= (length - remainder);
         }
+
+        CSV_INLINE size_t RangeParser::parse_range(const std::shared_ptr<void>& source, csv::string_view data, bool last) {
+            this->field_start = UNINITIALIZED_FIELD;
+            this->field_length = 0;
+            this->reset_data_ptr();
+            this->data_ptr->_data = source;
+            this->data_ptr->data = data;
+
+            this->current_row = CSVRow(this->data_ptr);
+            size_t remainder = this->parse();
+
+            if (last) {
+                this->_eof = true;
+                this->end_feed();
+            }
+
+            return remainder;
+        }
+
+        CSV_INLINE std::vector<size_t> count_block_quotes(csv::string_view data, size_t block_size, size_t n_threads,
+            const StructuralChars& chars, bool* stray_quotes) {
+            const ScanLevel level = best_scan_level();
+            const size_t n_blocks = (data.size() + block_size - 1) / block_size;
+
+            auto is_boundary = [&](char c) {
+                return c == chars.delim || c == chars.quote || c == '\r' || c == '\n';
+            };
+
+            std::vector<size_t> quotes(n_blocks, 0);
+            std::atomic<size_t> next_block(0);
+            std::atomic<bool> stray(false);
+            auto count_quotes = [&]() {
+                const size_t step = 4096;
+                uint64_t delim[step / 64], quote[step / 64], newline[step / 64];
+                for (size_t i = next_block++; i < n_blocks; i = next_block++) {
+                    const size_t end = std::min(data.size(), (i + 1) * block_size);
+                    size_t count = 0;
+                    for (size_t j = i * block_size; j < end; j += step) {
+                        const size_t len = std::min(end - j, step);
+                        const size_t words = (len + 63) / 64;
+                        scan_structural(level, chars, data.data() + j, len, delim, quote, newline);
+                        for (size_t k = 0; k < words; k++)
+                            count += popcount64(quote[k]);
+
+                        if (!stray_quotes || !chars.quoting) continue;
+
+                        // A quote with ordinary characters on both sides is inside an unquoted
+                        // field, where the parser keeps it as a literal character
+                        uint64_t prev_carry = j == 0 || is_boundary(data[j - 1]);
+                        for (size_t k = 0; k < words; k++) {
+                            const uint64_t boundary = delim[k] | quote[k] | newline[k];
+                            uint64_t next_boundary = boundary >> 1;
+                            if (k + 1 < words)
+                                next_boundary |= (delim[k + 1] | quote[k + 1] | newline[k + 1]) << 63;
+                            else
+                                next_boundary |= (uint64_t)(j + len == data.size() || is_boundary(data[j + len]))
+                                    << ((len - 1) % 64);
+
+                            if (quote[k] & ~((boundary << 1) | prev_carry) & ~next_boundary)
+                                stray = true;
+
+                            prev_carry = boundary >> 63;
+                        }
+                    }
+
+                    quotes[i] = count;
+                }
+            };
+
+            std::vector<std::thread> threads;
+            for (size_t i = 1; i < std::min(n_threads, n_blocks); i++)
+                threads.emplace_back(count_quotes);
+
+            count_quotes();
+            for (auto& thread : threads)
+                thread.join();
+
+            if (stray_quotes) *stray_quotes = stray;
+            return quotes;
+        }
+
+        CSV_INLINE std::vector<uint64_t> find_record_starts(csv::string_view data, size_t n_threads,
+            const ParseFlagMap& parse_flags) {
+            if (data.empty()) return {};
+
+            const StructuralChars chars = structural_chars(parse_flags);
+            const ScanLevel level = best_scan_level();
+
+            // Several blocks per thread so that uneven blocks even out, but at least 1MB each
+            const size_t block_size = std::max((data.size() / (n_threads * 8) + 63) / 64 * 64, (size_t)1 << 20);
+            const size_t n_blocks = (data.size() + block_size - 1) / block_size;
+            const std::vector<size_t> quotes = count_block_quotes(data, block_size, n_threads, chars);
+
+            // Collect the newlines outside of quotes in each block
+            std::vector<std::vector<uint64_t>> newlines(n_blocks);
+            std::atomic<size_t> next_block(0);
+            auto find_newlines = [&]() {
+                const size_t step = 4096;
+                uint64_t delim[step / 64], quote[step / 64], newline[step / 64];
+                for (size_t i = next_block++; i < n_blocks; i = next_block++) {
+                    bool in_quote = false;
+                    for (size_t j = 0; j < i; j++)
+                        in_quote ^= (quotes[j] & 1) != 0;
+
+                    const size_t end = std::min(data.size(), (i + 1) * block_size);
+                    for (size_t j = i * block_size; j < end; j += step) {
+                        const size_t len = std::min(end - j, step);
+                        scan_structural(level, chars, data.data() + j, len, delim, quote, newline);
+                        for (size_t k = 0; k < (len + 63) / 64; k++) {
+                            const uint64_t inside = prefix_xor(quote[k]) ^ (in_quote ? ~(uint64_t)0 : 0);
+                            for (uint64_t bits = newline[k] & ~inside; bits; bits &= bits - 1)
+                                newlines[i].push_back(j + k * 64 + ctz64(bits));
+
+                            in_quote = (inside >> 63) != 0;
+                        }
+                    }
+                }
+            };
+
+            std::vector<std::thread> threads;
+            for (size_t i = 1; i < std::min(n_threads, n_blocks); i++)
+                threads.emplace_back(find_newlines);
+
+            find_newlines();
+            for (auto& thread : threads)
+                thread.join();
+
+            // Mirror IBasicCSVParser::parse(): a newline ends the record, and one directly
+            // after it belongs to the same line break
+            std::vector<uint64_t> starts = { 0 };
+            uint64_t consumed = (uint64_t)-1;
+            for (auto& block : newlines) {
+                for (uint64_t pos : block) {
+                    if (pos == consumed) continue;
+
+                    uint64_t start = pos + 1;
+                    if (start < data.size() && parse_flags[data[start] + 128] == ParseFlags::NEWLINE) {
+                        consumed = start;
+                        start++;
+                    }
+
+                    if (start < data.size()) starts.push_back(start);
+                }
+
+                std::vector<uint64_t>().swap(block);
+            }
+
+            return starts;
+        }
+
+        CSV_INLINE std::vector<size_t> split_rows(csv::string_view data, size_t n_ranges, size_t n_threads,
+            const ParseFlagMap& parse_flags) {
+            const StructuralChars chars = structural_chars(parse_flags);
+            const ScanLevel level = best_scan_level();
+
+            // Blocks are whole mask words so that the quote parity at each block start is known
+            const size_t block_size = std::max((data.size() / std::max(n_ranges, (size_t)1) + 63) / 64 * 64, (size_t)64);
+            const size_t n_blocks = (data.size() + block_size - 1) / block_size;
+
+            bool stray_quotes = false;
+            const std::vector<size_t> quotes = count_block_quotes(data, block_size, n_threads, chars, &stray_quotes);
+            if (stray_quotes)
+                return { 0, data.size() };
+
+            // Move each block start to the beginning of the next row
+            std::vector<size_t> starts = { 0 };
+            bool quote_escape = false;
+            for (size_t i = 1; i < n_blocks; i++) {
+                quote_escape ^= (quotes[i - 1] & 1) != 0;
+
+                // If the previous boundary ran past this block's start, it is a row start outside quotes
+                size_t pos = i * block_size;
+                bool in_quote = quote_escape;
+                if (starts.back() > pos) {
+                    pos = starts.back();
+                    in_quote = false;
+                }
+
+                size_t w = pos / 64;
+                uint64_t from = ~(uint64_t)0 << (pos % 64);
+                uint64_t newline_carry = w > 0 && parse_flags[data[w * 64 - 1] + 128] == ParseFlags::NEWLINE;
+                pos = data.size();
+                for (; w * 64 < data.size(); w++) {
+                    uint64_t delim, quote, newline;
+                    scan_structural(level, chars, data.data() + w * 64, std::min(data.size() - w * 64, (size_t)64),
+                        &delim, &quote, &newline);
+
+                    const uint64_t inside = prefix_xor(quote & from) ^ (in_quote ? ~(uint64_t)0 : 0);
+
+                    // A newline right after another one is the second half of a CRLF
+                    // (or LFLF), which the parser consumes as part of the first
+                    const uint64_t after_newline = (newline << 1) | newline_carry;
+                    const uint64_t row_ends = newline & ~inside & ~after_newline & from;
+                    if (row_ends) {
+                        pos = w * 64 + ctz64(row_ends);
+                        break;
+                    }
+
+                    in_quote = (inside >> 63) != 0;
+                    newline_carry = newline >> 63;
+                    from = ~(uint64_t)0;
+                }
+
+                if (pos < data.size()) {
+                    pos++;
+                    if (pos < data.size() && parse_flags[data[pos] + 128] == ParseFlags::NEWLINE)
+                        pos++;
+                }
+
+                starts.push_back(pos);
+            }
+
+            starts.push_back(data.size());
+            return starts;
+        }
+
+        CSV_INLINE void ParallelMmapParser::next(size_t bytes = ITERATION_CHUNK_SIZE) {
+            const size_t length = std::min(this->source_size - this->mmap_pos, bytes * this->workers.size());
+            if (length == 0) {
+                this->_eof = true;
+                return;
+            }
+
+            // Create memory map
+            std::error_code error;
+            auto mmap = std::make_shared<mio::basic_mmap_source<char>>(
+                mio::make_mmap_source(this->_filename, this->mmap_pos, length, error));
+            if (error) throw error;
+
+            csv::string_view data(mmap->data(), mmap->length());
+            size_t offset = 0;
+            if (!this->unicode_bom_scan && data.size() >= 3) {
+                if (data[0] == '\xEF' && data[1] == '\xBB' && data[2] == '\xBF') {
+                    offset = 3;
+                    this->_utf8_bom = true;
+                }
+
+                this->unicode_bom_scan = true;
+            }
+
+            const bool last_chunk = this->mmap_pos + length == this->source_size;
+            auto starts = split_rows(data.substr(offset), this->workers.size() * BLOCKS_PER_THREAD,
+                this->workers.size(), this->_parse_flags);
+            const size_t n_blocks = starts.size() - 1;
+
+            // Only the final non-empty block may end in the middle of a row
+            size_t last_block = n_blocks - 1;
+            while (last_block > 0 && starts[last_block] == starts[last_block + 1])
+                last_block--;
+
+            // Parse blocks, each into its own row buffer
+            std::vector<RowCollection> rows(n_blocks);
+            size_t remainder = 0;
+            std::atomic<size_t> next_block(0);
+            auto parse_blocks = [&](RangeParser* parser) {
+                for (size_t i = next_block++; i < n_blocks; i = next_block++) {
+                    const bool last = i == last_block;
+                    parser->set_output(rows[i]);
+                    size_t read = parser->parse_range(mmap,
+                        data.substr(offset + starts[i], starts[i + 1] - starts[i]), last && last_chunk);
+
+                    if (last) remainder = offset + starts[i] + read;
+                }
+            };
+
+            std::vector<std::thread> threads;
+            for (size_t i = 1; i < std::min(this->workers.size(), n_blocks); i++)
+                threads.emplace_back(parse_blocks, this->workers[i].get());
+
+            parse_blocks(this->workers[0].get());
+            for (auto& thread : threads)
+                thread.join();
+
+            // Merge in file order
+            for (auto& block : rows) {
+                for (auto& row : block)
+                    this->_records->push_back(std::move(row));
+            }
+
+            if (last_chunk) {
+                this->_eof = true;
+                this->mmap_pos = this->source_size;
+            }
+            else {
+                this->mmap_pos += remainder;
+            }
+        }
 #ifdef _MSC_VER
 #pragma endregion
 #endif
@@ -7400,7 +8537,6 @@ namespace csv {
      */
 	CSV_INLINE CSVReader::CSVReader(csv::string_view filename, CSVFormat format) : _format(format) {
         auto head = internals::get_csv_head(filename);
-        using Parser = internals::MmapParser;
 
         /** Guess delimiter and header row */
         if (format.guess_delim()) {
@@ -7413,8 +8549,25 @@ namespace csv {
         if (!format.col_names.empty())
             this->set_col_names(format.col_names);
 
-        this->parser = std::unique_ptr<Parser>(new Parser(filename, format, this->col_names)); // For C++11
+        this->filename = std::string(filename);
+        this->make_parser(0);
         this->initial_read();
+
+        if (format.use_row_index)
+            this->row_index = std::make_shared<CSVIndex>(CSVIndex::open(filename, this->_format));
+    }
+
+    CSV_INLINE void CSVReader::make_parser(size_t start) {
+        using Parser = internals::MmapParser;
+
+        if (this->_format.get_threads() > 1) {
+            this->parser = std::unique_ptr<internals::ParallelMmapParser>(
+                new internals::ParallelMmapParser(this->filename, this->_format, this->col_names, start));
+        }
+        else {
+            this->parser = std::unique_ptr<Parser>(
+                new Parser(this->filename, this->_format, this->col_names, start)); // For C++11
+        }
     }
 
     /** Return the format of the original raw CSV */
@@ -7537,21 +8690,196 @@ namespace csv {
                 this->_format.variable_column_policy != VariableColumnPolicy::KEEP) {
                 auto errored_row = this->records->pop_front();
 
-                if (this->_format.variable_column_policy == VariableColumnPolicy::THROW) {
-                    if (errored_row.size() < this->n_cols)
-                        throw std::runtime_error("Line too short " + internals::format_row(errored_row));
+                if (this->_format.variable_column_policy == VariableColumnPolicy::THROW) {
+                    if (errored_row.size() < this->n_cols)
+                        throw std::runtime_error("Line too short " + internals::format_row(errored_row));
+
+                    throw std::runtime_error("Line too long " + internals::format_row(errored_row));
+                }
+            }
+            else {
+                row = this->records->pop_front();
+                this->_n_rows++;
+                return true;
+            }
+        }
+
+        return false;
+    }
+}
+
+/** @file
+ *  Implements random access to CSV files through a row index
+ */
+
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+
+namespace csv {
+    namespace internals {
+        /** Modification time of a file in nanoseconds, or 0 if unknown */
+        inline int64_t get_file_mtime(csv::string_view filename) {
+#if defined(_WIN32)
+            struct _stat64 st;
+            if (_stat64(std::string(filename).c_str(), &st) != 0) return 0;
+            return (int64_t)st.st_mtime * 1000000000;
+#else
+            struct stat st;
+            if (stat(std::string(filename).c_str(), &st) != 0) return 0;
+#if defined(__APPLE__)
+            return (int64_t)st.st_mtimespec.tv_sec * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+            return (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+#endif
+        }
+    }
+
+    CSV_INLINE CSVIndex::Header CSVIndex::make_header(csv::string_view filename, const CSVFormat& format) {
+        Header header = {};
+        std::memcpy(header.magic, "CSVIDX1", 8);
+        header.file_size = internals::get_file_size(filename);
+        header.file_mtime = internals::get_file_mtime(filename);
+        header.delim = format.get_delim();
+        header.quote = format.get_quote_char();
+        header.quoting = format.is_quoting_enabled();
+        return header;
+    }
+
+    CSV_INLINE CSVIndex CSVIndex::build(csv::string_view filename, const CSVFormat& format) {
+        CSVIndex index;
+        index.filename = std::string(filename);
+        index.header = make_header(filename, format);
+
+        if (index.header.file_size > 0) {
+            std::error_code error;
+            auto mmap = mio::make_mmap_source(index.filename, 0, mio::map_entire_file, error);
+            if (error) throw error;
+
+            const auto parse_flags = format.is_quoting_enabled()
+                ? internals::make_parse_flags(format.get_delim(), format.get_quote_char())
+                : internals::make_parse_flags(format.get_delim());
+
+            index.starts = internals::find_record_starts(csv::string_view(mmap.data(), mmap.size()),
+                format.get_threads(), parse_flags);
+        }
+
+        index.header.n_records = index.starts.size();
+        return index;
+    }
+
+    CSV_INLINE CSVIndex CSVIndex::open(csv::string_view filename, const CSVFormat& format) {
+        CSVIndex index;
+        if (index.load(filename, format)) return index;
+
+        index = build(filename, format);
+        index.save(); // Still usable if the directory is read-only
+        return index;
+    }
+
+    CSV_INLINE bool CSVIndex::load(csv::string_view filename, const CSVFormat& format) {
+        const Header expected = make_header(filename, format);
+        std::ifstream in(sidecar_path(filename), std::ios::binary);
+        Header header;
+        if (!in.read((char*)&header, sizeof(header))) return false;
+
+        if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0
+            || header.file_size != expected.file_size
+            || header.file_mtime != expected.file_mtime
+            || header.delim != expected.delim
+            || header.quote != expected.quote
+            || header.quoting != expected.quoting)
+            return false;
+
+        std::vector<uint64_t> offsets((size_t)header.n_records);
+        if (!in.read((char*)offsets.data(), (std::streamsize)(offsets.size() * sizeof(uint64_t))))
+            return false;
+
+        this->filename = std::string(filename);
+        this->header = header;
+        this->starts = std::move(offsets);
+        return true;
+    }
+
+    CSV_INLINE bool CSVIndex::save() const {
+        const std::string path = sidecar_path(this->filename);
+        const std::string temp = path + ".tmp";
+        {
+            std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+            out.write((const char*)&this->header, sizeof(this->header));
+            out.write((const char*)this->starts.data(), (std::streamsize)(this->starts.size() * sizeof(uint64_t)));
+            if (!out.flush()) {
+                std::remove(temp.c_str());
+                return false;
+            }
+        }
+
+        // Readers never see a partially written index
+        return std::rename(temp.c_str(), path.c_str()) == 0;
+    }
+
+    /** Number of records in the file after the header, according to the row index
+     *
+     *  @note Unlike n_rows() after a full read, this includes blank rows and rows
+     *        which the VariableColumnPolicy drops
+     */
+    CSV_INLINE size_t CSVReader::record_count() const {
+        if (!this->row_index)
+            throw std::runtime_error("record_count() needs a row index, see CSVFormat::row_index()");
+
+        const size_t first = this->first_row_record();
+        return this->row_index->size() > first ? this->row_index->size() - first : 0;
+    }
+
+    /** Continue reading from a row, counting from 0 after the header
+     *
+     *  Rows already queued are discarded, and n_rows() becomes row. Seeking past the
+     *  last row leaves the reader at the end of the file.
+     */
+    CSV_INLINE void CSVReader::seek(size_t row) {
+        if (!this->row_index)
+            throw std::runtime_error("seek() needs a row index, see CSVFormat::row_index()");
+
+        if (this->read_csv_worker.joinable())
+            this->read_csv_worker.join();
+
+        this->records->clear();
+        this->make_parser(this->record_offset(this->first_row_record() + row));
+        this->header_trimmed = true;
+        this->_n_rows = row;
+    }
 
-                    throw std::runtime_error("Line too long " + internals::format_row(errored_row));
-                }
-            }
-            else {
-                row = this->records->pop_front();
-                this->_n_rows++;
-                return true;
-            }
+    CSV_INLINE size_t CSVReader::record_offset(size_t record) const {
+        return record < this->row_index->size()
+            ? (size_t)(*this->row_index)[record] : internals::get_file_size(this->filename);
+    }
+
+    /** Read up to count rows starting at row first
+     *
+     *  Rows dropped because of the VariableColumnPolicy are skipped over,
+     *  and fewer rows are returned at the end of the file.
+     */
+    CSV_INLINE std::vector<CSVRow> CSVReader::slice(size_t first, size_t count) {
+        this->seek(first);
+
+        // Parse just the requested records instead of a whole ITERATION_CHUNK_SIZE
+        // chunk, which would dominate the cost of reading a few rows
+        const size_t n_rows = this->record_count();
+        const size_t last = first < n_rows ? first + std::min(count, n_rows - first) : first;
+        const size_t bytes = this->record_offset(this->first_row_record() + last)
+            - this->record_offset(this->first_row_record() + first);
+        if (bytes > 0) {
+            const size_t threads = this->_format.get_threads();
+            this->read_csv(threads > 1 ? (bytes + threads - 1) / threads : bytes);
         }
 
-        return false;
+        std::vector<CSVRow> rows;
+        CSVRow row;
+        while (rows.size() < count && this->read_row(row))
+            rows.push_back(std::move(row));
+
+        return rows;
     }
 }
 
@@ -7682,8 +9010,6 @@ namespace csv {
 
     CSV_INLINE csv::string_view CSVRow::get_field(size_t index) const
     {
-        using internals::ParseFlags;
-
         if (index >= this->size())
             throw std::runtime_error("Index out of bounds.");
 
@@ -7694,20 +9020,7 @@ namespace csv {
         if (field.has_double_quote) {
             auto& value = this->data->double_quote_fields[field_index];
             if (value.empty()) {
-                bool prev_ch_quote = false;
-                for (size_t i = 0; i < field.length; i++) {
-                    if (this->data->parse_flags[field_str[i] + 128] == ParseFlags::QUOTE) {
-                        if (prev_ch_quote) {
-                            prev_ch_quote = false;
-                            continue;
-                        }
-                        else {
-                            prev_ch_quote = true;
-                        }
-                    }
-
-                    value += field_str[i];
-                }
+                this->unescape_field(field_str, field.length, value);
             }
 
             return csv::string_view(value);
@@ -7716,6 +9029,42 @@ namespace csv {
         return field_str.substr(0, field.length);
     }
 
+    CSV_INLINE csv::string_view CSVRow::get_field(size_t index, std::string& buffer) const
+    {
+        if (index >= this->size())
+            throw std::runtime_error("Index out of bounds.");
+
+        auto& field = this->data->fields[this->fields_start + index];
+        auto field_str = csv::string_view(this->data->data).substr(this->data_start + field.start);
+
+        if (field.has_double_quote) {
+            buffer.clear();
+            this->unescape_field(field_str, field.length, buffer);
+            return csv::string_view(buffer);
+        }
+
+        return field_str.substr(0, field.length);
+    }
+
+    CSV_INLINE void CSVRow::unescape_field(csv::string_view str, size_t length, std::string& out) const {
+        using internals::ParseFlags;
+
+        bool prev_ch_quote = false;
+        for (size_t i = 0; i < length; i++) {
+            if (this->data->parse_flags[str[i] + 128] == ParseFlags::QUOTE) {
+                if (prev_ch_quote) {
+                    prev_ch_quote = false;
+                    continue;
+                }
+                else {
+                    prev_ch_quote = true;
+                }
+            }
+
+            out += str[i];
+        }
+    }
+
     CSV_INLINE bool CSVField::try_parse_hex(int& parsedValue) {
         size_t start = 0, end = 0;
 
@@ -8141,9 +9490,161 @@ namespace csv {
  *  Calculates statistics from CSV files
  */
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
 #include <string>
+#include <thread>
 
 namespace csv {
+    namespace internals {
+        /** 64-bit FNV-1a followed by the MurmurHash3 finalizer, so that every bit is well mixed */
+        inline uint64_t hash_string(csv::string_view value) noexcept {
+            uint64_t hash = 14695981039346656037ULL;
+            for (char ch : value) {
+                hash ^= (unsigned char)ch;
+                hash *= 1099511628211ULL;
+            }
+
+            hash ^= hash >> 33;
+            hash *= 0xff51afd7ed558ccdULL;
+            hash ^= hash >> 33;
+            hash *= 0xc4ceb9fe1a85ec53ULL;
+            hash ^= hash >> 33;
+            return hash;
+        }
+
+        CSV_INLINE void RunningMoments::push(long double x) noexcept {
+            this->n++;
+            const long double delta = x - this->mean;
+            this->mean += delta / this->n;
+            this->m2 += delta * (x - this->mean);
+        }
+
+        CSV_INLINE void RunningMoments::merge(const RunningMoments& other) noexcept {
+            if (other.n == 0) return;
+            if (this->n == 0) {
+                *this = other;
+                return;
+            }
+
+            const long double total = this->n + other.n;
+            const long double delta = other.mean - this->mean;
+            this->mean += delta * other.n / total;
+            this->m2 += other.m2 + delta * delta * this->n * other.n / total;
+            this->n = total;
+        }
+
+        CSV_INLINE void HyperLogLog::insert(uint64_t hash) noexcept {
+            // The top PRECISION bits pick a register, which keeps the longest run of
+            // leading zeros (plus one) seen in the remaining bits
+            const size_t index = (size_t)(hash >> (64 - PRECISION));
+            const uint64_t rest = (hash << PRECISION) | ((uint64_t)1 << (PRECISION - 1));
+            const uint8_t rank = (uint8_t)(__builtin_clzll(rest) + 1);
+            if (rank > this->registers[index]) this->registers[index] = rank;
+        }
+
+        CSV_INLINE void HyperLogLog::merge(const HyperLogLog& other) noexcept {
+            for (size_t i = 0; i < this->registers.size(); i++)
+                this->registers[i] = std::max(this->registers[i], other.registers[i]);
+        }
+
+        CSV_INLINE size_t HyperLogLog::estimate() const noexcept {
+            const double m = (double)this->registers.size();
+            double sum = 0;
+            size_t zeros = 0;
+            for (auto reg : this->registers) {
+                sum += std::ldexp(1.0, -(int)reg);
+                if (reg == 0) zeros++;
+            }
+
+            const double estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+
+            // Linear counting is more accurate while many registers are still empty
+            if (estimate <= 2.5 * m && zeros > 0)
+                return (size_t)std::llround(m * std::log(m / (double)zeros));
+
+            return (size_t)std::llround(estimate);
+        }
+
+        CSV_INLINE void HeavyHitters::insert(csv::string_view value) {
+            auto it = this->_counts.find(std::string(value));
+            if (it != this->_counts.end()) {
+                it->second++;
+            }
+            else if (this->_counts.size() < this->capacity) {
+                this->_counts.emplace(std::string(value), 1);
+            }
+            else {
+                // No room: the new value and every tracked value lose one occurrence
+                for (auto count = this->_counts.begin(); count != this->_counts.end();) {
+                    if (--count->second == 0)
+                        count = this->_counts.erase(count);
+                    else
+                        ++count;
+                }
+            }
+        }
+
+        CSV_INLINE void HeavyHitters::merge(const HeavyHitters& other) {
+            for (auto& count : other._counts)
+                this->_counts[count.first] += count.second;
+
+            if (this->_counts.size() > this->capacity)
+                this->shrink();
+        }
+
+        CSV_INLINE void HeavyHitters::shrink() {
+            std::vector<size_t> values;
+            values.reserve(this->_counts.size());
+            for (auto& count : this->_counts)
+                values.push_back(count.second);
+
+            std::nth_element(values.begin(), values.begin() + this->capacity, values.end(), std::greater<size_t>());
+            const size_t cutoff = values[this->capacity];
+
+            for (auto count = this->_counts.begin(); count != this->_counts.end();) {
+                if (count->second <= cutoff) {
+                    count = this->_counts.erase(count);
+                }
+                else {
+                    count->second -= cutoff;
+                    ++count;
+                }
+            }
+        }
+
+        CSV_INLINE void ColumnStats::push(csv::string_view value) {
+            this->counts.insert(value);
+            this->distinct.insert(hash_string(value));
+
+            CSVField field(value);
+            this->dtypes[field.type()]++;
+
+            if (field.is_num()) {
+                const long double x = field.get<long double>();
+                this->moments.push(x);
+
+                if (std::isnan(this->min) || x < this->min) this->min = x;
+                if (std::isnan(this->max) || x > this->max) this->max = x;
+            }
+        }
+
+        CSV_INLINE void ColumnStats::merge(const ColumnStats& other) {
+            this->moments.merge(other.moments);
+
+            if (std::isnan(this->min) || other.min < this->min) this->min = other.min;
+            if (std::isnan(this->max) || other.max > this->max) this->max = other.max;
+
+            for (auto& count : other.dtypes)
+                this->dtypes[count.first] += count.second;
+
+            this->distinct.merge(other.distinct);
+            this->counts.merge(other.counts);
+        }
+    }
+
     /** Calculate statistics for an arbitrarily large file. When this constructor
      *  is called, CSVStat will process the entire file iteratively. Once finished,
      *  methods like get_mean(), get_counts(), etc... can be used to retrieve statistics.
@@ -8162,8 +9663,8 @@ namespace csv {
     /** Return current means */
     CSV_INLINE std::vector<long double> CSVStat::get_mean() const {
         std::vector<long double> ret;        
-        for (size_t i = 0; i < this->get_col_names().size(); i++) {
-            ret.push_back(this->rolling_means[i]);
+        for (auto& column : this->stats) {
+            ret.push_back(column.moments.mean);
         }
         return ret;
     }
@@ -8171,8 +9672,8 @@ namespace csv {
     /** Return current variances */
     CSV_INLINE std::vector<long double> CSVStat::get_variance() const {
         std::vector<long double> ret;        
-        for (size_t i = 0; i < this->get_col_names().size(); i++) {
-            ret.push_back(this->rolling_vars[i]/(this->n[i] - 1));
+        for (auto& column : this->stats) {
+            ret.push_back(column.moments.m2/(column.moments.n - 1));
         }
         return ret;
     }
@@ -8180,8 +9681,8 @@ namespace csv {
     /** Return current mins */
     CSV_INLINE std::vector<long double> CSVStat::get_mins() const {
         std::vector<long double> ret;        
-        for (size_t i = 0; i < this->get_col_names().size(); i++) {
-            ret.push_back(this->mins[i]);
+        for (auto& column : this->stats) {
+            ret.push_back(column.min);
         }
         return ret;
     }
@@ -8189,17 +9690,34 @@ namespace csv {
     /** Return current maxes */
     CSV_INLINE std::vector<long double> CSVStat::get_maxes() const {
         std::vector<long double> ret;        
-        for (size_t i = 0; i < this->get_col_names().size(); i++) {
-            ret.push_back(this->maxes[i]);
+        for (auto& column : this->stats) {
+            ret.push_back(column.max);
         }
         return ret;
     }
 
-    /** Get counts for each column */
+    /** Get counts of the most frequent values of each column
+     *
+     *  @note Counts are exact for columns with at most 500 distinct values. Otherwise
+     *        only frequent values are kept, with counts which may be slightly low.
+     *  @see  internals::HeavyHitters
+     */
     CSV_INLINE std::vector<CSVStat::FreqCount> CSVStat::get_counts() const {
         std::vector<FreqCount> ret;
-        for (size_t i = 0; i < this->get_col_names().size(); i++) {
-            ret.push_back(this->counts[i]);
+        for (auto& column : this->stats) {
+            ret.push_back(column.counts.counts());
+        }
+        return ret;
+    }
+
+    /** Get the approximate number of distinct values in each column
+     *
+     *  @see internals::HyperLogLog
+     */
+    CSV_INLINE std::vector<size_t> CSVStat::get_distinct() const {
+        std::vector<size_t> ret;
+        for (auto& column : this->stats) {
+            ret.push_back(column.distinct.estimate());
         }
         return ret;
     }
@@ -8207,163 +9725,113 @@ namespace csv {
     /** Get data type counts for each column */
     CSV_INLINE std::vector<CSVStat::TypeCount> CSVStat::get_dtypes() const {
         std::vector<TypeCount> ret;        
-        for (size_t i = 0; i < this->get_col_names().size(); i++) {
-            ret.push_back(this->dtypes[i]);
+        for (auto& column : this->stats) {
+            ret.push_back(column.dtypes);
         }
         return ret;
     }
 
-    CSV_INLINE void CSVStat::calc_chunk() {
-        /** Only create stats counters the first time **/
-        if (dtypes.empty()) {
-            /** Go through all records and calculate specified statistics */
-            for (size_t i = 0; i < this->get_col_names().size(); i++) {
-                dtypes.push_back({});
-                counts.push_back({});
-                rolling_means.push_back(0);
-                rolling_vars.push_back(0);
-                mins.push_back(NAN);
-                maxes.push_back(NAN);
-                n.push_back(0);
-            }
-        }
-
-        // Start threads
-        std::vector<std::thread> pool;
-        for (size_t i = 0; i < this->get_col_names().size(); i++)
-            pool.push_back(std::thread(&CSVStat::calc_worker, this, i));
-
-        // Block until done
-        for (auto& th : pool)
-            th.join();
+    CSV_INLINE void CSVStat::calc_chunk(const std::vector<CSVRow>& rows,
+        std::vector<internals::ColumnStats>& out) const {
+        std::string buffer;
+        for (auto& row : rows) {
+            // Rows kept by VariableColumnPolicy::KEEP don't line up with the columns
+            if (row.size() != out.size()) continue;
 
-        this->records.clear();
+            for (size_t i = 0; i < out.size(); i++)
+                out[i].push(row.get_field(i, buffer));
+        }
     }
 
     CSV_INLINE void CSVStat::calc() {
         constexpr size_t CALC_CHUNK_SIZE = 5000;
 
-        for (auto& row : reader) {
-            this->records.push_back(std::move(row));
+        const size_t n_cols = this->get_col_names().size();
+        const size_t n_workers = this->reader.get_format().get_threads();
 
-            /** Chunk rows */
-            if (this->records.size() == CALC_CHUNK_SIZE) {
-                calc_chunk();
-            }
-        }
+        // Chunks of rows waiting for a worker. The queue is bounded so that
+        // memory use does not depend on the size of the file.
+        const size_t max_queued = 2 * n_workers;
+        std::deque<std::vector<CSVRow>> queue;
+        std::mutex lock;
+        std::condition_variable not_empty, not_full;
+        bool done = false;
 
-        if (!this->records.empty()) {
-          calc_chunk();
-        }
-    }
+        std::vector<std::vector<internals::ColumnStats>> partial(n_workers,
+            std::vector<internals::ColumnStats>(n_cols));
 
-    CSV_INLINE void CSVStat::calc_worker(const size_t &i) {
-        /** Worker thread for CSVStat::calc() which calculates statistics for one column.
-         * 
-         *  @param[in] i Column index
-         */
+        auto worker = [&](size_t worker_no) {
+            while (true) {
+                std::vector<CSVRow> rows;
+                {
+                    std::unique_lock<std::mutex> guard(lock);
+                    not_empty.wait(guard, [&] { return !queue.empty() || done; });
+                    if (queue.empty()) return;
+
+                    rows = std::move(queue.front());
+                    queue.pop_front();
+                }
 
-        auto current_record = this->records.begin();
+                not_full.notify_one();
+                this->calc_chunk(rows, partial[worker_no]);
+            }
+        };
 
-        for (size_t processed = 0; current_record != this->records.end(); processed++) {
-            if (current_record->size() == this->get_col_names().size()) {
-                auto current_field = (*current_record)[i];
+        auto finish = [&](std::vector<std::thread>& pool) {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                done = true;
+            }
 
-                // Optimization: Don't count() if there's too many distinct values in the first 1000 rows
-                if (processed < 1000 || this->counts[i].size() <= 500)
-                    this->count(current_field, i);
+            not_empty.notify_all();
+            for (auto& th : pool)
+                th.join();
+        };
 
-                this->dtype(current_field, i);
+        std::vector<std::thread> pool;
+        for (size_t i = 0; i < n_workers; i++)
+            pool.push_back(std::thread(worker, i));
 
-                // Numeric Stuff
-                if (current_field.is_num()) {
-                    long double x_n = current_field.get<long double>();
+        try {
+            std::vector<CSVRow> rows;
+            rows.reserve(CALC_CHUNK_SIZE);
 
-                    // This actually calculates mean AND variance
-                    this->variance(x_n, i);
-                    this->min_max(x_n, i);
+            auto submit = [&]() {
+                {
+                    std::unique_lock<std::mutex> guard(lock);
+                    not_full.wait(guard, [&] { return queue.size() < max_queued; });
+                    queue.push_back(std::move(rows));
                 }
-            }
-            else if (this->reader.get_format().get_variable_column_policy() == VariableColumnPolicy::THROW) {
-                throw std::runtime_error("Line has different length than the others " + internals::format_row(*current_record));
-            }
-
-            ++current_record;
-        }
-    }
 
-    CSV_INLINE void CSVStat::dtype(CSVField& data, const size_t &i) {
-        /** Given a record update the type counter
-         *  @param[in]  record Data observation
-         *  @param[out] i      The column index that should be updated
-         */
-        
-        auto type = data.type();
-        if (this->dtypes[i].find(type) !=
-            this->dtypes[i].end()) {
-            // Increment count
-            this->dtypes[i][type]++;
-        } else {
-            // Initialize count
-            this->dtypes[i].insert(std::make_pair(type, 1));
-        }
-    }
+                not_empty.notify_one();
+                rows = std::vector<CSVRow>();
+                rows.reserve(CALC_CHUNK_SIZE);
+            };
 
-    CSV_INLINE void CSVStat::count(CSVField& data, const size_t &i) {
-        /** Given a record update the frequency counter
-         *  @param[in]  record Data observation
-         *  @param[out] i      The column index that should be updated
-         */
+            for (auto& row : reader) {
+                rows.push_back(std::move(row));
 
-        auto item = data.get<std::string>();
+                /** Chunk rows */
+                if (rows.size() == CALC_CHUNK_SIZE) {
+                    submit();
+                }
+            }
 
-        if (this->counts[i].find(item) !=
-            this->counts[i].end()) {
-            // Increment count
-            this->counts[i][item]++;
-        } else {
-            // Initialize count
-            this->counts[i].insert(std::make_pair(item, 1));
+            if (!rows.empty()) {
+                submit();
+            }
+        }
+        catch (...) {
+            finish(pool);
+            throw;
         }
-    }
-
-    CSV_INLINE void CSVStat::min_max(const long double &x_n, const size_t &i) {
-        /** Update current minimum and maximum
-         *  @param[in]  x_n Data observation
-         *  @param[out] i   The column index that should be updated
-         */
-        if (std::isnan(this->mins[i]))
-            this->mins[i] = x_n;
-        if (std::isnan(this->maxes[i]))
-            this->maxes[i] = x_n;
-        
-        if (x_n < this->mins[i])
-            this->mins[i] = x_n;
-        else if (x_n > this->maxes[i])
-            this->maxes[i] = x_n;
-    }
 
-    CSV_INLINE void CSVStat::variance(const long double &x_n, const size_t &i) {
-        /** Given a record update rolling mean and variance for all columns
-         *  using Welford's Algorithm
-         *  @param[in]  x_n Data observation
-         *  @param[out] i   The column index that should be updated
-         */
-        long double& current_rolling_mean = this->rolling_means[i];
-        long double& current_rolling_var = this->rolling_vars[i];
-        long double& current_n = this->n[i];
-        long double delta;
-        long double delta2;
+        finish(pool);
 
-        current_n++;
-        
-        if (current_n == 1) {
-            current_rolling_mean = x_n;
-        } else {
-            delta = x_n - current_rolling_mean;
-            current_rolling_mean += delta/current_n;
-            delta2 = x_n - current_rolling_mean;
-            current_rolling_var += delta*delta2;
+        this->stats = std::vector<internals::ColumnStats>(n_cols);
+        for (auto& worker_stats : partial) {
+            for (size_t i = 0; i < n_cols; i++)
+                this->stats[i].merge(worker_stats[i]);
         }
     }
 
@@ -8403,6 +9871,257 @@ namespace csv {
         return csv_dtypes;
     }
 }
+/** @file
+ *  Reads CSV files column by column into typed buffers
+ */
+
+#include <cmath>
+#include <limits>
+
+namespace csv {
+    namespace internals {
+        /** Strip leading and trailing spaces */
+        inline csv::string_view trim_spaces(csv::string_view in) noexcept {
+            size_t start = 0, end = in.size();
+            while (start < end && in[start] == ' ') start++;
+            while (end > start && in[end - 1] == ' ') end--;
+            return in.substr(start, end - start);
+        }
+
+        /** Parse a base-10 integer which fits in an int64_t
+         *
+         *  @returns Whether or not the whole of in was such an integer
+         */
+        inline bool parse_int64(csv::string_view in, int64_t& out) noexcept {
+            in = trim_spaces(in);
+            size_t i = 0;
+            const bool negative = !in.empty() && in[0] == '-';
+            if (!in.empty() && (in[0] == '-' || in[0] == '+')) i++;
+            if (i == in.size()) return false;
+
+            // Accumulate as unsigned so that INT64_MIN can be represented
+            const uint64_t limit = negative ? (uint64_t)std::numeric_limits<int64_t>::max() + 1
+                : (uint64_t)std::numeric_limits<int64_t>::max();
+            uint64_t value = 0;
+            for (; i < in.size(); i++) {
+                const unsigned digit = (unsigned)(in[i] - '0');
+                if (digit > 9 || value > (limit - digit) / 10) return false;
+                value = value * 10 + digit;
+            }
+
+            out = negative ? (int64_t)(0 - value) : (int64_t)value;
+            return true;
+        }
+
+        /** Parse a floating point number in decimal or scientific notation
+         *
+         *  @returns Whether or not the whole of in was such a number
+         */
+        inline bool parse_double(csv::string_view in, double& out) noexcept {
+            in = trim_spaces(in);
+            if (!in.empty() && in[0] == '+') in = in.substr(1);
+            if (in.empty()) return false;
+
+#ifdef CSV_HAS_TO_CHARS
+            auto result = std::from_chars(in.data(), in.data() + in.size(), out);
+            return result.ec == std::errc() && result.ptr == in.data() + in.size();
+#else
+            // strtod() needs a null terminated string
+            char buffer[64];
+            if (in.size() >= sizeof(buffer)) return false;
+            std::copy(in.begin(), in.end(), buffer);
+            buffer[in.size()] = '\0';
+
+            char* end = nullptr;
+            out = strtod(buffer, &end);
+            return end == buffer + in.size();
+#endif
+        }
+    }
+
+    CSV_INLINE void ColumnBatch::Column::push(csv::string_view value) {
+        switch (this->type) {
+        case ColumnType::INT64: {
+            int64_t number = 0;
+            const bool ok = internals::parse_int64(value, number);
+            this->int64s.push_back(ok ? number : 0);
+            this->valid.push_back(ok);
+            break;
+        }
+        case ColumnType::DOUBLE: {
+            double number = 0;
+            const bool ok = internals::parse_double(value, number);
+            this->doubles.push_back(ok ? number : std::numeric_limits<double>::quiet_NaN());
+            this->valid.push_back(ok);
+            break;
+        }
+        case ColumnType::STRING:
+            this->strings.push_back(value);
+            this->valid.push_back(1);
+            break;
+        }
+    }
+
+    CSV_INLINE void ColumnBatch::Column::push_null() {
+        switch (this->type) {
+        case ColumnType::INT64:
+            this->int64s.push_back(0);
+            break;
+        case ColumnType::DOUBLE:
+            this->doubles.push_back(std::numeric_limits<double>::quiet_NaN());
+            break;
+        case ColumnType::STRING:
+            this->strings.push_back("");
+            break;
+        }
+
+        this->valid.push_back(0);
+    }
+
+    CSV_INLINE void ColumnBatch::reset(const ColumnSchema& schema, size_t rows) {
+        this->columns.resize(schema.size());
+        for (size_t i = 0; i < schema.size(); i++) {
+            auto& column = this->columns[i];
+            column.name = schema[i].name;
+            column.type = schema[i].type;
+            column.int64s.clear();
+            column.doubles.clear();
+            column.strings.clear();
+            column.valid.clear();
+            column.valid.reserve(rows);
+
+            if (column.type == ColumnType::INT64) column.int64s.reserve(rows);
+            else if (column.type == ColumnType::DOUBLE) column.doubles.reserve(rows);
+        }
+
+        this->n_rows = 0;
+    }
+
+    CSV_INLINE int ColumnBatch::index_of(csv::string_view col_name) const {
+        for (size_t i = 0; i < this->columns.size(); i++) {
+            if (this->columns[i].name == col_name) return (int)i;
+        }
+
+        return CSV_NOT_FOUND;
+    }
+
+    CSV_INLINE const ColumnBatch::Column& ColumnBatch::column(size_t col, ColumnType type) const {
+        if (col >= this->columns.size())
+            throw std::runtime_error("Index out of bounds.");
+
+        auto& ret = this->columns[col];
+        if (ret.type != type)
+            throw std::runtime_error("Column " + ret.name + " has a different type.");
+
+        return ret;
+    }
+
+    CSV_INLINE const std::vector<int64_t>& ColumnBatch::int64s(size_t col) const {
+        return this->column(col, ColumnType::INT64).int64s;
+    }
+
+    CSV_INLINE const std::vector<double>& ColumnBatch::doubles(size_t col) const {
+        return this->column(col, ColumnType::DOUBLE).doubles;
+    }
+
+    CSV_INLINE const StringColumn& ColumnBatch::strings(size_t col) const {
+        return this->column(col, ColumnType::STRING).strings;
+    }
+
+    CSV_INLINE const std::vector<uint8_t>& ColumnBatch::valid(size_t col) const {
+        if (col >= this->columns.size())
+            throw std::runtime_error("Index out of bounds.");
+
+        return this->columns[col].valid;
+    }
+
+#ifdef _MSC_VER
+#pragma region ColumnBatch Retrieval by Name
+#endif
+    CSV_INLINE const std::vector<int64_t>& ColumnBatch::int64s(csv::string_view col_name) const {
+        const int col = this->index_of(col_name);
+        if (col == CSV_NOT_FOUND)
+            throw std::runtime_error("Can't find a column named " + std::string(col_name));
+
+        return this->int64s((size_t)col);
+    }
+
+    CSV_INLINE const std::vector<double>& ColumnBatch::doubles(csv::string_view col_name) const {
+        const int col = this->index_of(col_name);
+        if (col == CSV_NOT_FOUND)
+            throw std::runtime_error("Can't find a column named " + std::string(col_name));
+
+        return this->doubles((size_t)col);
+    }
+
+    CSV_INLINE const StringColumn& ColumnBatch::strings(csv::string_view col_name) const {
+        const int col = this->index_of(col_name);
+        if (col == CSV_NOT_FOUND)
+            throw std::runtime_error("Can't find a column named " + std::string(col_name));
+
+        return this->strings((size_t)col);
+    }
+#ifdef _MSC_VER
+#pragma endregion
+#endif
+
+    CSV_INLINE void ColumnReader::resolve_columns() {
+        for (auto& spec : this->schema) {
+            const int pos = this->reader.index_of(spec.name);
+            if (pos == CSV_NOT_FOUND)
+                throw std::runtime_error("Can't find a column named " + spec.name);
+
+            this->positions.push_back((size_t)pos);
+        }
+    }
+
+    /** Read up to max_rows rows into batch, replacing its previous contents
+     *
+     *  @par Short Rows
+     *  If the reader keeps rows with missing fields (VariableColumnPolicy::KEEP),
+     *  missing values are stored as invalid.
+     *
+     *  @returns Whether or not any rows were read
+     */
+    CSV_INLINE bool ColumnReader::read_batch(ColumnBatch& batch, size_t max_rows) {
+        batch.reset(this->schema, max_rows);
+
+        CSVRow row;
+        while (batch.n_rows < max_rows && this->reader.read_row(row)) {
+            for (size_t i = 0; i < this->positions.size(); i++) {
+                auto& column = batch.columns[i];
+                if (this->positions[i] < row.size())
+                    column.push(row.get_field(this->positions[i]));
+                else
+                    column.push_null();
+            }
+
+            batch.n_rows++;
+        }
+
+        return !batch.empty();
+    }
+
+    /** Return an iterator to the first batch of max_rows rows */
+    CSV_INLINE ColumnReader::iterator ColumnReader::begin(size_t batch_rows) {
+        return iterator(this, batch_rows);
+    }
+
+    CSV_INLINE ColumnReader::iterator::iterator(ColumnReader* reader, size_t _batch_rows) :
+        daddy(reader), batch(std::make_shared<ColumnBatch>()), batch_rows(_batch_rows) {
+        if (!daddy->read_batch(*this->batch, this->batch_rows))
+            this->daddy = nullptr; // this == end()
+    }
+
+    /** Read the next batch, reusing the memory of the previous one */
+    CSV_INLINE ColumnReader::iterator& ColumnReader::iterator::operator++() {
+        if (!daddy->read_batch(*this->batch, this->batch_rows))
+            this->daddy = nullptr; // this == end()
+
+        return *this;
+    }
+}
+
 #include <sstream>
 #include <vector>
 
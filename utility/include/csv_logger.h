@@ -0,0 +1,414 @@
+/**
+ * @file csv_logger.h
+ * @author caofangyu (caofy@antwork.link)
+ * @brief  异步追加写、按大小/时间轮转的 CSV 日志
+ * @version 0.1
+ * @date 2023-11-07
+ *
+ * 生产者调用 log() 把一行(std::tuple)放入无锁环形队列, 队列满时丢弃并计数, 从不等待磁盘。
+ * 后台线程成批取出, 经 csv::DelimWriter 格式化后用 O_APPEND 的 write() 写入当前文件:
+ * 1、当前文件超过 max_bytes 或打开超过 max_age 后轮转, 旧文件改名为 <名>.<yyyymmdd-HHMMSS>.<扩展名>
+ * 2、每个新文件(大小为0)先写一次表头, 重新打开已有内容的文件时不再写
+ * 3、按 SyncPolicy 调用 fdatasync()
+ * 4、写失败的一批不重试, 计入 dropped() 并截掉已写入的部分
+ * 轮转按批检查, 文件可能超出 max_bytes 一批的数据量。
+ *
+ */
+
+#pragma once
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "csv.hpp"
+
+namespace utility {
+
+/**
+ * @brief 有界无锁环形队列, 多生产者单消费者
+ *
+ * 每个槽带一个序号(Vyukov 有界队列): 序号等于写位置时可写, 等于写位置+1时可读。
+ * 生产者之间只竞争一次 CAS, 消费者不需要原子读改写。
+ */
+template <typename T>
+class MpscRing {
+public:
+    /**
+     * @param capacity 槽数, 向上取整为2的幂
+     */
+    explicit MpscRing(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        m_mask = size - 1;
+        m_cells.reset(new Cell[size]);
+        for (size_t i = 0; i < size; i++) m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MpscRing(const MpscRing&) = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+
+    /**
+     * @brief 放入一项, 可在任意线程调用
+     *
+     * @return false 队列已满
+     */
+    bool try_push(T&& value) {
+        size_t pos = m_tail.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &m_cells[pos & m_mask];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+            if (diff == 0) {
+                if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = m_tail.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief 取出一项, 只能在消费者线程调用
+     *
+     * @return false 队列为空
+     */
+    bool try_pop(T& value) {
+        Cell& cell = m_cells[m_head & m_mask];
+        if (cell.sequence.load(std::memory_order_acquire) != m_head + 1) return false;
+
+        value = std::move(cell.value);
+        cell.sequence.store(m_head + m_mask + 1, std::memory_order_release);
+        m_head++;
+        return true;
+    }
+
+    size_t capacity() const { return m_mask + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> m_cells;
+    size_t m_mask = 0;
+    alignas(64) std::atomic<size_t> m_tail{0};  // 下一个写位置
+    alignas(64) size_t m_head = 0;              // 下一个读位置, 只有消费者访问
+};
+
+/**
+ * @brief 供 csv::DelimWriter 使用的输出流, 直接 write() 到文件描述符
+ *
+ * 写失败后丢弃之后的数据直到 clear_error(), 避免文件中间缺一段后又接着写。
+ */
+class FdSink {
+public:
+    /**
+     * @param bytes 文件的现有大小
+     */
+    FdSink(int fd, uint64_t bytes) : m_fd(fd), m_bytes(bytes) {}
+
+    FdSink& write(const char* data, std::streamsize size) {
+        while (size > 0 && m_error == 0) {
+            const ssize_t written = ::write(m_fd, data, (size_t)size);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                m_error = errno;
+                break;
+            }
+            data += written;
+            size -= written;
+            m_bytes += (uint64_t)written;
+        }
+        return *this;
+    }
+
+    void flush() {}
+
+    uint64_t bytes() const { return m_bytes; }
+    int error() const { return m_error; }
+    void clear_error() { m_error = 0; }
+
+    /**
+     * @brief 截断到 bytes 字节, 去掉写了一半的数据
+     *
+     * @return false 截断失败
+     */
+    bool truncate(uint64_t bytes) {
+        if (::ftruncate(m_fd, (off_t)bytes) != 0) return false;
+        m_bytes = bytes;
+        return true;
+    }
+
+private:
+    int m_fd;
+    uint64_t m_bytes;      // 文件当前大小
+    int m_error = 0;       // 最近一次写失败的 errno
+};
+
+/**
+ * @brief 何时调用 fdatasync()
+ *
+ */
+enum class SyncPolicy {
+    kNever,     // 交给操作系统
+    kOnRotate,  // 轮转和关闭文件时
+    kInterval,  // 每隔 sync_interval, 以及轮转和关闭时
+    kEveryBatch // 每写完一批
+};
+
+/**
+ * @brief 异步 CSV 日志, 每行的列类型为 T..., 须可默认构造
+ *
+ * 用法:
+ *   utility::CsvLogger<int64_t, double, double>::Options options;
+ *   options.path = "flight.csv";
+ *   options.header = {"time_us", "lat", "lon"};
+ *   utility::CsvLogger<int64_t, double, double> logger(options);
+ *   logger.log(now_us, lat, lon);
+ */
+template <typename... T>
+class CsvLogger {
+public:
+    using Row = std::tuple<T...>;
+
+    struct Options {
+        std::string path;                                       // 当前文件, 轮转后的文件在同一目录
+        std::vector<std::string> header;                        // 为空则不写表头
+        uint64_t max_bytes = 64ULL << 20;                       // 按大小轮转, 0为不按大小
+        std::chrono::seconds max_age{3600};                     // 按时间轮转, 0为不按时间
+        SyncPolicy sync = SyncPolicy::kInterval;
+        std::chrono::milliseconds sync_interval{1000};
+        size_t capacity = 1 << 16;                              // 队列槽数
+        size_t batch_rows = 4096;                               // 后台线程每批最多写的行数
+        std::chrono::milliseconds idle_wait{10};                // 队列空时后台线程的等待时间
+    };
+
+    /**
+     * @throw std::system_error 打开文件或写表头失败
+     */
+    explicit CsvLogger(Options options) : m_options(std::move(options)), m_ring(m_options.capacity) {
+        open();
+        m_thread = std::thread(&CsvLogger::run, this);
+    }
+
+    CsvLogger(const CsvLogger&) = delete;
+    CsvLogger& operator=(const CsvLogger&) = delete;
+
+    /**
+     * @brief 写完队列中的行后关闭文件
+     *
+     */
+    ~CsvLogger() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wakeup.notify_one();
+        m_thread.join();
+        close();
+    }
+
+    /**
+     * @brief 记录一行, 不阻塞, 可在任意线程调用
+     *
+     * @return false 队列已满, 本行被丢弃
+     */
+    bool log(T... values) { return log(Row(std::move(values)...)); }
+
+    bool log(Row row) {
+        if (m_ring.try_push(std::move(row))) return true;
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    uint64_t written() const { return m_written.load(std::memory_order_relaxed); }  // 已写入文件的行数
+    uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }  // 队列满、文件打不开或写失败而丢弃的行数
+    uint64_t rotations() const { return m_rotations.load(std::memory_order_relaxed); }
+    uint64_t errors() const { return m_errors.load(std::memory_order_relaxed); }    // 写入/轮转失败次数
+
+private:
+    using Clock = std::chrono::steady_clock;
+    using Writer = csv::CSVWriter<FdSink, false>;
+
+    void run() {
+        Row row;
+        while (true) {
+            if (m_fd < 0) reopen();
+
+            const uint64_t batch_start = m_sink ? m_sink->bytes() : 0;
+            size_t rows = 0;
+            while (rows < m_options.batch_rows && m_ring.try_pop(row)) {
+                if (m_writer) *m_writer << row;
+                rows++;
+            }
+
+            if (rows == 0) {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                if (m_stop) return;
+                m_wakeup.wait_for(lock, m_options.idle_wait);
+                continue;
+            }
+
+            if (!m_writer) {
+                // 没有可写的文件, 本批丢弃
+                m_dropped.fetch_add(rows, std::memory_order_relaxed);
+                continue;
+            }
+
+            m_writer->flush();
+            if (m_sink->error() != 0) {
+                // 本批不重试, 丢弃并去掉已写入的部分, 不在文件里留下半行
+                m_errors.fetch_add(1, std::memory_order_relaxed);
+                m_dropped.fetch_add(rows, std::memory_order_relaxed);
+                m_sink->clear_error();
+                // 截不掉就换一个文件, 半行留在轮转出去的文件末尾
+                if (!m_sink->truncate(batch_start)) rotate();
+                continue;
+            }
+            m_file_rows += rows;
+            m_written.fetch_add(rows, std::memory_order_relaxed);
+
+            const auto now = Clock::now();
+            if (m_options.sync == SyncPolicy::kEveryBatch ||
+                (m_options.sync == SyncPolicy::kInterval && now - m_last_sync >= m_options.sync_interval)) {
+                ::fdatasync(m_fd);
+                m_last_sync = now;
+            }
+
+            if (should_rotate(now)) rotate();
+        }
+    }
+
+    bool should_rotate(Clock::time_point now) const {
+        if (m_file_rows == 0) return false;
+        if (m_options.max_bytes > 0 && m_sink->bytes() >= m_options.max_bytes) return true;
+        return m_options.max_age.count() > 0 && now - m_opened >= m_options.max_age;
+    }
+
+    void rotate() {
+        close();
+        if (::rename(m_options.path.c_str(), rotated_path().c_str()) != 0) {
+            m_errors.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            m_rotations.fetch_add(1, std::memory_order_relaxed);
+        }
+        reopen();
+    }
+
+    /**
+     * @brief 后台线程中打开文件, 失败时计数, 下一批再试
+     *
+     */
+    void reopen() {
+        try {
+            open();
+        } catch (const std::system_error&) {
+            m_errors.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void open() {
+        const int fd = ::open(m_options.path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0) throw std::system_error(errno, std::generic_category(), "open " + m_options.path);
+
+        m_fd = fd;
+        m_sink.reset(new FdSink(m_fd, file_size()));
+        m_writer.reset(new Writer(*m_sink));
+        if (m_sink->bytes() == 0 && !m_options.header.empty()) {
+            *m_writer << m_options.header;
+            m_writer->flush();
+            if (m_sink->error() != 0) {
+                const int error = m_sink->error();
+                m_sink->truncate(0);
+                close();
+                throw std::system_error(error, std::generic_category(), "write header " + m_options.path);
+            }
+        }
+        m_file_rows = 0;
+        m_opened = m_last_sync = Clock::now();
+    }
+
+    void close() {
+        if (m_fd < 0) return;
+        m_writer.reset();
+        m_sink.reset();
+        if (m_options.sync != SyncPolicy::kNever) ::fdatasync(m_fd);
+        ::close(m_fd);
+        m_fd = -1;
+    }
+
+    uint64_t file_size() const {
+        struct stat st;
+        return ::fstat(m_fd, &st) == 0 ? (uint64_t)st.st_size : 0;
+    }
+
+    /**
+     * @brief 轮转后的文件名, 时间戳插在扩展名之前, 同一秒内多次轮转时再加序号
+     *
+     */
+    std::string rotated_path() const {
+        const size_t slash = m_options.path.find_last_of('/');
+        const size_t dot = m_options.path.find_last_of('.');
+        const bool has_ext = dot != std::string::npos && (slash == std::string::npos || dot > slash);
+        const std::string stem = has_ext ? m_options.path.substr(0, dot) : m_options.path;
+        const std::string ext = has_ext ? m_options.path.substr(dot) : "";
+
+        char stamp[32];
+        const time_t now = ::time(nullptr);
+        struct tm local;
+        ::localtime_r(&now, &local);
+        ::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &local);
+
+        std::string path = stem + "." + stamp + ext;
+        for (int i = 1; ::access(path.c_str(), F_OK) == 0; i++) {
+            path = stem + "." + stamp + "-" + std::to_string(i) + ext;
+        }
+        return path;
+    }
+
+    Options m_options;
+    MpscRing<Row> m_ring;
+
+    // 以下只在后台线程(以及构造/析构)中访问
+    int m_fd = -1;
+    std::unique_ptr<FdSink> m_sink;
+    std::unique_ptr<Writer> m_writer;  // 没有打开的文件时为空
+    uint64_t m_file_rows = 0;          // 当前文件中本次打开后写入的行数
+    Clock::time_point m_opened;
+    Clock::time_point m_last_sync;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    bool m_stop = false;
+    std::thread m_thread;
+
+    std::atomic<uint64_t> m_written{0};
+    std::atomic<uint64_t> m_dropped{0};
+    std::atomic<uint64_t> m_rotations{0};
+    std::atomic<uint64_t> m_errors{0};
+};
+
+}  // namespace utility
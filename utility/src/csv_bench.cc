@@ -0,0 +1,216 @@
+/**
+ * @file csv_bench.cc
+ * @author caofangyu (caofy@antwork.link)
+ * @brief  CSV 结构字符扫描、CSVReader 读取和按列读取的吞吐测试
+ * @version 0.1
+ * @date 2023-11-07
+ *
+ * 用法: csv_bench <file> [threads...]
+ * 1、用各指令集(scalar/sse2/avx2, 不超过本机支持的)扫描整个文件的分隔符/引号/换行位图, 输出 GB/s,
+ *    并检查结果与 scalar 一致
+ * 2、对每个线程数完整读一遍文件, 访问每个字段, 输出 MB/s 和 行/s, 各线程数的行数和校验和应一致
+ * 3、把所有列当作 double, 分别用 CSVField::get<double>() 逐行和 ColumnReader 按列求和, 输出 行/s,
+ *    两者的数值个数和总和应一致
+ * 4、建行索引的耗时, 以及用索引随机 seek 读一行的平均耗时, 并检查读到的行与顺序读的一致
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "csv.hpp"
+
+namespace {
+
+/**
+ * @brief 各指令集扫描结构字符的吞吐
+ *
+ * @return false 与 scalar 的结果不一致
+ */
+bool bench_scan(const std::string& filename) {
+    using namespace csv::internals;
+    std::error_code error;
+    auto mmap = mio::make_mmap_source(filename, 0, mio::map_entire_file, error);
+    if (error) {
+        std::cerr << "cannot map " << filename << std::endl;
+        return false;
+    }
+
+    const char* names[] = {"scalar", "sse2", "avx2"};
+    const size_t words = (mmap.size() + 63) / 64;
+    StructuralChars chars;
+    StructuralMasks expected;
+    bool ok = true;
+    std::cout << std::left << std::setw(10) << "scan" << std::right << std::setw(12) << "GB/s" << std::endl;
+    for (int level = 0; level <= (int)best_scan_level(); level++) {
+        StructuralMasks masks;
+        masks.delim.resize(words);
+        masks.quote.resize(words);
+        masks.newline.resize(words);
+
+        const int rounds = 5;
+        auto begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) {
+            scan_structural((ScanLevel)level, chars, mmap.data(), mmap.size(), masks.delim.data(),
+                            masks.quote.data(), masks.newline.data());
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        if (level == 0) {
+            expected = masks;
+        } else if (masks.delim != expected.delim || masks.quote != expected.quote ||
+                   masks.newline != expected.newline) {
+            std::cerr << names[level] << " masks differ from scalar" << std::endl;
+            ok = false;
+        }
+        std::cout << std::left << std::setw(10) << names[level] << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(12) << mmap.size() * rounds / seconds / 1e9 << std::endl;
+    }
+    std::cout << std::endl;
+    return ok;
+}
+
+/**
+ * @brief 逐行 get<double>() 与 ColumnReader 按列读取 double 的吞吐
+ *
+ * @return false 两者得到的数值个数或总和不一致
+ */
+bool bench_columns(const std::string& filename) {
+    std::cout << std::left << std::setw(10) << "doubles" << std::right << std::setw(12) << "rows" << std::setw(14)
+              << "rows/s" << std::setw(12) << "numbers" << std::setw(24) << "sum" << std::endl;
+    auto report = [](const char* name, size_t rows, double seconds, size_t numbers, double sum) {
+        std::cout << std::left << std::setw(10) << name << std::right << std::setw(12) << rows << std::fixed
+                  << std::setprecision(0) << std::setw(14) << rows / seconds << std::setw(12) << numbers
+                  << std::setprecision(3) << std::setw(24) << sum << std::endl;
+    };
+
+    auto begin = std::chrono::steady_clock::now();
+    csv::CSVReader reader(filename);
+    size_t rows = 0, row_numbers = 0;
+    double row_sum = 0;
+    for (auto& row : reader) {
+        rows++;
+        for (auto& field : row) {
+            if (!field.is_num()) continue;
+            row_numbers++;
+            row_sum += field.get<double>();
+        }
+    }
+    report("rows", rows, std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count(),
+           row_numbers, row_sum);
+
+    begin = std::chrono::steady_clock::now();
+    csv::ColumnSchema schema;
+    for (auto& name : reader.get_col_names()) schema.push_back({name, csv::ColumnType::DOUBLE});
+    csv::ColumnReader columns(filename, schema);
+    size_t column_numbers = 0;
+    double column_sum = 0;
+    for (auto& batch : columns) {
+        for (size_t col = 0; col < batch.n_cols(); col++) {
+            const auto& values = batch.doubles(col);
+            const auto& valid = batch.valid(col);
+            for (size_t i = 0; i < batch.size(); i++) {
+                if (!valid[i]) continue;
+                column_numbers++;
+                column_sum += values[i];
+            }
+        }
+    }
+    report("columns", columns.n_rows(), std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count(),
+           column_numbers, column_sum);
+
+    if (row_numbers != column_numbers) {
+        std::cerr << "rows and columns found a different number of doubles" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::string row_text(const csv::CSVRow& row) {
+    std::string text;
+    for (auto& field : row) {
+        text += field.get<csv::string_view>();
+        text += '\n';
+    }
+    return text;
+}
+
+/**
+ * @brief 建行索引与随机 seek 的耗时
+ *
+ * @return false seek 读到的行与顺序读的不一致
+ */
+bool bench_index(const std::string& filename) {
+    auto begin = std::chrono::steady_clock::now();
+    const auto index = csv::CSVIndex::build(filename, csv::CSVFormat());
+    const double build_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    std::vector<std::string> expected;
+    csv::CSVReader sequential(filename, csv::CSVFormat().variable_columns(csv::VariableColumnPolicy::KEEP));
+    for (auto& row : sequential) expected.push_back(row_text(row));
+
+    csv::CSVReader reader(filename, csv::CSVFormat().row_index().variable_columns(csv::VariableColumnPolicy::KEEP));
+    std::mt19937_64 rng(42);
+    const int seeks = 1000;
+    bool ok = reader.record_count() == expected.size();
+    begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < seeks && !expected.empty(); i++) {
+        const size_t row = rng() % expected.size();
+        auto rows = reader.slice(row, 1);
+        if (rows.size() != 1 || row_text(rows[0]) != expected[row]) {
+            std::cerr << "seek to row " << row << " read a different row" << std::endl;
+            ok = false;
+            break;
+        }
+    }
+    const double seek_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    std::cout << "index " << index.size() << " records in " << std::fixed << std::setprecision(3) << build_seconds
+              << " s, seek " << std::setprecision(1) << seek_seconds / seeks * 1e6 << " us" << std::endl;
+    return ok;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <file> [threads...]" << std::endl;
+        return 1;
+    }
+
+    std::vector<size_t> threads;
+    for (int i = 2; i < argc; i++) threads.push_back(atoi(argv[i]));
+    if (threads.empty()) threads = {1, 2, 4, 8};
+
+    const bool scan_ok = bench_scan(argv[1]);
+
+    const double mb = csv::internals::get_file_size(argv[1]) / 1e6;
+    std::cout << std::left << std::setw(10) << "threads" << std::right << std::setw(12) << "rows" << std::setw(12)
+              << "MB/s" << std::setw(14) << "rows/s" << std::setw(24) << "checksum" << std::endl;
+    for (size_t n : threads) {
+        auto begin = std::chrono::steady_clock::now();
+        csv::CSVReader reader(argv[1], csv::CSVFormat().threads(n));
+        uint64_t rows = 0, checksum = 0;
+        for (auto& row : reader) {
+            rows++;
+            for (auto& field : row) checksum = checksum * 31 + field.get<csv::string_view>().size();
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        std::cout << std::left << std::setw(10) << n << std::right << std::setw(12) << rows << std::fixed
+                  << std::setprecision(1) << std::setw(12) << mb / seconds << std::setw(14) << std::setprecision(0)
+                  << rows / seconds << std::setw(24) << checksum << std::endl;
+    }
+    std::cout << std::endl;
+    const bool columns_ok = bench_columns(argv[1]);
+    std::cout << std::endl;
+    const bool index_ok = bench_index(argv[1]);
+    std::remove(csv::CSVIndex::sidecar_path(argv[1]).c_str());
+    return scan_ok && columns_ok && index_ok ? 0 : 1;
+}
@@ -0,0 +1,134 @@
+/**
+ * @file csv_logger_bench.cc
+ * @author caofangyu (caofy@antwork.link)
+ * @brief  CsvLogger 多线程写入测试
+ * @version 0.1
+ * @date 2023-11-07
+ *
+ * 用法: csv_logger_bench [dir] [threads] [rows_per_thread] [max_mb]
+ * 每个生产者线程记录 rows_per_thread 行(时间戳, 线程号, 序号, 3个 double), 文件超过 max_mb 轮转。
+ * 输出生产者侧的 log() 耗时(平均/p99/最大), 写入/丢弃的行数和轮转次数,
+ * 最后读回 dir 下所有文件, 检查数据行数等于写入行数、每个文件只有一行表头。
+ *
+ */
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "csv_logger.h"
+
+namespace {
+
+using Logger = utility::CsvLogger<int64_t, int, uint64_t, double, double, double>;
+
+int64_t now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+/**
+ * @brief 读回 dir 下以 log 开头的文件
+ *
+ * @return false 数据行数或表头不对
+ */
+bool check_files(const std::string& dir, const std::string& header, uint64_t expected_rows) {
+    DIR* handle = opendir(dir.c_str());
+    if (handle == nullptr) return false;
+
+    uint64_t files = 0, rows = 0;
+    bool ok = true;
+    while (dirent* entry = readdir(handle)) {
+        const std::string name = entry->d_name;
+        if (name.compare(0, 3, "log") != 0) continue;
+
+        files++;
+        std::ifstream in(dir + "/" + name);
+        std::string line;
+        for (size_t i = 0; std::getline(in, line); i++) {
+            if ((i == 0) != (line == header)) {
+                std::cerr << name << ":" << i + 1 << " unexpected line " << line << std::endl;
+                ok = false;
+                break;
+            }
+            if (i > 0) rows++;
+        }
+    }
+    closedir(handle);
+
+    std::cout << "files " << files << ", data rows " << rows << std::endl;
+    if (rows != expected_rows) {
+        std::cerr << "expected " << expected_rows << " rows" << std::endl;
+        ok = false;
+    }
+    return ok;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    const std::string dir = argc > 1 ? argv[1] : ".";
+    const int threads = argc > 2 ? atoi(argv[2]) : 4;
+    const uint64_t rows_per_thread = argc > 3 ? strtoull(argv[3], nullptr, 10) : 500000;
+    const uint64_t max_mb = argc > 4 ? strtoull(argv[4], nullptr, 10) : 16;
+
+    Logger::Options options;
+    options.path = dir + "/log.csv";
+    options.header = {"time_us", "thread", "seq", "x", "y", "z"};
+    options.max_bytes = max_mb << 20;
+    options.sync = utility::SyncPolicy::kInterval;
+
+    const uint64_t total = threads * rows_per_thread;
+    std::vector<std::vector<int64_t>> latencies(threads);
+    uint64_t written = 0, dropped = 0, rotations = 0, errors = 0;
+    double produce_seconds = 0, seconds = 0;
+    {
+        Logger logger(options);
+        const auto begin = std::chrono::steady_clock::now();
+        std::vector<std::thread> producers;
+        for (int t = 0; t < threads; t++) {
+            producers.emplace_back([&, t]() {
+                auto& latency = latencies[t];
+                latency.reserve(rows_per_thread);
+                for (uint64_t i = 0; i < rows_per_thread; i++) {
+                    const int64_t start = now_us();
+                    logger.log(start, t, i, i * 0.001, t + 0.5, 1.0 / (i + 1));
+                    latency.push_back(now_us() - start);
+                }
+            });
+        }
+        for (auto& producer : producers) producer.join();
+        produce_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        while (logger.written() + logger.dropped() < total) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        written = logger.written();
+        dropped = logger.dropped();
+        rotations = logger.rotations();
+        errors = logger.errors();
+    }
+
+    std::vector<int64_t> all;
+    for (auto& latency : latencies) all.insert(all.end(), latency.begin(), latency.end());
+    std::sort(all.begin(), all.end());
+    double mean = 0;
+    for (int64_t us : all) mean += us;
+    mean /= all.size();
+
+    std::cout << "produced " << total << " rows in " << produce_seconds << " s, " << total / produce_seconds
+              << " rows/s" << std::endl;
+    std::cout << "log() us: mean " << mean << ", p99 " << all[all.size() * 99 / 100] << ", max " << all.back()
+              << std::endl;
+    std::cout << "written " << written << " in " << seconds << " s (" << written / seconds << " rows/s), dropped "
+              << dropped << ", rotations " << rotations << ", errors " << errors << std::endl;
+
+    return check_files(dir, "time_us,thread,seq,x,y,z", written) ? 0 : 1;
+}
@@ -0,0 +1,117 @@
+/**
+ * @file csv_write_bench.cc
+ * @author caofangyu (caofy@antwork.link)
+ * @brief  CSVWriter 写数值行和文本行的吞吐测试
+ * @version 0.1
+ * @date 2023-11-07
+ *
+ * 用法: csv_write_bench [rows] [file]
+ * 1、numeric: 每行 1 个 int64 + 2 个 int + 6 个 double, 用 std::tuple 写入
+ * 2、text:    每行 6 个字符串, 其中部分含分隔符/引号需要转义, 用 std::vector 写入
+ * 默认写到 /dev/null, 输出 行/s; 给出 file 时写到文件, 另输出 MB/s, 并把数值行读回用 strtod 检查 double 是否无损
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "csv.hpp"
+
+namespace {
+
+using NumericRow = std::tuple<int64_t, int, int, double, double, double, double, double, double>;
+
+std::vector<NumericRow> make_numeric(size_t n) {
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> price(0, 10000);
+    std::normal_distribution<double> noise(0, 1);
+    std::vector<NumericRow> rows;
+    rows.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        rows.emplace_back(1700000000000LL + (int64_t)i * 37, (int)(rng() % 100000), -(int)(rng() % 1000),
+                          price(rng), noise(rng), (double)(rng() % 1000) / 4, 1.0 / (i + 1), price(rng) * 1e9,
+                          (double)(rng() % 100));
+    }
+    return rows;
+}
+
+std::vector<std::vector<std::string>> make_text(size_t n) {
+    const char* words[] = {"alpha", "beta", "gamma, delta", "say \"hi\"", "line\nbreak", "plain-text-field"};
+    std::vector<std::vector<std::string>> rows(n);
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < 6; j++) rows[i].push_back(words[(i + j * 3) % 6]);
+    }
+    return rows;
+}
+
+template <typename Rows>
+void run(const std::string& name, const Rows& rows, const std::string& path) {
+    auto begin = std::chrono::steady_clock::now();
+    std::ofstream out(path, std::ios::binary);
+    {
+        auto writer = csv::make_csv_writer_buffered(out);
+        for (const auto& row : rows) writer << row;
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    const double mb = path == "/dev/null" ? 0 : out.tellp() / 1e6;
+
+    std::cout << std::left << std::setw(10) << name << std::right << std::setw(12) << rows.size() << std::fixed
+              << std::setprecision(0) << std::setw(14) << rows.size() / seconds << std::setprecision(1)
+              << std::setw(12);
+    if (mb > 0) {
+        std::cout << mb / seconds << std::endl;
+    } else {
+        std::cout << "-" << std::endl;
+    }
+}
+
+/**
+ * @brief 读回写出的数值行, 检查每个 double 都与写入的值相同
+ *
+ */
+bool check_numeric(const std::vector<NumericRow>& rows, const std::string& path) {
+    csv::CSVReader reader(path, csv::CSVFormat().no_header());
+    size_t i = 0;
+    for (auto& row : reader) {
+        if (i >= rows.size()) break;
+        const NumericRow& expected = rows[i++];
+        if (strtod(row[3].get<std::string>().c_str(), nullptr) != std::get<3>(expected) ||
+            strtod(row[6].get<std::string>().c_str(), nullptr) != std::get<6>(expected) ||
+            strtod(row[7].get<std::string>().c_str(), nullptr) != std::get<7>(expected)) {
+            std::cerr << "row " << i << " does not round-trip" << std::endl;
+            return false;
+        }
+    }
+    if (i != rows.size()) {
+        std::cerr << "read back " << i << " of " << rows.size() << " rows" << std::endl;
+        return false;
+    }
+    std::cout << "numeric rows round-trip" << std::endl;
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    const size_t n = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1000000;
+    const std::string path = argc > 2 ? argv[2] : "/dev/null";
+
+    const auto numeric = make_numeric(n);
+    const auto text = make_text(n);
+
+    std::cout << std::left << std::setw(10) << "rows" << std::right << std::setw(12) << "count" << std::setw(14)
+              << "rows/s" << std::setw(12) << "MB/s" << std::endl;
+    run("numeric", numeric, path);
+    if (path != "/dev/null" && !check_numeric(numeric, path)) return 1;
+    run("text", text, path);
+    return 0;
+}
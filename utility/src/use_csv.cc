@@ -12,7 +12,6 @@ int main() {
     // test file exists
     std::ifstream infile(filename);
     std::ofstream outfile(filename, std::ios_base::app);
-    csv::CSVWriter<std::ofstream> writer = csv::make_csv_writer(nullptr);
     csv::CSVWriter<std::ofstream> writer = csv::make_csv_writer(outfile);
     std::vector<std::string> column = {
         "A", "B", "C"